@@ -5,6 +5,7 @@
 #include "pcg_random.hpp"
 #include "primes.h"
 #include "util.h"
+#include "perfcounters.h"
 
 #include "testers/amorttester.hpp"
 #include "graveyard.h"
@@ -37,14 +38,15 @@ int main(int argc, char **argv)
 	else
 		label = "";
 
-
 	// AOS X
 	{
 		std::ofstream f(label + "aos_amort_x");
 		f << "\n----- graveyard, array of structures, by x [core " << sched_getcpu() << "]\n";
 		f << "ops per test, x, n, total mean time, total median time, total time, "
 		     "mean ops time, total ops time, mean rb time, total rb time, "
-		     "rb window, rebuilds, lf\n";
+		     "rb window, rebuilds, lf";
+		if (perfcounters::available()) hw_counts::csv_header(f << ", ", "/op");
+		f << "\n";
 		for (auto x : xs) {
 			for (auto b : bs)
 				f << amorttester<graveyard_aos<>> (rng, x, b, nops, nt) << std::flush;
@@ -56,7 +58,9 @@ int main(int argc, char **argv)
 		f << "\n----- graveyard, structure of arrays, by x, [core " << sched_getcpu() << "]\n";
 		f << "ops per test, x, n, total mean time, total median time, total time, "
 		     "mean ops time, total ops time, mean rb time, total rb time, "
-		     "rb window, rebuilds, lf\n";
+		     "rb window, rebuilds, lf";
+		if (perfcounters::available()) hw_counts::csv_header(f << ", ", "/op");
+		f << "\n";
 		for (auto x : xs) {
 			for (auto b : bs)
 				f << amorttester<graveyard_soa<>> (rng, x, b, nops, nt) << std::flush;
@@ -0,0 +1,377 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <deque>
+#include <algorithm>
+#include <type_traits>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+#include "config.h"
+#include "sweep.h"
+#include "workload.h"
+#include "results.h"
+#include "measure.h"
+
+#include "testers/dispatch.hpp"
+#include "testers/querytester.hpp"
+#include "testers/one_rb_querytester.hpp"
+#include "testers/floattester.hpp"
+#include "testers/rebuildtester.hpp"
+#include "testers/amorttester.hpp"
+#include "testers/loadtester.hpp"
+#include "testers/latencytester.hpp"
+#include "testers/openlooptester.hpp"
+#include "testers/ycsbtester.hpp"
+#include "testers/replaytester.hpp"
+
+// one driver for all the testers:
+//
+//   bench [config=<file>] [key=value ...]
+//
+// e.g. bench tester=query table=all n=1M x=2-400 ops=1M trials=10
+// every parameter, with its default:
+//
+//   tester         query one_rb_query float rebuild amort load latency
+//                  openloop ycsb replay                       [query]
+//   table          table types, or all for ours       [graveyard_aos]
+//                  (stl_unordered, stl_map, sorted_array: baselines.h)
+//   key_bits       32 or 64                                      [32]
+//   value_bits     32 or 64                                      [32]
+//   stats          instrumentation: full histograms cheap none
+//                  (perfstats.h); all but full need 32/32 bits   [full]
+//   n              table sizes                                   [1M]
+//   x              load factors 1-1/x                     [2,5,10,20]
+//   ops            queries/ops per trial                         [1M]
+//   trials         trials per data point                         [10]
+//   seed           seed, or random                               [42]
+//   threads        run configurations in parallel (sweep)         [1]
+//   bw_jobs        see sweep.h                                    [1]
+//   out            output file, or - for stdout                   [-]
+//   results        also write the records (results.h) here, CSV if
+//                  the name ends in .csv, JSON lines otherwise
+//   warmup         query, float, latency: untimed runs before the
+//                  trials (measure.h)                             [1]
+//   cpu            query, float, latency, load: pin to this cpu when
+//                  threads=1; -1 doesn't                         [-1]
+//   cold           query, float, latency, load: flush the caches
+//                  before each trial (load: before loading)   [false]
+//   level          query: confidence level of the intervals      [0.95]
+//   keys, key_param, access, access_param       workload (workload.h)
+//   fail_pct       query: % of queries that miss                  [0]
+//   magic_x        one_rb_query: x of the one rebuild            [10]
+//   snapshot       float: snapshot path                          [""]
+//   points         load: data points                            [250]
+//   load_rebuild   load: rebuild when asked                    [true]
+//   query_pct      latency, openloop: % queries                  [50]
+//   long_len       latency: probe/shift length called long       [32]
+//   rates          openloop: offered ops/sec    [100k,500k,1M,2M,4M,8M]
+//   slo            openloop: p99 target, ns                     [50k]
+//   bisect         openloop: bisection steps                      [6]
+//   workload       ycsb: core workloads                      [A,B,C,D,E,F]
+//   intervals      ycsb: throughput intervals                    [10]
+//   trace          replay: trace file
+//   rebuilds       replay: own or recorded                      [own]
+//
+// the table type is chosen once, here, and the tester runs fully
+// templated on it.  a job is one (table, n) for the testers that take a
+// list of x, one (table, n, x) for the rest; with threads > 1 the jobs
+// are spread over the cores.  job i always gets pcg64(seed, i), so the
+// keys don't depend on the thread count.
+
+struct params {
+	std::string tester;
+	std::string stats;
+	std::vector<int> xs;
+	int ops, trials;
+	workload wl;
+	int fail_pct, magic_x;
+	std::string snapshot;
+	int points;
+	bool load_rebuild;
+	int query_pct;
+	int long_len;
+	std::vector<double> rates;
+	double slo;
+	int bisect;
+	std::vector<std::string> ycsb;
+	int intervals;
+	std::string trace;
+	replay_rebuilds rebuilds;
+	measure_options mo;
+};
+
+template <typename E>
+static bool
+parse_enum(const std::string &s, const std::vector<std::string> &names,
+           E *e)
+{
+	for (std::size_t i = 0; i < names.size(); ++i)
+		if (s == names[i]) {
+			*e = (E)i;
+			return true;
+		}
+	std::cerr << "unknown value " << s << "\n";
+	return false;
+}
+
+// does this tester read the miss and shift counters?
+static bool
+needs_full_stats(const std::string &tester)
+{
+	return tester == "load" || tester == "latency";
+}
+
+static bool
+get_params(const config &c, params *p)
+{
+	bool ok = true;
+
+	p->tester = c.get("tester", "query");
+	p->stats = c.get("stats", "full");
+	for (auto x : c.get_ints("x", "2,5,10,20"))
+		p->xs.push_back(x);
+	p->ops = c.get_int("ops", 1'000'000);
+	p->trials = c.get_int("trials", 10);
+
+	ok &= parse_enum(c.get("keys", "uniform"), { "uniform", "sequential",
+	                 "strided", "clustered" }, &p->wl.keys);
+	ok &= parse_enum(c.get("access", "uniform"), { "uniform", "zipfian",
+	                 "hotspot", "latest" }, &p->wl.access);
+	p->wl.key_param = c.get_int("key_param", 0);
+	p->wl.access_param = c.get_double("access_param", 0);
+
+	p->fail_pct = c.get_int("fail_pct", 0);
+	p->magic_x = c.get_int("magic_x", 10);
+	p->snapshot = c.get("snapshot", "");
+	p->points = c.get_int("points", 250);
+	p->load_rebuild = c.get_bool("load_rebuild", true);
+	p->query_pct = c.get_int("query_pct", 50);
+	p->long_len = c.get_int("long_len", 32);
+	p->rates = c.get_doubles("rates", "100k,500k,1M,2M,4M,8M");
+	p->slo = c.get_double("slo", 50'000);
+	p->bisect = c.get_int("bisect", 6);
+	p->ycsb = c.get_strings("workload", "A,B,C,D,E,F");
+	p->intervals = c.get_int("intervals", 10);
+	p->trace = c.get("trace", "");
+	ok &= parse_enum(c.get("rebuilds", "own"), { "own", "recorded" },
+	                 &p->rebuilds);
+	p->mo.warmup = c.get_int("warmup", 1);
+	p->mo.cpu = c.get_int("cpu", -1);
+	p->mo.cold = c.get_bool("cold", false);
+	p->mo.level = c.get_double("level", 0.95);
+
+	if (p->xs.empty() || p->ops <= 0 || p->trials <= 0) {
+		std::cerr << "need at least one x, and ops and trials > 0\n";
+		ok = false;
+	}
+	if (std::find(stats_names.begin(), stats_names.end(), p->stats) ==
+	    stats_names.end()) {
+		std::cerr << "unknown stats policy " << p->stats << "\n";
+		ok = false;
+	} else if (needs_full_stats(p->tester) && p->stats != "full") {
+		std::cerr << p->tester << " reads the FullStats counters, "
+		          << "needs stats=full\n";
+		ok = false;
+	}
+	if (p->tester == "replay" && p->trace.empty()) {
+		std::cerr << "replay needs trace=<file>\n";
+		ok = false;
+	}
+	return ok;
+}
+
+// does this tester take the whole x list in one run?
+static bool
+takes_x_list(const std::string &tester)
+{
+	return tester == "query" || tester == "one_rb_query" ||
+	       tester == "float" || tester == "rebuild" ||
+	       tester == "latency";
+}
+
+// the tester's own output to o, its records to rows
+template <typename tester>
+static void
+emit(const tester &t, std::ostream &o, std::vector<result_record> *rows)
+{
+	o << t;
+	rows->insert(rows->end(), t.results().begin(), t.results().end());
+}
+
+// records to load for a ycsb run: the table at 1-1/x, less room for
+// workload D and E's inserts (main() checks it comes out positive)
+static double
+ycsb_records(const params &p, uint64_t n, int x, const ycsb_config &c)
+{
+	return n * (1.0 - 1.0/x) - p.ops * c.mix.insert;
+}
+
+template <typename hashtable>
+static void
+run_tester(const params &p, uint64_t n, const std::vector<int> &xs,
+           pcg64 &rng, std::ostream &o, std::vector<result_record> *rows)
+{
+	const std::string &t = p.tester;
+	const std::vector<uint64_t> ns{ n };
+	// load and latency aren't built for the other policies
+	constexpr bool full = std::is_base_of_v<FullStats, hashtable>;
+
+	if (t == "query")
+		emit(querytester<hashtable>(rng, xs, ns, p.ops, p.trials,
+		                            p.fail_pct, p.wl, p.mo), o, rows);
+	else if (t == "one_rb_query")
+		emit(one_rb_querytester<hashtable>(rng, xs, ns, p.ops, p.trials,
+		                                   p.fail_pct, p.magic_x),
+		     o, rows);
+	else if (t == "float")
+		emit(floattester<hashtable>(rng, xs, ns, p.ops, p.trials,
+		                            p.snapshot, p.wl, p.mo), o, rows);
+	else if (t == "rebuild")
+		emit(rebuildtester<hashtable>(rng, xs, ns, p.trials), o, rows);
+	else if (t == "latency") {
+		if constexpr (full)
+			emit(latencytester<hashtable>(rng, xs, n, p.ops,
+			                              p.trials, p.query_pct,
+			                              p.long_len, p.mo),
+			     o, rows);
+	} else if (t == "amort")
+		emit(amorttester<hashtable>(rng, xs[0], n, p.ops, p.trials,
+		                            p.wl), o, rows);
+	else if (t == "load") {
+		if constexpr (full)
+			emit(loadtester<hashtable>(rng, n, xs[0], p.points,
+			                           p.load_rebuild, p.mo),
+			     o, rows);
+	} else if (t == "openloop")
+		emit(openlooptester<hashtable>(rng, xs[0], n, p.rates, p.ops,
+		                               p.slo, p.bisect, p.query_pct),
+		     o, rows);
+	else if (t == "ycsb")
+		for (auto &w : p.ycsb) {
+			ycsb_config c = ycsb_preset(w.empty() ? 'C' : w[0]);
+			emit(ycsbtester<hashtable>(rng, c, n,
+			                           ycsb_records(p, n, xs[0], c),
+			                           p.ops, p.intervals), o, rows);
+		}
+	else if (t == "replay")
+		emit(replaytester<hashtable>(p.trace, p.trials, p.rebuilds),
+		     o, rows);
+}
+
+static bool
+known_tester(const std::string &t)
+{
+	for (auto s : { "query", "one_rb_query", "float", "rebuild", "latency",
+	                "amort", "load", "openloop", "ycsb", "replay" })
+		if (t == s) return true;
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	config c;
+	params p;
+
+	if (!c.parse_args(argc, argv) || !get_params(c, &p))
+		return 1;
+	if (!known_tester(p.tester)) {
+		std::cerr << "unknown tester " << p.tester << "\n";
+		return 1;
+	}
+
+	std::vector<std::string> tables = c.get_strings("table",
+	                                                "graveyard_aos");
+	if (tables.size() == 1 && tables[0] == "all")
+		tables = table_names;
+	int key_bits = c.get_int("key_bits", 32);
+	int value_bits = c.get_int("value_bits", 32);
+	std::vector<int64_t> ns = c.get_ints("n", "1M");
+	if (p.tester == "replay")
+		ns = { 0 };     // the trace has the size
+
+	std::string seed = c.get("seed", "42");
+	sweep::options opt;
+	opt.seed = seed == "random" ? std::random_device()() :
+	           std::stoull(seed);
+	opt.threads = c.get_int("threads", 1);
+	opt.bw_jobs = c.get_int("bw_jobs", 1);
+	opt.quiet = opt.threads > 1;
+	if (opt.threads > 1)
+		p.mo.cpu = -1;  // sweep pins its workers
+	std::string out = c.get("out", "-");
+	if (!c.ok())
+		return 1;
+	result_writer results;
+	if (c.has("results") && !results.open(c.get("results", "")))
+		return 1;
+
+	for (auto &k : c.unused())
+		std::cerr << "warning: unknown parameter " << k << "\n";
+	std::cerr << c;
+
+	// a ycsb run loads the table short of 1-1/x by its inserts
+	if (p.tester == "ycsb")
+		for (auto n : ns)
+			for (auto x : p.xs)
+				for (auto &w : p.ycsb) {
+					ycsb_config yc = ycsb_preset(w.empty() ?
+					                             'C' : w[0]);
+					if (ycsb_records(p, n, x, yc) >= 1)
+						continue;
+					std::cerr << "ycsb " << w << ": "
+					          << p.ops * yc.mix.insert
+					          << " inserts don't fit in n=" << n
+					          << " at x=" << x
+					          << "; lower ops or raise n\n";
+					return 1;
+				}
+
+	// dispatch: one job per configuration, each bound to its table type
+	sweep jobs(opt);
+	std::deque<std::vector<result_record>> rows;   // per job
+	bool ok = true;
+	for (auto &t : tables)
+		for (auto n : ns) {
+			std::vector<std::vector<int>> xlists;
+			if (takes_x_list(p.tester))
+				xlists.push_back(p.xs);
+			else
+				for (auto x : p.xs) xlists.push_back({ x });
+
+			for (auto &xs : xlists)
+				ok &= with_table(t, key_bits, value_bits, p.stats,
+				                 [&]<typename hashtable>() {
+					std::size_t bytes = n * (sizeof(typename
+					        hashtable::key_type) + sizeof(typename
+					        hashtable::value_type) + 5);
+					if (p.mo.cold)  // bandwidth bound (measure.h)
+						bytes += 2 * sweep::llc_bytes();
+					std::string name = t + " n=" + std::to_string(n);
+					if (xs.size() == 1)
+						name += " x=" + std::to_string(xs[0]);
+					auto *r = &rows.emplace_back();
+					jobs.add(name, bytes,
+					         [&p, n, xs, r](pcg64 &rng,
+					                        std::ostream &o) {
+						run_tester<hashtable>(p, n, xs, rng, o,
+						                      r);
+					});
+				});
+		}
+	if (!ok) return 1;
+
+	if (out == "-") {
+		jobs.run(std::cout);
+	} else {
+		std::ofstream f(out);
+		jobs.run(f);
+	}
+	for (auto &r : rows)
+		results.add(r);
+
+	return 0;
+}
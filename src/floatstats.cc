@@ -10,6 +10,7 @@
 
 #include "pcg_random.hpp"
 #include "primes.h"
+#include "util.h"
 #include "graveyard.h"
 #include "ordered.h"
 #include "linear.h"
@@ -130,39 +131,6 @@ void float_timer(hashtable *ht, std::vector<int> *keys,
 	cout << std::endl;
 }
 
-double mean(std::vector<duration<double> > v)
-{
-	return (std::reduce(v.begin(), v.end()) / v.size()).count();
-}
-
-double median(std::vector<duration<double> > dv)
-{
-	double med;
-	vector<double> v;
-
-	for (auto i : dv) v.push_back(i.count());
-	int n = v.size() / 2.0;
-
-	std::nth_element(v.begin(), v.begin() + n, v.end());
-	med = v[n];
-
-	if ((v.size() % 2) == 0) {
-		auto max = std::max_element(v.begin(), v.begin() + n);
-		med = (*max + med) / 2.0;
-	}
-
-	return med;
-}
-
-std::ostream& operator<<(std::ostream& os,
-                         const std::vector<duration<double> >& v)
-{
-	os << "[";
-	for (auto &i : v) os << " " << i.count();
-	os << "]";
-        return os;
-}
-
 void dump_float_stats(const vector<float_stats_t> &v,
                               std::ostream &o = std::cout)
 {
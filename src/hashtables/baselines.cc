@@ -0,0 +1,531 @@
+#include <iostream>
+#include <algorithm>
+#include "baselines.h"
+#include "primes.h"
+
+using std::cerr, std::size_t;
+
+template class stl_unordered<>;
+template class stl_unordered<uint32_t, uint32_t, CheapCounters>;
+template class stl_unordered<uint32_t, uint32_t, ProbeHistograms>;
+template class stl_unordered<uint32_t, uint32_t, NoStats>;
+template class stl_unordered<uint32_t, uint64_t>;
+template class stl_unordered<uint64_t, uint32_t>;
+template class stl_unordered<uint64_t, uint64_t>;
+
+template class stl_map<>;
+template class stl_map<uint32_t, uint32_t, CheapCounters>;
+template class stl_map<uint32_t, uint32_t, ProbeHistograms>;
+template class stl_map<uint32_t, uint32_t, NoStats>;
+template class stl_map<uint32_t, uint64_t>;
+template class stl_map<uint64_t, uint32_t>;
+template class stl_map<uint64_t, uint64_t>;
+
+template class sorted_array<>;
+template class sorted_array<uint32_t, uint32_t, CheapCounters>;
+template class sorted_array<uint32_t, uint32_t, ProbeHistograms>;
+template class sorted_array<uint32_t, uint32_t, NoStats>;
+template class sorted_array<uint32_t, uint64_t>;
+template class sorted_array<uint64_t, uint32_t>;
+template class sorted_array<uint64_t, uint64_t>;
+
+static int
+prime_at_least(uint32_t b)
+{
+	int i = 0;
+	while (b > primes[i])
+		i++;
+	return i;
+}
+
+// ----- stl_unordered ------------------------------------------------------
+
+template <typename K, typename V, typename Stats>
+stl_unordered<K, V, Stats>::stl_unordered(uint32_t b)
+{
+	prime_index = prime_at_least(b);
+	buckets = b;
+	m.reserve(b);
+	max_load_factor = 0.5;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+	disable_rebuilds = false;
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_unordered<K, V, Stats>::resize(uint32_t b)
+{
+	buckets = b;
+	m.reserve(b);
+	this->count_resize();
+}
+
+template <typename K, typename V, typename Stats>
+stl_unordered<K, V, Stats>::result
+stl_unordered<K, V, Stats>::insert(K k, V v, bool rebuilding)
+{
+	if (m.size() >= buckets) {
+		this->count_fail(INSERT);
+		return FULLTABLE;
+	}
+
+	if (!m.try_emplace(k, v).second) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return DUPLICATE;
+	}
+	this->count_op(rebuilding ? REBUILD_INS : INSERT);
+
+	if (load_factor() > max_load_factor)
+		resize(primes[++prime_index]);
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return REBUILD;
+	}
+
+	return SUCCESS;
+}
+
+template <typename K, typename V, typename Stats>
+bool
+stl_unordered<K, V, Stats>::query(K k, V *v)
+{
+	this->count_op(QUERY);
+
+	auto it = m.find(k);
+	if (it != m.end()) {
+		*v = it->second;
+		return true;
+	} else {
+		this->count_fail(QUERY);
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+stl_unordered<K, V, Stats>::result
+stl_unordered<K, V, Stats>::remove(K k)
+{
+	this->count_op(REMOVE);
+	if (m.erase(k)) {
+		return result::SUCCESS;
+	} else {
+		this->count_fail(REMOVE);
+		return result::FAILURE;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_unordered<K, V, Stats>::reset_rebuild_window()
+{
+	rebuild_window = buckets/2 * (1.0 - load_factor()) + 1;
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_unordered<K, V, Stats>::rebuild()
+{
+	std::unordered_map<K, V> fresh;
+	fresh.reserve(buckets);
+	for (auto &kv : m) {
+		fresh.emplace(kv.first, kv.second);
+		this->count_op(REBUILD_INS);
+	}
+	m.swap(fresh);
+	reset_rebuild_window();
+	this->count_rebuild();
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_unordered<K, V, Stats>::cluster_len(std::map<int,int> *clust) const
+{
+	for (size_t b = 0; b < m.bucket_count(); ++b)
+		if (m.bucket_size(b))
+			(*clust)[m.bucket_size(b)]++;
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_unordered<K, V, Stats>::search_distance(std::map<int,int> *disp) const
+{
+	for (size_t b = 0; b < m.bucket_count(); ++b)
+		for (int d = 0; d < (int)m.bucket_size(b); ++d)
+			(*disp)[d]++;
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_unordered<K, V, Stats>::dump()
+{
+	for (size_t b = 0; b < m.bucket_count(); ++b) {
+		if (!m.bucket_size(b)) continue;
+		std::cout << b << ':';
+		for (auto it = m.begin(b); it != m.end(b); ++it)
+			std::cout << ' ' << it->first;
+		std::cout << '\n';
+	}
+}
+
+// ----- stl_map ------------------------------------------------------------
+
+template <typename K, typename V, typename Stats>
+stl_map<K, V, Stats>::stl_map(uint32_t b)
+{
+	prime_index = prime_at_least(b);
+	buckets = b;
+	max_load_factor = 0.5;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+	disable_rebuilds = false;
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_map<K, V, Stats>::resize(uint32_t b)
+{
+	buckets = b;
+	this->count_resize();
+}
+
+template <typename K, typename V, typename Stats>
+stl_map<K, V, Stats>::result
+stl_map<K, V, Stats>::insert(K k, V v, bool rebuilding)
+{
+	if (m.size() >= buckets) {
+		this->count_fail(INSERT);
+		return FULLTABLE;
+	}
+
+	if (!m.try_emplace(k, v).second) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return DUPLICATE;
+	}
+	this->count_op(rebuilding ? REBUILD_INS : INSERT);
+
+	if (load_factor() > max_load_factor)
+		resize(primes[++prime_index]);
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return REBUILD;
+	}
+
+	return SUCCESS;
+}
+
+template <typename K, typename V, typename Stats>
+bool
+stl_map<K, V, Stats>::query(K k, V *v)
+{
+	this->count_op(QUERY);
+
+	auto it = m.find(k);
+	if (it != m.end()) {
+		*v = it->second;
+		return true;
+	} else {
+		this->count_fail(QUERY);
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+stl_map<K, V, Stats>::result
+stl_map<K, V, Stats>::remove(K k)
+{
+	this->count_op(REMOVE);
+	if (m.erase(k)) {
+		return result::SUCCESS;
+	} else {
+		this->count_fail(REMOVE);
+		return result::FAILURE;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_map<K, V, Stats>::reset_rebuild_window()
+{
+	rebuild_window = buckets/2 * (1.0 - load_factor()) + 1;
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_map<K, V, Stats>::rebuild()
+{
+	std::map<K, V> fresh;
+	for (auto &kv : m) {
+		fresh.emplace_hint(fresh.end(), kv.first, kv.second);
+		this->count_op(REBUILD_INS);
+	}
+	m.swap(fresh);
+	reset_rebuild_window();
+	this->count_rebuild();
+}
+
+template <typename K, typename V, typename Stats>
+void
+stl_map<K, V, Stats>::dump()
+{
+	for (auto &kv : m)
+		std::cout << kv.first << ' ';
+	std::cout << '\n';
+}
+
+// ----- sorted_array -------------------------------------------------------
+
+template <typename K, typename V, typename Stats>
+sorted_array<K, V, Stats>::sorted_array(uint32_t b)
+{
+	prime_index = prime_at_least(b);
+	buckets = b;
+	records = 0;
+	tombs = 0;
+	max_load_factor = 0.5;
+	pending.reserve(max_pending);
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+	disable_rebuilds = false;
+}
+
+template <typename K, typename V, typename Stats>
+void
+sorted_array<K, V, Stats>::resize(uint32_t b)
+{
+	buckets = b;
+	this->count_resize();
+}
+
+// binary search for k in v: the slot holding it, or where it would go
+template <typename K, typename V, typename Stats>
+bool
+sorted_array<K, V, Stats>::search(const std::vector<record_t> &v, K k,
+                                  uint32_t *slot, uint64_t *steps) const
+{
+	uint32_t lo = 0, hi = v.size();
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo)/2;
+		++*steps;
+		if (v[mid].key < k)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*slot = lo;
+	return lo < v.size() && v[lo].key == k;
+}
+
+// look in the table, then the side array.  *in_table says which one
+// *slot refers to; if k is in neither, it's the side array position
+template <typename K, typename V, typename Stats>
+bool
+sorted_array<K, V, Stats>::probe(K k, uint32_t *slot, bool *in_table,
+                                 optype operation)
+{
+	uint64_t steps = 0;
+	bool res;
+
+	*in_table = search(table, k, slot, &steps) && !dead[*slot];
+	if (*in_table)
+		res = true;
+	else
+		res = search(pending, k, slot, &steps);
+
+	this->record_probe(steps, operation);
+	return res;
+}
+
+template <typename K, typename V, typename Stats>
+sorted_array<K, V, Stats>::result
+sorted_array<K, V, Stats>::insert(K k, V v, bool rebuilding)
+{
+	uint32_t slot;
+	bool in_table;
+
+	if (records >= buckets) {
+		this->count_fail(INSERT);
+		return FULLTABLE;
+	}
+
+	if (probe(k, &slot, &in_table, rebuilding ? REBUILD_INS : INSERT)) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return DUPLICATE;
+	}
+
+	// a dead record with this key can come back to life in place
+	uint32_t t;
+	uint64_t steps = 0;
+	if (search(table, k, &t, &steps)) {
+		table[t].value = v;
+		dead[t] = false;
+		--tombs;
+	} else {
+		this->count_shifts(pending.size() - slot,
+		                   rebuilding ? REBUILD_INS : INSERT);
+		pending.insert(pending.begin() + slot, record_t{ k, v });
+	}
+	++records;
+
+	this->count_op(rebuilding ? REBUILD_INS : INSERT);
+
+	if (load_factor() > max_load_factor)
+		resize(primes[++prime_index]);
+	if (pending.size() >= max_pending)
+		merge();
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return REBUILD;
+	}
+
+	return SUCCESS;
+}
+
+template <typename K, typename V, typename Stats>
+bool
+sorted_array<K, V, Stats>::query(K k, V *v)
+{
+	uint32_t slot;
+	bool in_table;
+	this->count_op(QUERY);
+
+	if (probe(k, &slot, &in_table, QUERY)) {
+		*v = in_table ? table[slot].value : pending[slot].value;
+		return true;
+	} else {
+		this->count_fail(QUERY);
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+sorted_array<K, V, Stats>::result
+sorted_array<K, V, Stats>::remove(K k)
+{
+	uint32_t slot;
+	bool in_table;
+	this->count_op(REMOVE);
+
+	if (probe(k, &slot, &in_table, REMOVE)) {
+		if (in_table) {
+			dead[slot] = true;
+			++tombs;
+		} else {
+			pending.erase(pending.begin() + slot);
+		}
+		--records;
+		return result::SUCCESS;
+	} else {
+		this->count_fail(REMOVE);
+		return result::FAILURE;
+	}
+}
+
+// fold the side array into the table and drop the dead records
+template <typename K, typename V, typename Stats>
+void
+sorted_array<K, V, Stats>::merge()
+{
+	std::vector<record_t> merged;
+	merged.reserve(records);
+
+	size_t i = 0, j = 0;
+	while (i < table.size() || j < pending.size()) {
+		if (i < table.size() && dead[i]) {
+			++i;
+		} else if (j == pending.size() ||
+		           (i < table.size() && table[i].key < pending[j].key)) {
+			merged.push_back(table[i++]);
+		} else {
+			merged.push_back(pending[j++]);
+			this->count_op(REBUILD_INS);
+		}
+	}
+
+	table.swap(merged);
+	dead.assign(table.size(), false);
+	pending.clear();
+	tombs = 0;
+}
+
+template <typename K, typename V, typename Stats>
+void
+sorted_array<K, V, Stats>::reset_rebuild_window()
+{
+	rebuild_window = buckets/2 * (1.0 - load_factor()) + 1;
+}
+
+template <typename K, typename V, typename Stats>
+void
+sorted_array<K, V, Stats>::rebuild()
+{
+	merge();
+	reset_rebuild_window();
+	this->count_rebuild();
+}
+
+// lengths of the runs of live records in the table
+template <typename K, typename V, typename Stats>
+void
+sorted_array<K, V, Stats>::cluster_len(std::map<int,int> *clust) const
+{
+	int run = 0;
+	for (size_t i = 0; i < table.size(); ++i) {
+		if (!dead[i]) {
+			++run;
+		} else if (run) {
+			(*clust)[run]++;
+			run = 0;
+		}
+	}
+	if (run) (*clust)[run]++;
+}
+
+template <typename K, typename V, typename Stats>
+void
+sorted_array<K, V, Stats>::search_distance(std::map<int,int> *disp) const
+{
+	for (size_t i = 0; i < table.size(); ++i)
+		if (!dead[i]) {
+			uint32_t slot;
+			uint64_t steps = 0;
+			search(table, table[i].key, &slot, &steps);
+			(*disp)[steps]++;
+		}
+}
+
+template <typename K, typename V, typename Stats>
+bool
+sorted_array<K, V, Stats>::check_ordering()
+{
+	auto less = [](const record_t &a, const record_t &b) {
+		return a.key < b.key;
+	};
+	return std::is_sorted(table.begin(), table.end(), less) &&
+	       std::is_sorted(pending.begin(), pending.end(), less);
+}
+
+template <typename K, typename V, typename Stats>
+void
+sorted_array<K, V, Stats>::dump()
+{
+	for (size_t i = 0; i < table.size(); ++i) {
+		if (dead[i]) std::cout << "\e[1;31m";
+		std::cout << table[i].key << ' ';
+		if (dead[i]) std::cout << "\e[0m";
+	}
+	std::cout << "\npending:";
+	for (auto &r : pending)
+		std::cout << ' ' << r.key;
+	std::cout << '\n';
+}
@@ -0,0 +1,233 @@
+#ifndef BASELINES_H
+#define BASELINES_H
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include "perfstats.h"
+
+// the standard library and a sorted array behind the tables' interface,
+// so the testers can measure them next to ours.
+//
+// these have no slots, so the table size is nominal: the constructor's b,
+// grown to the next prime past max_load_factor like the others.  the
+// testers load them to the same record counts as the hash tables of the
+// same size, which is what makes the numbers comparable.  load_factor()
+// is records/b, not the container's own load factor.
+//
+// they keep the same rebuild window as linear_aos so the testers'
+// rebuild protocol runs unchanged, and rebuild() is the closest thing
+// each has to ours:
+//   stl_unordered    std::unordered_map, reserved for b records; rebuild
+//                    copies it into a fresh one (new nodes, in bucket
+//                    order)
+//   stl_map          std::map; rebuild copies it, so the nodes are
+//                    allocated in key order again
+//   sorted_array     keys sorted in one array, binary searched; inserts
+//                    go to a small sorted side array and removes mark
+//                    records dead, and rebuild merges the two and drops
+//                    the dead ones
+//
+// probe lengths aren't visible through the std interfaces, so only the
+// per-operation counters are kept for those two; sorted_array counts
+// binary search steps as misses.
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+class stl_unordered : public Stats {
+	private:
+		using optype = perf::optype;
+		using enum perf::optype;
+
+		std::unordered_map<K, V> m;
+
+		uint32_t buckets;
+		int rebuild_window;
+		int prime_index;
+		double max_load_factor;
+
+		void reset_rebuild_window();
+
+	public:
+		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
+
+		stl_unordered(uint32_t b);
+		std::string table_type() const { return "stl_unordered"; }
+
+		void resize(uint32_t);
+		void set_max_load_factor(double f) { max_load_factor = f; }
+
+		result insert(K key, V value, bool rebuilding = false);
+		bool query(K key, V *value);
+		result remove(K key);
+		void rebuild();
+
+		// chain lengths, and positions within the chains
+		void cluster_len(std::map<int,int> *clust) const;
+		void search_distance(std::map<int,int> *disp) const;
+
+		int get_rebuild_window() const { return rebuild_window; }
+		double load_factor() const { return (double)m.size()/buckets; }
+		std::size_t table_size() const { return buckets; }
+		std::size_t table_size_bytes() const {
+			return m.bucket_count()*sizeof(void *)
+			       + m.size()*rec_width();
+		}
+		// a node: next pointer and the pair, as malloc rounds it
+		std::size_t rec_width() const {
+			return (sizeof(void *) + sizeof(std::pair<const K, V>)
+			        + 15) & ~15;
+		}
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		std::size_t state_width() const { return 0; }
+		std::size_t num_records() const { return m.size(); }
+
+		// debugging
+		void dump();
+		bool disable_rebuilds;
+		bool check_ordering() { return true; }
+};
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+class stl_map : public Stats {
+	private:
+		using optype = perf::optype;
+		using enum perf::optype;
+
+		std::map<K, V> m;
+
+		uint32_t buckets;
+		int rebuild_window;
+		int prime_index;
+		double max_load_factor;
+
+		void reset_rebuild_window();
+
+	public:
+		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
+
+		stl_map(uint32_t b);
+		std::string table_type() const { return "stl_map"; }
+
+		void resize(uint32_t);
+		void set_max_load_factor(double f) { max_load_factor = f; }
+
+		result insert(K key, V value, bool rebuilding = false);
+		bool query(K key, V *value);
+		result remove(K key);
+		void rebuild();
+
+		// no clusters or probe sequences to report
+		void cluster_len(std::map<int,int> *) const {}
+		void search_distance(std::map<int,int> *) const {}
+
+		int get_rebuild_window() const { return rebuild_window; }
+		double load_factor() const { return (double)m.size()/buckets; }
+		std::size_t table_size() const { return buckets; }
+		std::size_t table_size_bytes() const {
+			return m.size()*rec_width();
+		}
+		// a red-black node: colour, three pointers and the pair
+		std::size_t rec_width() const {
+			return (4*sizeof(void *) + sizeof(std::pair<const K, V>)
+			        + 15) & ~15;
+		}
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		std::size_t state_width() const { return 0; }
+		std::size_t num_records() const { return m.size(); }
+
+		// debugging
+		void dump();
+		bool disable_rebuilds;
+		bool check_ordering() { return true; }
+};
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+class sorted_array : public Stats {
+	private:
+		using optype = perf::optype;
+		using enum perf::optype;
+
+		struct record_t {
+			K key;
+			V value;
+		};
+
+		std::vector<record_t> table;    // sorted
+		std::vector<bool> dead;         // removed from table
+		std::vector<record_t> pending;  // sorted, not yet merged
+
+		uint32_t buckets;
+		uint32_t records;
+		uint32_t tombs;
+		int rebuild_window;
+
+		int prime_index;
+		double max_load_factor;
+
+		// most inserts the side array takes before it is merged
+		// whether or not the tester rebuilds
+		static const int max_pending = 4096;
+
+		bool search(const std::vector<record_t> &v, K k, uint32_t *slot,
+		            uint64_t *steps) const;
+		bool probe(K k, uint32_t *slot, bool *in_table,
+		           optype operation);
+		void merge();
+
+		void reset_rebuild_window();
+
+	public:
+		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
+
+		sorted_array(uint32_t b);
+		std::string table_type() const { return "sorted_array"; }
+
+		void resize(uint32_t);
+		void set_max_load_factor(double f) { max_load_factor = f; }
+
+		result insert(K key, V value, bool rebuilding = false);
+		bool query(K key, V *value);
+		result remove(K key);
+		void rebuild();
+
+		// runs of live records between dead ones, and binary search
+		// steps to each record in the sorted array
+		void cluster_len(std::map<int,int> *clust) const;
+		void search_distance(std::map<int,int> *disp) const;
+
+		int get_rebuild_window() const { return rebuild_window; }
+		double load_factor() const { return (double)records/buckets; }
+		std::size_t table_size() const { return buckets; }
+		std::size_t table_size_bytes() const {
+			return (table.capacity() + pending.capacity())
+			       * sizeof(record_t) + dead.capacity()/8;
+		}
+		std::size_t rec_width() const { return sizeof(record_t); }
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		std::size_t state_width() const { return 0; }
+		std::size_t num_records() const { return records; }
+
+		// debugging
+		void dump();
+		bool disable_rebuilds;
+		bool check_ordering();
+};
+#endif
@@ -0,0 +1,139 @@
+#ifndef FUNNEL_H
+#define FUNNEL_H
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <map>
+#include "perfstats.h"
+
+// funnel hashing (Farach-Colton, Krapivin, Kuszmaul, "Optimal Bounds for
+// Open Addressing Without Reordering", 2025).
+//
+// the slots are cut into levels A1, A2, ... of buckets of beta slots,
+// each level 3/4 the size of the one before, plus a small special array
+// at the end.  a key has one bucket per level (its own hash per level)
+// and goes into the first free slot of the first of them that has one;
+// keys that fall through every level go to the special array: first a
+// few single slots (uniform probing, log log n tries), then the less
+// full of two buckets of 2 log log n slots.  nothing is ever moved once
+// placed, and the expected probes per insert stay O(log^2 1/delta) up
+// to a load of 1 - delta, where linear probing is at O(1/delta^2).
+//
+// beta is 16 (the paper's 2 log2(1/delta) for delta = 1/256, and two
+// cache lines of 32 bit records); the special array is about 1/512 of
+// the table.  past x = 256 more keys reach the special array, which is
+// why it is sized for x = 1000.  should a key find no free slot on its
+// whole sequence, it takes the first free slot of the table after the
+// special array starts (counted in 'overflow'; searches then keep going
+// there too), so inserts never fail short of a full table.
+//
+// a search stops at the first bucket (or slot) on the sequence with an
+// empty slot, since the key would have gone there.  a remove leaves a
+// tombstone, which inserts reuse; rebuild() rehashes them away (if there
+// are any), on the same window as linear_aos.  misses count every slot read but the hit.
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+class funnel_aos : public Stats {
+	private:
+		enum slot_state : uint8_t { EMPTY, FULL, DELETED };
+		using optype = perf::optype;
+		using enum perf::optype;
+
+		static const uint32_t beta = 16;
+
+		struct record_t {
+			K key;
+			V value;
+		} *table;
+		uint8_t *states;
+
+		struct level_t {
+			uint32_t first;         // slot
+			uint32_t nbuckets;
+		};
+		std::vector<level_t> levels;
+		uint32_t special;               // first slot of the special array
+		uint32_t uniform_len;           // its uniform probing part
+		uint32_t uniform_probes;
+		uint32_t choice_first;          // then buckets for two choices
+		uint32_t choice_size;
+		uint32_t choice_buckets;
+		uint32_t overflow;
+
+		uint32_t buckets;
+		uint32_t records;
+		uint32_t tombs;
+		int rebuild_window;
+
+		int prime_index;
+		double max_load_factor;
+
+		static uint64_t hash(K k, uint32_t i);
+		static inline uint32_t reduce(uint64_t h, uint32_t m) {
+			return (uint32_t)(((h >> 32) * m) >> 32);
+		}
+		void allocate(uint32_t b);
+		bool find(K k, bool inserting, uint32_t *slot, uint32_t *free,
+		          uint32_t *step, uint64_t *miss) const;
+		bool probe(K k, uint32_t *slot, uint32_t *free, uint32_t *step,
+		           optype operation);
+
+		void reset_rebuild_window();
+		uint32_t overflow_step() const {
+			return levels.size() + uniform_probes + 2;
+		}
+
+		inline K& key(uint32_t k) const {
+			return table[k].key;
+		}
+		inline V& value(uint32_t k) const {
+			return table[k].value;
+		}
+		inline bool full(uint32_t k) const { return states[k] == FULL; }
+		inline bool empty(uint32_t k) const { return states[k] == EMPTY; }
+		inline bool tomb(uint32_t k) const { return states[k] == DELETED; }
+
+	public:
+		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
+
+		funnel_aos(uint32_t b);
+		~funnel_aos();
+		std::string table_type() const { return "funnel_aos"; }
+
+		void resize(uint32_t);
+		void set_max_load_factor(double f) { max_load_factor = f; }
+
+		result insert(K key, V value, bool rebuilding = false);
+		bool query(K key, V *value);
+		result remove(K key);
+		void rebuild();
+
+		// runs of full slots, and how far down its sequence (levels,
+		// then the special array's steps) each record is
+		void cluster_len(std::map<int,int> *clust) const;
+		void search_distance(std::map<int,int> *disp) const;
+
+		int get_rebuild_window() const { return rebuild_window; }
+		double load_factor() const { return (double)records/buckets; }
+		std::size_t table_size() const { return buckets; }
+		std::size_t table_size_bytes() const {
+			return buckets*(sizeof(record_t) + 1);
+		}
+		std::size_t rec_width() const { return sizeof(record_t); }
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		std::size_t state_width() const { return 1; }
+		std::size_t num_records() const { return records; }
+
+		// debugging
+		void dump();
+		bool disable_rebuilds;
+		bool check_ordering();
+};
+#endif
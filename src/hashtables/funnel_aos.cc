@@ -0,0 +1,418 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include "funnel.h"
+#include "primes.h"
+#include "wide.h"
+
+using std::cerr, std::size_t;
+
+template class funnel_aos<>;
+template class funnel_aos<uint32_t, uint32_t, CheapCounters>;
+template class funnel_aos<uint32_t, uint32_t, ProbeHistograms>;
+template class funnel_aos<uint32_t, uint32_t, NoStats>;
+template class funnel_aos<uint32_t, uint64_t>;
+template class funnel_aos<uint64_t, uint32_t>;
+template class funnel_aos<uint64_t, uint64_t>;
+template class funnel_aos<key64, uint32_t>;
+template class funnel_aos<key64, uint64_t>;
+template class funnel_aos<uint32_t, blob<32>>;
+template class funnel_aos<uint32_t, blob<64>>;
+template class funnel_aos<uint32_t, blob<128>>;
+template class funnel_aos<key64, blob<32>>;
+template class funnel_aos<key64, blob<64>>;
+template class funnel_aos<key64, blob<128>>;
+template class funnel_aos<key128, uint32_t>;
+template class funnel_aos<key128, uint64_t>;
+template class funnel_aos<key128, blob<32>>;
+template class funnel_aos<key128, blob<64>>;
+template class funnel_aos<key128, blob<128>>;
+
+template <typename K, typename V, typename Stats>
+funnel_aos<K, V, Stats>::funnel_aos(uint32_t b)
+{
+	prime_index = 0;
+	while(b > primes[prime_index])
+		prime_index++;
+
+	allocate(b);
+	records = 0;
+	tombs = 0;
+	overflow = 0;
+	max_load_factor = 0.5;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+	disable_rebuilds = false;
+}
+
+template <typename K, typename V, typename Stats>
+funnel_aos<K, V, Stats>::~funnel_aos()
+{
+	delete[] table;
+	delete[] states;
+}
+
+// the i'th hash of k (splitmix64's finalizer), one per step of the
+// sequence
+template <typename K, typename V, typename Stats>
+uint64_t
+funnel_aos<K, V, Stats>::hash(K k, uint32_t i)
+{
+	uint64_t x = fold(k) + (i + 1) * 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+// levels of beta slot buckets, each 3/4 the one before, from a quarter of
+// the slots left after the special array down to one bucket; what the
+// rounding leaves over goes to the special array too
+template <typename K, typename V, typename Stats>
+void
+funnel_aos<K, V, Stats>::allocate(uint32_t b)
+{
+	uint32_t lg = 32 - __builtin_clz(b | 1), lglg = 1;
+	while ((1u << lglg) < lg) ++lglg;
+
+	buckets = b;
+	uint32_t main = b - std::min(b, std::max(b / 512, 6*lglg));
+
+	levels.clear();
+	special = 0;
+	for (uint32_t size = main/4 / beta * beta; size;
+	     size = size*3/4 / beta * beta) {
+		levels.push_back(level_t{ special, size / beta });
+		special += size;
+	}
+
+	uniform_probes = lglg;
+	uniform_len = std::max((b - special) / 2, 1u);
+	choice_first = special + uniform_len;
+	choice_size = 2*lglg;
+	choice_buckets = (b - choice_first) / choice_size;
+
+	table = new record_t[b];
+	states = new uint8_t[b];
+	if (!table || !states) {
+		cerr << "Couldn't allocate\n";
+		exit(1);
+	}
+	memset(states, EMPTY, b);
+}
+
+template <typename K, typename V, typename Stats>
+void
+funnel_aos<K, V, Stats>::resize(uint32_t b)
+{
+	uint32_t oldbuckets = buckets;
+	record_t *oldtable = table;
+	uint8_t *oldstates = states;
+
+	allocate(b);
+	records = 0;
+	tombs = 0;
+	overflow = 0;
+
+	for(uint32_t i=0; i<oldbuckets; ++i)
+		if (oldstates[i] == FULL)
+			insert(oldtable[i].key, oldtable[i].value, true);
+
+	delete[] oldtable;
+	delete[] oldstates;
+	this->count_resize();
+}
+
+// walk k's sequence: its bucket on each level, the uniform probes, then
+// the two choice buckets, and past those the overflow scan if anything
+// ever overflowed (or, inserting, there was no free slot before).  if
+// found, *slot is k's slot; either way *free is the slot an insert would
+// take (buckets if none) and *step how far down the sequence k or that
+// slot is
+template <typename K, typename V, typename Stats>
+bool
+funnel_aos<K, V, Stats>::find(K k, bool inserting, uint32_t *slot,
+                              uint32_t *free, uint32_t *step,
+                              uint64_t *miss) const
+{
+	const uint32_t last = overflow_step();
+	uint32_t f = buckets, fstep = last, i = 0;
+	bool open = false;
+	uint32_t used;
+
+	// slots [a, a + len) up to the first empty one, which sets open;
+	// *fr is the first free slot there, used the full ones passed
+	auto scan = [&](uint32_t a, uint32_t len, uint32_t *fr) {
+		*fr = buckets;
+		used = 0;
+		for (uint32_t s = a; s < a + len; ++s) {
+			if (empty(s)) {
+				if (*fr == buckets) *fr = s;
+				open = true;
+				return false;
+			}
+			if (full(s)) {
+				if (key(s) == k) {
+					*slot = s;
+					return true;
+				}
+				++used;
+			} else if (*fr == buckets) {
+				*fr = s;
+			}
+			++*miss;
+		}
+		return false;
+	};
+	auto take = [&](uint32_t fr, uint32_t st) {
+		if (f == buckets && fr != buckets) {
+			f = fr;
+			fstep = st;
+		}
+	};
+
+	uint32_t fr;
+	for (; i < levels.size(); ++i) {
+		const level_t &l = levels[i];
+		if (scan(l.first + reduce(hash(k, i), l.nbuckets) * beta, beta,
+		         &fr))
+			goto found;
+		take(fr, i);
+		if (open) goto missing;
+	}
+	for (uint32_t j = 0; j < uniform_probes; ++j, ++i) {
+		if (scan(special + reduce(hash(k, i), uniform_len), 1, &fr))
+			goto found;
+		take(fr, i);
+		if (open) goto missing;
+	}
+	if (choice_buckets) {
+		uint32_t a0 = choice_first
+		              + reduce(hash(k, i), choice_buckets) * choice_size;
+		uint32_t a1 = choice_first
+		              + reduce(hash(k, i + 1), choice_buckets) * choice_size;
+		uint32_t f0, u0;
+		if (scan(a0, choice_size, &f0))
+			goto found;
+		u0 = used;
+		++i;
+		if (scan(a1, choice_size, &fr))
+			goto found;
+		// the less full of the two that has room
+		if (f0 != buckets && (fr == buckets || u0 <= used))
+			take(f0, i - 1);
+		else
+			take(fr, i);
+		if (open) goto missing;
+		++i;
+	}
+	i = last;
+
+	// the first free slot from the special array on, round the table
+	if (overflow || (inserting && f == buckets)) {
+		for (uint32_t n = 0, s = special; n < buckets; ++n) {
+			if (empty(s)) {
+				take(s, i);
+				break;
+			}
+			if (full(s)) {
+				if (key(s) == k) {
+					*slot = s;
+					goto found;
+				}
+			} else {
+				take(s, i);
+			}
+			++*miss;
+			if (++s == buckets) s = 0;
+		}
+	}
+
+missing:
+	*free = f;
+	*step = fstep;
+	return false;
+found:
+	*free = f;
+	*step = i;
+	return true;
+}
+
+template <typename K, typename V, typename Stats>
+bool
+funnel_aos<K, V, Stats>::probe(K k, uint32_t *slot, uint32_t *free,
+                               uint32_t *step, optype operation)
+{
+	uint64_t miss = 0;
+	bool res = find(k, operation == INSERT || operation == REBUILD_INS,
+	                slot, free, step, &miss);
+	this->record_probe(miss, operation);
+	return res;
+}
+
+template <typename K, typename V, typename Stats>
+funnel_aos<K, V, Stats>::result
+funnel_aos<K, V, Stats>::insert(K k, V v, bool rebuilding)
+{
+	uint32_t slot, free, step;
+	optype ins_type = rebuilding ? REBUILD_INS : INSERT;
+
+	if (records>=buckets) {
+		this->count_fail(INSERT);
+		return FULLTABLE;
+	}
+
+	if (probe(k, &slot, &free, &step, ins_type)) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return DUPLICATE;
+	}
+
+	if (step == overflow_step()) ++overflow;
+	if (tomb(free)) --tombs;
+	table[free] = record_t{ k, v };
+	states[free] = FULL;
+	++records;
+
+	this->count_shifts(0, ins_type);
+	this->count_op(ins_type);
+
+	// automatic resizing
+	if (load_factor() > max_load_factor) {
+		cerr << "load factor " << max_load_factor << " exceeded\n";
+		resize(primes[++prime_index]);
+	}
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return REBUILD;
+	}
+
+	return SUCCESS;
+}
+
+template <typename K, typename V, typename Stats>
+bool
+funnel_aos<K, V, Stats>::query(K k, V *v)
+{
+	uint32_t slot, free, step;
+	this->count_op(QUERY);
+
+	if (probe(k, &slot, &free, &step, QUERY)) {
+		*v = value(slot);
+		return true;
+	} else {
+		this->count_fail(QUERY);
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+funnel_aos<K, V, Stats>::result
+funnel_aos<K, V, Stats>::remove(K k)
+{
+	uint32_t slot, free, step;
+	this->count_op(REMOVE);
+
+	if (!probe(k, &slot, &free, &step, REMOVE)) {
+		this->count_fail(REMOVE);
+		return result::FAILURE;
+	}
+
+	if (step == overflow_step()) --overflow;
+	states[slot] = DELETED;
+	++tombs;
+	--records;
+	return result::SUCCESS;
+}
+
+template <typename K, typename V, typename Stats>
+void
+funnel_aos<K, V, Stats>::reset_rebuild_window()
+{
+	rebuild_window = buckets/2 * (1.0 - load_factor()) + 1;
+}
+
+template <typename K, typename V, typename Stats>
+void
+funnel_aos<K, V, Stats>::rebuild()
+{
+	// without tombstones a rehash would only shuffle the records
+	if (tombs)
+		resize(buckets);
+	reset_rebuild_window();
+	this->count_rebuild();
+}
+
+// fill in a histogram of runs of full slots
+template <typename K, typename V, typename Stats>
+void
+funnel_aos<K, V, Stats>::cluster_len(std::map<int,int> *clust) const
+{
+	int run = 0;
+	for (uint32_t p = 0; p < buckets; ++p) {
+		if (full(p)) {
+			++run;
+		} else if (run) {
+			(*clust)[run]++;
+			run = 0;
+		}
+	}
+	if (run) (*clust)[run]++;
+}
+
+template <typename K, typename V, typename Stats>
+void
+funnel_aos<K, V, Stats>::search_distance(std::map<int,int> *disp) const
+{
+	uint32_t slot, free, step;
+	uint64_t miss;
+	for (uint32_t p = 0; p < buckets; ++p)
+		if (full(p) && find(key(p), false, &slot, &free, &step, &miss))
+			(*disp)[step]++;
+}
+
+// every record is where its search finds it, and the counts add up
+template <typename K, typename V, typename Stats>
+bool
+funnel_aos<K, V, Stats>::check_ordering()
+{
+	uint32_t slot, free, step, n = 0, t = 0;
+	uint64_t miss;
+
+	for (uint32_t p = 0; p < buckets; ++p) {
+		if (tomb(p)) ++t;
+		if (!full(p)) continue;
+		++n;
+		if (!find(key(p), false, &slot, &free, &step, &miss) ||
+		    slot != p) {
+			cerr << "Record at slot " << p << " not found\n";
+			return false;
+		}
+	}
+	if (n != records || t != tombs) {
+		cerr << "Record counts are off\n";
+		return false;
+	}
+	return true;
+}
+
+template <typename K, typename V, typename Stats>
+void
+funnel_aos<K, V, Stats>::dump()
+{
+	size_t l = 0;
+	for(size_t i=0; i<buckets; i++) {
+		if (l < levels.size() && i == levels[l].first) {
+			std::cout << "\nlevel " << ++l << ":";
+		} else if (i == special) {
+			std::cout << "\nspecial:";
+		}
+		if (i % beta == 0) std::cout << "\n";
+		if (full(i))
+			std::cout << key(i) << ' ';
+		else
+			std::cout << (empty(i) ? "_ " : "x ");
+	}
+	std::cout << "\n";
+}
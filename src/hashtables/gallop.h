@@ -0,0 +1,61 @@
+#ifndef GALLOP_H
+#define GALLOP_H
+
+#include <cstdint>
+
+// the search ordered and graveyard probes switch to past gallop_after
+// slots of a cluster, written once for both.  the table hands in how to
+// read slot p: tomb(p), empty(p), and hash_at(p), the hash of the key
+// in a full slot p.
+//
+// from table_head on the full slots' hashes never go down, and an empty
+// slot only comes before records that hash past it, so "empty, or full
+// with a hash >= h" is false for every live slot before k's place and
+// true for every one from it on.  gallop from s to where it turns true,
+// reading 1, 2, 4, ... slots on, then binary search back, a read that
+// lands on a tombstone taking the next live slot.  every live slot
+// before the one returned is full with a hash below h, so the probe's
+// walk carries on from there.  stays short of end (the table's last
+// slot), leaving the wrap to the walk.  every slot read counts a miss.
+
+template <typename Tomb, typename Empty, typename HashAt>
+inline uint32_t
+gallop_search(uint32_t s, uint32_t end, uint32_t h, uint64_t *miss,
+              Tomb tomb, Empty empty, HashAt hash_at)
+{
+	// the first live slot at or after p
+	auto live = [&](uint32_t p) {
+		while (p < end && tomb(p)) {
+			++p;
+			++*miss;
+		}
+		return p;
+	};
+	auto past = [&](uint32_t p) {
+		++*miss;
+		return empty(p) || hash_at(p) >= h;
+	};
+
+	// the live slots in [s, lo) are all before k's place; the first
+	// live one at or after hi is not
+	uint32_t lo = s, hi;
+	for (uint64_t step = 1; ; step *= 2) {
+		if (step >= end - lo) return lo;
+		uint32_t p = live(lo + step);
+		if (p == end) return lo;
+		if (past(p)) {
+			hi = lo + step;
+			break;
+		}
+		lo = p + 1;
+	}
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		uint32_t p = live(mid);
+		if (past(p)) hi = mid;
+		else lo = p + 1;
+	}
+	return lo;
+}
+
+#endif
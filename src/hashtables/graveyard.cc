@@ -0,0 +1,644 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include "graveyard.h"
+#include "gallop.h"
+#include "primes.h"
+#include "wide.h"
+#include <boost/circular_buffer.hpp>
+
+using std::cerr, std::size_t;
+
+template class graveyard<uint32_t, uint32_t, FullStats, aos_layout>;
+template class graveyard<uint32_t, uint32_t, CheapCounters, aos_layout>;
+template class graveyard<uint32_t, uint32_t, ProbeHistograms, aos_layout>;
+template class graveyard<uint32_t, uint32_t, NoStats, aos_layout>;
+template class graveyard<uint32_t, int, FullStats, aos_layout>;
+template class graveyard<uint32_t, uint64_t, FullStats, aos_layout>;
+template class graveyard<uint64_t, uint32_t, FullStats, aos_layout>;
+template class graveyard<uint64_t, uint64_t, FullStats, aos_layout>;
+template class graveyard<key64, uint32_t, FullStats, aos_layout>;
+template class graveyard<key64, uint64_t, FullStats, aos_layout>;
+template class graveyard<uint32_t, blob<32>, FullStats, aos_layout>;
+template class graveyard<uint32_t, blob<64>, FullStats, aos_layout>;
+template class graveyard<uint32_t, blob<128>, FullStats, aos_layout>;
+template class graveyard<key64, blob<32>, FullStats, aos_layout>;
+template class graveyard<key64, blob<64>, FullStats, aos_layout>;
+template class graveyard<key64, blob<128>, FullStats, aos_layout>;
+template class graveyard<key128, uint32_t, FullStats, aos_layout>;
+template class graveyard<key128, uint64_t, FullStats, aos_layout>;
+template class graveyard<key128, blob<32>, FullStats, aos_layout>;
+template class graveyard<key128, blob<64>, FullStats, aos_layout>;
+template class graveyard<key128, blob<128>, FullStats, aos_layout>;
+
+template class graveyard<uint32_t, uint32_t, FullStats, soa_layout>;
+template class graveyard<uint32_t, uint32_t, CheapCounters, soa_layout>;
+template class graveyard<uint32_t, uint32_t, ProbeHistograms, soa_layout>;
+template class graveyard<uint32_t, uint32_t, NoStats, soa_layout>;
+template class graveyard<uint32_t, uint64_t, FullStats, soa_layout>;
+template class graveyard<uint64_t, uint32_t, FullStats, soa_layout>;
+template class graveyard<uint64_t, uint64_t, FullStats, soa_layout>;
+template class graveyard<key64, uint32_t, FullStats, soa_layout>;
+template class graveyard<key64, uint64_t, FullStats, soa_layout>;
+template class graveyard<uint32_t, blob<32>, FullStats, soa_layout>;
+template class graveyard<uint32_t, blob<64>, FullStats, soa_layout>;
+template class graveyard<uint32_t, blob<128>, FullStats, soa_layout>;
+template class graveyard<key64, blob<32>, FullStats, soa_layout>;
+template class graveyard<key64, blob<64>, FullStats, soa_layout>;
+template class graveyard<key64, blob<128>, FullStats, soa_layout>;
+template class graveyard<key128, uint32_t, FullStats, soa_layout>;
+template class graveyard<key128, uint64_t, FullStats, soa_layout>;
+template class graveyard<key128, blob<32>, FullStats, soa_layout>;
+template class graveyard<key128, blob<64>, FullStats, soa_layout>;
+template class graveyard<key128, blob<128>, FullStats, soa_layout>;
+
+template class graveyard<uint32_t, uint32_t, FullStats, aosoa_layout>;
+template class graveyard<uint32_t, uint32_t, CheapCounters, aosoa_layout>;
+template class graveyard<uint32_t, uint32_t, ProbeHistograms, aosoa_layout>;
+template class graveyard<uint32_t, uint32_t, NoStats, aosoa_layout>;
+template class graveyard<uint32_t, uint64_t, FullStats, aosoa_layout>;
+template class graveyard<uint64_t, uint32_t, FullStats, aosoa_layout>;
+template class graveyard<uint64_t, uint64_t, FullStats, aosoa_layout>;
+template class graveyard<key64, uint32_t, FullStats, aosoa_layout>;
+template class graveyard<key64, uint64_t, FullStats, aosoa_layout>;
+template class graveyard<uint32_t, blob<32>, FullStats, aosoa_layout>;
+template class graveyard<uint32_t, blob<64>, FullStats, aosoa_layout>;
+template class graveyard<uint32_t, blob<128>, FullStats, aosoa_layout>;
+template class graveyard<key64, blob<32>, FullStats, aosoa_layout>;
+template class graveyard<key64, blob<64>, FullStats, aosoa_layout>;
+template class graveyard<key64, blob<128>, FullStats, aosoa_layout>;
+template class graveyard<key128, uint32_t, FullStats, aosoa_layout>;
+template class graveyard<key128, uint64_t, FullStats, aosoa_layout>;
+template class graveyard<key128, blob<32>, FullStats, aosoa_layout>;
+template class graveyard<key128, blob<64>, FullStats, aosoa_layout>;
+template class graveyard<key128, blob<128>, FullStats, aosoa_layout>;
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+graveyard<K, V, Stats, L>::graveyard(uint32_t b)
+{
+	prime_index = 0;
+	while(b > primes[prime_index])
+		prime_index++;
+
+	allocate(b);
+	max_load_factor = 0.5;
+	gallop_after = 16;
+	records = 0;
+	tombs = 0;
+	table_head = 0;
+	disable_rebuilds = false;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+graveyard<K, V, Stats, L>::~graveyard()
+{
+	table.release();
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+uint32_t
+graveyard<K, V, Stats, L>::hash(K k) const
+{
+	return fastrange(k, buckets);
+}
+
+// a table of b empty slots
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+graveyard<K, V, Stats, L>::allocate(uint32_t b)
+{
+	table.allocate(b);
+	for(uint32_t i=0; i<b; i++)
+		setempty(i);
+	buckets = b;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+graveyard<K, V, Stats, L>::resize(uint32_t b)
+{
+	uint32_t oldbuckets = buckets;
+	L<K, V, slot_state> oldtable = table;
+
+	cerr << "resize(): rehashing into " << b << " buckets\n";
+	snap.touch_all();
+
+	allocate(b);
+	records = 0;
+	tombs = 0;
+
+	for(uint32_t i=0; i<oldbuckets; ++i)
+		if (oldtable.state(i) == FULL)
+			insert(oldtable.key(i), oldtable.value(i), true);
+
+	oldtable.release();
+	this->count_resize();
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+graveyard<K, V, Stats, L>::probe(K k, uint32_t *slot, optype operation, bool* wrapped)
+{
+	const uint32_t h = hash(k);
+	uint64_t miss = 0;
+	bool res = false;
+	uint32_t s = std::max(h, table_head);
+
+	switch(operation) {
+	case INSERT:
+	case REBUILD_INS:
+		res = true;
+		while(1) {
+			if (full(s) && key(s) == k) {	// duplicate key
+				res = false;
+				break;
+			}
+			if (empty(s) || (full(s) && hash(key(s)) >= h)) break;
+			if (++s == buckets) {
+				s = 0;
+				*wrapped = true;
+			}
+			++miss;
+			if (s == table_head) break;
+			if (miss == gallop_after && s > table_head)
+				s = gallop(s, h, &miss);
+		}
+		break;
+	case QUERY:
+	case REMOVE:
+		res = false;
+		while(1) {
+			if (full(s) && key(s) == k) {
+				res = true;
+				break;
+			}
+			if (empty(s) || (full(s) && hash(key(s)) > h)) break;
+			if (++s == buckets) s = 0;
+			++miss;
+			if (s == table_head) break;
+			if (miss == gallop_after && s > table_head)
+				s = gallop(s, h, &miss);
+		}
+		break;
+	}
+
+	this->record_probe(miss, operation);
+	*slot = s;
+	return res;
+}
+
+// probe()'s walk past gallop_after slots: the shared search (gallop.h)
+// on this table's slots
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+uint32_t graveyard<K, V, Stats, L>::
+gallop(uint32_t s, uint32_t h, uint64_t *miss) const
+{
+	return gallop_search(s, buckets - 1, h, miss,
+	    [this](uint32_t p) { return tomb(p); },
+	    [this](uint32_t p) { return empty(p); },
+	    [this](uint32_t p) { return hash(key(p)); });
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+inline void
+graveyard<K, V, Stats, L>::slotmove(uint32_t destidx, uint32_t srcidx, size_t count)
+{
+	snap.touch(destidx, count);
+	table.move(destidx, srcidx, count);
+}
+
+// find the end of the cluster, then slide records 1 to the right as a block
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+uint32_t
+graveyard<K, V, Stats, L>::shift(uint32_t start)
+{
+	const uint32_t last = buckets-1;
+	uint32_t end = start;
+
+	do
+		if (++end > last) end = 0;
+	while (full(end));
+
+	if (tomb(end)) --tombs; // made use of a tombstone
+
+	if (end < start) {
+		slotmove(1, 0, end);
+		slotmove(0, last, 1);
+		slotmove(start+1, start, last-start);
+	} else
+		slotmove(start+1, start, end-start);
+
+	return end;
+}
+
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+int
+graveyard<K, V, Stats, L>::rebuild_seek(uint32_t x, uint32_t &end)
+{
+	const uint32_t last = buckets-1;
+	while(1) {
+		if (x > last) {
+			end = last;
+			return 2;       // shift into the end of the table
+		} else if (empty(x)) {
+			end = x;
+			return 0;       // shift into an empty slot
+		} else if (tomb(x)) {
+			end = x-1;
+			return 1;       // shift into a tombstone
+		}
+		++x;
+	}
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+uint32_t
+graveyard<K, V, Stats, L>::rebuild_shift(uint32_t start)
+{
+	record_t lastscratch{}, scratch;
+	bool valid = false;
+	uint32_t end;
+
+	while(1) {
+		int res = rebuild_seek(start, end);
+
+		scratch = get(end);
+		slotmove(start+1, start, end-start);
+		if (valid) {
+			put(start, lastscratch);
+		}
+		lastscratch = scratch;
+		valid = true;
+
+		if (res == 0) return end;
+		start = end + 2;
+		if (res == 2 || (res == 1 && start > buckets-1)) {
+			end = rebuild_shift(0);
+			put(0, lastscratch);
+			return end;
+		}
+	}
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+graveyard<K, V, Stats, L>::result
+graveyard<K, V, Stats, L>::insert(K k, V v, bool rebuilding)
+{
+	uint32_t slot;
+	bool wrapped=false;
+
+	if (records>=buckets) {
+		this->count_fail(INSERT);
+		return result::FULLTABLE;
+	}
+
+	optype ins_type = rebuilding ? optype::REBUILD_INS : optype::INSERT;
+	if (!probe(k, &slot, ins_type, &wrapped)) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return result::DUPLICATE;
+	}
+
+	if (!empty(slot)) {
+		uint32_t end;
+		end = (!rebuilding) ? shift(slot) : rebuild_shift(slot);
+		if ((end < slot || wrapped) && end >= table_head)
+			++table_head;
+		if (end >= slot)
+			this->count_shifts(end - slot, ins_type);
+		else
+			this->count_shifts(buckets - slot + end, ins_type);
+	} else {
+		this->count_shifts(0, ins_type);
+		if (wrapped && slot == table_head) table_head++;
+	}
+
+	if (rebuilding && tomb(table_head)) ++table_head;
+	snap.touch(slot, 1);
+	setkey(slot, k);
+	setvalue(slot, v);
+	setfull(slot);
+
+	// more stat recording
+	++records;
+	this->count_op(rebuilding ? REBUILD_INS : INSERT);
+
+	// automatic resizing
+	if (load_factor() > max_load_factor) {
+		cerr << "load factor " << max_load_factor << " exceeded\n";
+		resize(primes[++prime_index]);
+	}
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return result::REBUILD;
+	}
+
+	return result::SUCCESS;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+graveyard<K, V, Stats, L>::query(K k, V *v)
+{
+	uint32_t slot;
+	this->count_op(QUERY);
+
+	if (probe(k, &slot, QUERY)) {
+		*v = value(slot);
+		return true;
+	}
+
+	this->count_fail(QUERY);
+	return false;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+graveyard<K, V, Stats, L>::result
+graveyard<K, V, Stats, L>::remove(K k)
+{
+	uint32_t slot;
+	this->count_op(REMOVE);
+
+	if (probe(k, &slot, REMOVE)) {
+		snap.touch(slot, 1);
+		settomb(slot);
+		++tombs;
+		--records;
+		--rebuild_window;
+		if(rebuild_window > 0)
+			return result::SUCCESS;
+		else
+			return result::REBUILD;
+	}
+
+	this->count_fail(REMOVE);
+	return result::FAILURE;
+}
+
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+graveyard<K, V, Stats, L>::reset_rebuild_window()
+{
+	rebuild_window = buckets/4.0 * (1.0 - load_factor()); // 1-a = 1/x
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+graveyard<K, V, Stats, L>::rebuild()
+{
+	int tombcount = (buckets/2) * (1.0 - load_factor()); // 1-a = 1/x
+	double interval = tombcount ? (buckets / tombcount) : buckets;
+
+	snap.touch_all();
+
+	// save the part of the table that wrapped for reinsertion later.
+	// all of it turns to tombstones, the empty slots too: the head
+	// goes back to 0, and the pass below has to pull the records at
+	// the old head down over any gap left under it
+	std::vector<record_t> overflow;
+	for(uint32_t p = 0; p < table_head; ++p) {
+		if (full(p)) {
+			overflow.push_back(get(p));
+			--records;
+		}
+		settomb(p);
+	}
+	table_head = 0;
+	tombs = 0;
+
+	boost::circular_buffer<record_t> queue(tombcount);
+	for(uint32_t p = 0, q = 1, x = interval; p < buckets; p++) {
+		if (--x == 0) {
+			if (full(p)) queue.push_back(get(p));
+			this->rebuild_queue((int)queue.size());
+			settomb(p);
+			++tombs;
+			x = interval;
+		} else {
+			if (queue.empty()) {
+				if (tomb(p)) {
+					while(q < buckets && !full(q)) q++;
+					if (q < buckets) {
+						if (hash(key(q)) > p)
+							setempty(p);
+						else {
+							slotmove(p, q, 1);
+							settomb(q);
+							++tombs;
+						}
+					} else
+						setempty(p);
+				}
+			} else {
+				if (full(p)) queue.push_back(get(p));
+				put(p, queue.front());
+				queue.pop_front();
+			}
+		}
+		if (q <= p) q = p + 1;
+	}
+
+	records -= queue.size(); // these records would be double counted
+	for (record_t r : queue) insert(r.key, r.value, true);
+
+	for (record_t r : overflow) insert(r.key, r.value, true);
+	reset_rebuild_window();
+	this->count_rebuild();
+}
+
+// write the header and the layout's arrays.  runs in the forked child,
+// which sees the table exactly as it was when snapshot() was called
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+graveyard<K, V, Stats, L>::snapshot(const std::string &path)
+{
+	return snap.begin(path, buckets, table.rec_width(), [this](int fd) {
+		snapshot_header h = {};
+		std::strncpy(h.magic, "LPSNAP1", sizeof(h.magic));
+		std::strncpy(h.type, table_type().c_str(), sizeof(h.type)-1);
+		h.buckets = buckets;
+		h.records = records;
+		h.table_head = table_head;
+		h.rec_width = table.rec_width();
+		h.state_width = table.state_width();
+
+		return write_all(fd, &h, sizeof(h))
+		    && table.arrays(buckets, [fd](const void *p, size_t n) {
+			return write_all(fd, p, n);
+		});
+	});
+}
+
+// fill in a histogram of cluster lengths (tombstones count as boundaries)
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+graveyard<K, V, Stats, L>::cluster_len(std::map<int,int> *clust) const
+{
+	uint32_t last_empty, last_tomb;
+	last_empty = last_tomb = table_head;
+	for(uint32_t p = table_head; p < buckets; ++p) {
+		if (!full(p)) {
+			int dist = std::min(p - last_empty, p - last_tomb);
+			if (dist > 1) (*clust)[dist-1]++;
+			if (empty(p)) last_empty = p;
+			if (tomb(p)) last_tomb = p;
+		}
+	}
+
+	// keep counting once we wrap the table
+	for(uint32_t p = 0; p < table_head; ++p) {
+		if (!full(p)) {
+			// detect if the cluster wrapped
+			int x = last_empty >= table_head ?
+			        (buckets - last_empty + p) : (p - last_empty);
+			int y = last_tomb >= table_head ?
+			        (buckets - last_tomb + p) : (p - last_tomb);
+			int dist = std::min(x, y);
+			if (dist > 1) (*clust)[dist-1]++;
+			if (empty(p)) last_empty = p;
+			if (tomb(p)) last_tomb = p;
+		}
+	}
+}
+
+// fill in a histogram of shift lengths
+// i.e. the distance from a key's slot and the hash of that key
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+graveyard<K, V, Stats, L>::search_distance(std::map<int,int> *disp) const
+{
+	for(uint32_t p = 0; p < buckets; ++p) {
+		if (full(p)) {
+			uint32_t h = hash(key(p));
+			int d = (p >= table_head ? p - h : buckets - h + p);
+			if (d < 0)
+				std::cerr << "Negative search distance at slot "
+				          << p << "!\n";
+			(*disp)[d]++;
+		}
+	 }
+}
+
+// ensure keys are monotonically increasing
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+graveyard<K, V, Stats, L>::check_ordering()
+{
+	uint32_t p = table_head, q;
+	bool wrapped = false, res = true;
+
+	while (!full(p)) ++p;
+	q = p;
+	while(1) {
+		do {
+			if (++q == buckets) {
+				q = 0;
+				wrapped = true;
+			}
+		} while (!full(q));
+
+		if (wrapped && q >= table_head) break;
+
+		if (hash(key(p)) > hash(key(q))) {
+			std::cerr << "Ordering violated at slot " << q << "\n";
+			res = false;
+		}
+
+		p = q;
+	}
+
+	return res;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+graveyard<K, V, Stats, L>::debug_key_search(K k)
+{
+	uint32_t x, b;
+	bool found = false;
+
+	for(uint32_t i=0; i<buckets; i++)
+		if (key(i) == k) {
+			x = i;
+			uint32_t j = i;
+			while (!empty(j)) j--;
+			b = j;
+			found = true;
+			break;
+		}
+
+	if (found) {
+		std::cerr << "found it in slot " << x << "!\n";
+		if (tomb(x)) {
+			std::cerr << "it is marked as a tombstone\n";
+		} else if (empty(x)) {
+			std::cerr << "it is marked empty\n";
+		}
+		std::cerr << "empty before it: " << b << ".\n";
+		std::cerr << "actual hash " << hash(k) << "\n";
+		std::cerr << "table head: " << table_head << "\n";
+	} else
+		std::cerr << "it's not actually in the table\n";
+
+	if (!check_ordering())
+		std::cerr << "Ordering was violated\n";
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+graveyard<K, V, Stats, L>::dump()
+{
+	for(uint32_t i=0; i<buckets; i++) {
+		if ((i!=0) && (i%10 == 0)) std::cout << "\n";
+		std::cout.width(4);
+		std::cout << i << ':';
+
+		if (tomb(i)) std::cout << "\e[1;31m";
+		if (i==table_head)
+			std::cout << "\033[0;22m*\033[0m[";
+		else
+			std::cout << " [";
+
+		if(full(i)) {
+			std::cout.width(4);
+			std::cout << hash(key(i)) << "]";
+			std::cout.width(4);
+			std::cout << key(i);
+		} else if (empty(i)) {
+			std::cout << "    ]    ";
+		} else {
+			std::cout.width(4);
+			std::cout << "____]";
+			std::cout << "____";
+		}
+		if (tomb(i)) std::cout << "\e[0m";
+	}
+}
@@ -6,19 +6,31 @@
 #include <iostream>
 #include <vector>
 #include <map>
-
-template <typename K = uint32_t,
-          typename V = uint32_t>
-class graveyard_aos {
+#include "perfstats.h"
+#include "layout.h"
+#include "snapshot.h"
+
+// graveyard hashing, once for every slot layout (layout.h):
+// graveyard_aos, graveyard_soa and graveyard_aosoa below.
+
+template <typename K,
+          typename V,
+          typename Stats,
+          template <typename, typename, typename> class Layout>
+class graveyard : public Stats {
 	private:
 		enum slot_state { FULL, EMPTY, TOMB };
-		enum optype { INSERT, QUERY, REMOVE, REBUILD_INS };
+		using optype = perf::optype;
+		using enum perf::optype;
+
+		Layout<K, V, slot_state> table;
 
+		// a slot taken out of the table, for rebuild()'s queues
 		struct record_t {
 			K key;
 			V value;
-		} *table;
-		enum slot_state *states;
+			slot_state state;
+		};
 
 		uint32_t buckets;
 		uint32_t records;
@@ -28,40 +40,50 @@ class graveyard_aos {
 
 		int prime_index;
 		double max_load_factor;
+		uint32_t gallop_after;
 
-		uint64_t search_count;
-		double miss_running_avg;
+		snapshotter snap;
 
-		uint32_t hash(uint32_t k) const;
+		uint32_t hash(K k) const;
 		bool probe(K k, uint32_t *slot, optype operation,
 		           bool* wrapped = NULL);
+		uint32_t gallop(uint32_t s, uint32_t h, uint64_t *miss) const;
 		uint32_t shift(uint32_t slot);
 		int rebuild_seek(uint32_t x, uint32_t &end);
 		uint32_t rebuild_shift(uint32_t slot);
+		void allocate(uint32_t b);
 		inline void slotmove(uint32_t destidx, uint32_t srcidx,
-		     size_t count);
+		                     size_t count);
 
 		void reset_rebuild_window();
-		void update_misses(uint64_t misses, enum optype op);
 
-		inline slot_state& state(uint32_t k) const {
-			return states[k];
+		inline slot_state state(uint32_t k) const {
+			return table.state(k);
 		}
 		inline K& key(uint32_t k) const {
-			return table[k].key;
+			return table.key(k);
 		}
 		inline V& value(uint32_t k) const {
-			return table[k].value;
+			return table.value(k);
 		}
 
 		inline void setkey(uint32_t k, K x)
-			{ table[k].key = x; }
+			{ table.key(k) = x; }
 		inline void setvalue(uint32_t k, V v)
-			{ table[k].value = v; }
+			{ table.value(k) = v; }
+
+		inline void setfull(uint32_t k) { table.state(k) = FULL; }
+		inline void setempty(uint32_t k) { table.state(k) = EMPTY; }
+		inline void settomb(uint32_t k) { table.state(k) = TOMB; }
 
-		inline void setfull(uint32_t k) { states[k] = FULL; }
-		inline void setempty(uint32_t k) { states[k] = EMPTY; }
-		inline void settomb(uint32_t k) { states[k] = TOMB; }
+		inline record_t get(uint32_t k) const {
+			return { key(k), value(k), state(k) };
+		}
+		inline void put(uint32_t k, const record_t &r) {
+			setkey(k, r.key);
+			setvalue(k, r.value);
+			table.state(k) = r.state;
+		}
 
 		inline bool full(uint32_t k) const {
 			return state(k) == FULL;
@@ -75,49 +97,52 @@ class graveyard_aos {
 
 	public:
 		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
-
-		graveyard_aos(uint32_t b);
-		~graveyard_aos();
-		std::string table_type() const { return "graveyard_aos"; }
+		using key_type = K;
+		using value_type = V;
+
+		graveyard(uint32_t b);
+		~graveyard();
+		std::string table_type() const {
+			return std::string("graveyard_")
+			       + Layout<K, V, slot_state>::name;
+		}
 
 		void resize(uint32_t);
 		void set_max_load_factor(double f) { max_load_factor = f; }
+		// slots probe() walks before it gallops; 0 never does
+		void set_gallop_after(uint32_t n) { gallop_after = n; }
 
 		result insert(K key, V value, bool rebuilding = false);
 		bool query(K key, V *value);
 		result remove(K key);
 		void rebuild();
 
-		// Performance characteristics
-		uint64_t total_misses;
-		uint64_t inserts, queries, removes, duplicates;
-		uint64_t insert_misses, query_misses, remove_misses;
-		uint64_t rebuild_inserts, rebuild_insert_misses;
-		uint64_t failed_inserts, failed_queries, failed_removes;
-		uint64_t resizes, rebuilds;
-		uint64_t insert_shifts, longest_search;
-		int max_rebuild_queue;
-
-		void reset_perf_counts();
-		void report_testing_stats(std::ostream &os = std::cout,
-		                          bool verbose = true);
-
 		// return cluster length data, with clusters bounded either by
 		// empty slots or by tombstones
 		void cluster_len(std::map<int, int>*) const;
 		void search_distance(std::map<int, int>*) const;
 
+		// background snapshots: fork a child that writes the table
+		// to path while this table keeps taking operations
+		bool snapshot(const std::string &path);
+		bool snapshot_poll() { return snap.poll(); }
+		bool snapshot_wait() { return snap.wait(); }
+		bool snapshot_active() const { return snap.active(); }
+		uint64_t snapshot_dirty_regions() const {
+			return snap.dirty_regions;
+		}
+		uint64_t snapshot_regions() const { return snap.total_regions; }
+
 		int get_rebuild_window() const { return rebuild_window; }
 		double load_factor() const { return (double)records/buckets; }
-		double avg_misses() const { return miss_running_avg; }
 		uint32_t table_size() const { return buckets; }
 		std::size_t table_size_bytes() const {
-			return buckets*sizeof(record_t);
+			return table.bytes(buckets);
 		}
-		std::size_t rec_width() const { return sizeof(table[0]); }
-		std::size_t key_width() const { return sizeof(table[0].key); }
-		std::size_t value_width() const { return sizeof(table[0].value); }
-		std::size_t state_width() const { return sizeof(states[0]); }
+		std::size_t rec_width() const { return table.rec_width(); }
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		std::size_t state_width() const { return table.state_width(); }
 		uint32_t num_records() const { return records; }
 
 		// debugging
@@ -128,23 +153,60 @@ class graveyard_aos {
 };
 
 template <typename K = uint32_t,
-          typename V = uint32_t>
-class graveyard_soa {
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using graveyard_aos = graveyard<K, V, Stats, aos_layout>;
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using graveyard_soa = graveyard<K, V, Stats, soa_layout>;
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using graveyard_aosoa = graveyard<K, V, Stats, aosoa_layout>;
+
+// graveyard hashing on cache line blocks.
+//
+// the same table as graveyard_aos, slot for slot, stored as 64 byte
+// blocks: an 8 byte header (full and tombstone bitmaps, and top, an upper
+// bound on the hashes of the block's records) then as many records as
+// fit, 7 of 32+32 bits.  a probe entering a block with no empty slot and
+// top below the hash it wants skips the whole block on its header, and
+// otherwise reads states from the bitmaps in the line it already has,
+// where graveyard_soa reads a separate state array.  records move right
+// a block at a time on a shift, the one that crosses into the next block
+// raising its top; rebuild() puts its tombstones at the ends of blocks,
+// as many per block as graveyard_aos's interval works out to, and
+// recomputes every top.
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+class graveyard_bkt : public Stats {
 	private:
 		enum slot_state { FULL, EMPTY, TOMB };
-		enum optype { INSERT, QUERY, REMOVE, REBUILD_INS };
+		using optype = perf::optype;
+		using enum perf::optype;
 
 		struct record_t {
 			K key;
 			V value;
-			slot_state state;
 		};
 
-		struct table_t {
-			K *key;
-			V *value;
-			slot_state *state;
-		} table;
+		static const uint32_t line = 64;
+		static const uint32_t per_block =
+		    sizeof(record_t) < line - 8 ?
+		    (line - 8) / sizeof(record_t) : 1;
+
+		struct alignas(line) block_t {
+			uint16_t full;
+			uint16_t tomb;
+			uint32_t top;
+			record_t rec[per_block];
+		} *blocks;
+		uint32_t nblocks;
 
 		uint32_t buckets;
 		uint32_t records;
@@ -155,56 +217,74 @@ class graveyard_soa {
 		int prime_index;
 		double max_load_factor;
 
-		uint64_t search_count;
-		double miss_running_avg;
-
 		uint32_t hash(K k) const;
+		void allocate(uint32_t b);
+		bool skip(uint32_t s, uint32_t h) const;
 		bool probe(K k, uint32_t *slot, optype operation,
 		           bool* wrapped = NULL);
 		uint32_t shift(uint32_t slot);
-		int rebuild_seek(uint32_t x, uint32_t &end);
+		int rebuild_seek(uint32_t x, uint32_t &end, uint32_t &next);
 		uint32_t rebuild_shift(uint32_t slot);
-		inline void slotmove(uint32_t destidx, uint32_t srcidx,
-		                     size_t count);
+		void slotmove(uint32_t destidx, uint32_t srcidx, size_t count);
+		void put(uint32_t k, const record_t &r, slot_state st);
+		void retop(uint32_t b);
 
 		void reset_rebuild_window();
-		void update_misses(uint64_t misses, enum optype op);
 
+		inline block_t& block(uint32_t k) const {
+			return blocks[k / per_block];
+		}
+		inline uint16_t bit(uint32_t k) const {
+			return 1u << (k % per_block);
+		}
+		inline record_t& rec(uint32_t k) const {
+			return block(k).rec[k % per_block];
+		}
 		inline slot_state state(uint32_t k) const {
-			return table.state[k];
+			const block_t &b = block(k);
+			return b.full & bit(k) ? FULL
+			       : b.tomb & bit(k) ? TOMB : EMPTY;
 		}
 		inline K& key(uint32_t k) const {
-			return table.key[k];
+			return rec(k).key;
 		}
 		inline V& value(uint32_t k) const {
-			return table.value[k];
+			return rec(k).value;
 		}
 
-		inline void setkey(uint32_t k, K x)
-			{ table.key[k] = x; }
-		inline void setvalue(uint32_t k, V v)
-			{ table.value[k] = v; }
-
-		inline void setfull(uint32_t k) { table.state[k] = FULL; }
-		inline void setempty(uint32_t k) { table.state[k] = EMPTY; }
-		inline void settomb(uint32_t k) { table.state[k] = TOMB; }
+		inline void setfull(uint32_t k) {
+			block(k).full |= bit(k);
+			block(k).tomb &= ~bit(k);
+			if (hash(key(k)) > block(k).top)
+				block(k).top = hash(key(k));
+		}
+		inline void setempty(uint32_t k) {
+			block(k).full &= ~bit(k);
+			block(k).tomb &= ~bit(k);
+		}
+		inline void settomb(uint32_t k) {
+			block(k).full &= ~bit(k);
+			block(k).tomb |= bit(k);
+		}
 
 		inline bool full(uint32_t k) const {
-			return state(k) == FULL;
+			return block(k).full & bit(k);
 		}
 		inline bool empty(uint32_t k) const {
-			return state(k) == EMPTY;
+			return !((block(k).full | block(k).tomb) & bit(k));
 		}
 		inline bool tomb(uint32_t k) const {
-			return state(k) == TOMB;
+			return block(k).tomb & bit(k);
 		}
 
 	public:
 		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
 
-		graveyard_soa(uint32_t b);
-		~graveyard_soa();
-		std::string table_type() const { return "graveyard_soa"; }
+		graveyard_bkt(uint32_t b);
+		~graveyard_bkt();
+		std::string table_type() const { return "graveyard_bkt"; }
 
 		void resize(uint32_t);
 		void set_max_load_factor(double f) { max_load_factor = f; }
@@ -214,36 +294,22 @@ class graveyard_soa {
 		result remove(K key);
 		void rebuild();
 
-		// Performance characteristics
-		uint64_t total_misses;
-		uint64_t inserts, queries, removes, duplicates;
-		uint64_t insert_misses, query_misses, remove_misses;
-		uint64_t rebuild_inserts, rebuild_insert_misses;
-		uint64_t failed_inserts, failed_queries, failed_removes;
-		uint64_t insert_shifts, longest_search;
-		uint64_t resizes, rebuilds;
-		int max_rebuild_queue;
-
-		void reset_perf_counts();
-		void report_testing_stats(std::ostream &os = std::cout,
-		                          bool verbose = true);
-
 		void cluster_len(std::map<int, int>*) const;
 		void search_distance(std::map<int, int>*) const;
 
 		int get_rebuild_window() const { return rebuild_window; }
 		double load_factor() const { return (double)records/buckets; }
-		double avg_misses() const { return miss_running_avg; }
 		uint32_t table_size() const { return buckets; }
 		std::size_t table_size_bytes() const {
-			return buckets
-			       * (sizeof(K)+sizeof(V)+sizeof(slot_state));
+			return nblocks*sizeof(block_t);
 		}
-		std::size_t rec_width() const { return sizeof(table.key[0]); }
-		std::size_t key_width() const { return sizeof(table.key[0]); }
-		std::size_t value_width() const { return sizeof(table.value[0]); }
-		std::size_t state_width() const { return sizeof(table.state[0]); }
+		std::size_t rec_width() const { return sizeof(record_t); }
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		// the bitmaps, per slot
+		std::size_t state_width() const { return 0; }
 		uint32_t num_records() const { return records; }
+		uint32_t slots_per_block() const { return per_block; }
 
 		// debugging
 		void dump();
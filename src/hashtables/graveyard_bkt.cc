@@ -0,0 +1,610 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include "graveyard.h"
+#include "primes.h"
+#include "wide.h"
+#include <boost/circular_buffer.hpp>
+
+using std::cerr, std::size_t;
+
+template class graveyard_bkt<>;
+template class graveyard_bkt<uint32_t, uint32_t, CheapCounters>;
+template class graveyard_bkt<uint32_t, uint32_t, ProbeHistograms>;
+template class graveyard_bkt<uint32_t, uint32_t, NoStats>;
+template class graveyard_bkt<uint32_t, uint64_t>;
+template class graveyard_bkt<uint64_t, uint32_t>;
+template class graveyard_bkt<uint64_t, uint64_t>;
+
+template<typename K, typename V, typename Stats>
+graveyard_bkt<K, V, Stats>::
+graveyard_bkt(uint32_t b)
+{
+	prime_index = 0;
+	while(b > primes[prime_index])
+		prime_index++;
+
+	allocate(b);
+
+	max_load_factor = 0.5;
+	records = 0;
+	tombs = 0;
+	table_head = 0;
+	disable_rebuilds = false;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+}
+
+template<typename K, typename V, typename Stats>
+graveyard_bkt<K, V, Stats>::
+~graveyard_bkt()
+{
+	delete[] blocks;
+}
+
+template<typename K, typename V, typename Stats>
+uint32_t graveyard_bkt<K, V, Stats>::
+hash(K k) const
+{
+	return fastrange(k, buckets);
+}
+
+// b slots in whole blocks; the slots past b in the last one stay unused
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+allocate(uint32_t b)
+{
+	buckets = b;
+	nblocks = (b + per_block - 1) / per_block;
+	blocks = new block_t[nblocks];
+	if (!blocks) {
+		cerr << "Couldn't allocate table\n";
+		exit(1);
+	}
+	for (uint32_t i = 0; i < nblocks; ++i) {
+		blocks[i].full = blocks[i].tomb = 0;
+		blocks[i].top = 0;
+	}
+}
+
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+resize(uint32_t b)
+{
+	block_t *oldblocks = blocks;
+	uint32_t oldbuckets = buckets;
+
+	cerr << "resize(): rehashing into " << b << " buckets\n";
+
+	allocate(b);
+	records = 0;
+	tombs = 0;
+	table_head = 0;
+
+	for(uint32_t i=0; i<oldbuckets; ++i) {
+		const block_t &o = oldblocks[i / per_block];
+		if (o.full & (1u << (i % per_block)))
+			insert(o.rec[i % per_block].key,
+			       o.rec[i % per_block].value, true);
+	}
+
+	delete[] oldblocks;
+	this->count_resize();
+}
+
+// can a probe for hash h at slot s, the first of its block, pass the
+// whole block?  only if it has no empty slot, every record in it hashes
+// below h, and the table head isn't in it (the probe stops there)
+template<typename K, typename V, typename Stats>
+inline bool graveyard_bkt<K, V, Stats>::
+skip(uint32_t s, uint32_t h) const
+{
+	const block_t &b = block(s);
+	const uint16_t all = (1u << per_block) - 1;
+	return s + per_block <= buckets
+	       && (b.full | b.tomb) == all && b.top < h
+	       && (table_head < s || table_head >= s + per_block);
+}
+
+// graveyard_aos's probe, walking a block and an index in it rather than
+// dividing for every slot
+template<typename K, typename V, typename Stats>
+bool graveyard_bkt<K, V, Stats>::
+probe(K k, uint32_t *slot, optype operation, bool* wrapped)
+{
+	const uint32_t h = hash(k);
+	const bool ins = operation == INSERT || operation == REBUILD_INS;
+	uint64_t miss = 0;
+	bool res = false;
+	uint32_t s = std::max(h, table_head);
+	const block_t *b = &blocks[s / per_block];
+	uint32_t i = s % per_block;
+
+	while(1) {
+		if (i == 0 && skip(s, h)) {
+			s += per_block;
+			miss += per_block;
+			++b;
+		} else {
+			const uint16_t m = 1u << i;
+			if (b->full & m) {
+				if (b->rec[i].key == k) {
+					res = !ins;     // found, or a duplicate
+					break;
+				}
+				uint32_t hk = hash(b->rec[i].key);
+				if (hk > h || (ins && hk == h)) {
+					res = ins;
+					break;
+				}
+			} else if (!(b->tomb & m)) {
+				res = ins;              // empty
+				break;
+			}
+			++s;
+			++miss;
+			if (++i == per_block) {
+				i = 0;
+				++b;
+			}
+		}
+		if (s == buckets) {
+			s = 0;
+			i = 0;
+			b = blocks;
+			if (ins) *wrapped = true;
+		}
+		if (s == table_head) {
+			res = ins;
+			break;
+		}
+	}
+
+	this->record_probe(miss, operation);
+	*slot = s;
+	return res;
+}
+
+// one slot's record and state
+template<typename K, typename V, typename Stats>
+inline void graveyard_bkt<K, V, Stats>::
+put(uint32_t k, const record_t &r, slot_state st)
+{
+	rec(k) = r;
+	if (st == FULL) setfull(k);
+	else if (st == TOMB) settomb(k);
+	else setempty(k);
+}
+
+// the shifts only ever move slots one to the right (or a single slot):
+// a block at a time from the top, each a memmove and a shift of the
+// bitmaps, with the last slot of the block before carried into slot 0
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+slotmove(uint32_t destidx, uint32_t srcidx, size_t count)
+{
+	if (count == 0) return;
+	if (count == 1) {
+		put(destidx, rec(srcidx), state(srcidx));
+		return;
+	}
+	assert(destidx == srcidx + 1);
+
+	const uint32_t lo = destidx / per_block;
+	const uint32_t top = (destidx + count - 1) / per_block;
+	for (uint32_t bk = top; ; --bk) {
+		block_t &b = blocks[bk];
+		uint32_t first = bk == lo ? destidx % per_block : 0;
+		uint32_t last = bk == top ? (destidx + count - 1) % per_block
+		                          : per_block - 1;
+		uint32_t from = first ? first : 1;
+		if (last >= from) {
+			std::memmove(&b.rec[from], &b.rec[from - 1],
+			             sizeof(record_t) * (last - from + 1));
+			uint16_t m = ((1u << (last - from + 1)) - 1) << from;
+			b.full = (b.full & ~m) | ((b.full << 1) & m);
+			b.tomb = (b.tomb & ~m) | ((b.tomb << 1) & m);
+		}
+		if (first == 0)
+			put(bk*per_block, rec(bk*per_block - 1),
+			    state(bk*per_block - 1));
+		if (bk == lo) break;
+	}
+}
+
+// exact top for block b
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+retop(uint32_t b)
+{
+	block_t &bl = blocks[b];
+	bl.top = 0;
+	for (uint16_t m = bl.full; m; m &= m - 1) {
+		uint32_t h = hash(bl.rec[__builtin_ctz(m)].key);
+		if (h > bl.top) bl.top = h;
+	}
+}
+
+// find the end of the cluster, then slide records 1 to the right as a block
+template<typename K, typename V, typename Stats>
+uint32_t graveyard_bkt<K, V, Stats>::
+shift(uint32_t start)
+{
+	const uint32_t last = buckets-1;
+	uint32_t end = start;
+
+	do
+		if (++end > last) end = 0;
+	while (full(end));
+
+	if (tomb(end)) --tombs; // made use of a tombstone
+
+	if (end < start) {
+		slotmove(1, 0, end);
+		slotmove(0, last, 1);
+		slotmove(start+1, start, last-start);
+	} else
+		slotmove(start+1, start, end-start);
+
+	return end;
+}
+
+// from slot x, the records up to end move one slot right: into an empty
+// slot (0), off the end of the table (2), or up to a tombstone (1).
+// rebuild() leaves its tombstones in runs at the ends of blocks, which the
+// shift jumps; it carries on at next, the first slot past the run
+template<typename K, typename V, typename Stats>
+int graveyard_bkt<K, V, Stats>::
+rebuild_seek(uint32_t x, uint32_t &end, uint32_t &next)
+{
+	const uint32_t last = buckets-1;
+	while(1) {
+		if (x > last) {
+			end = last;
+			return 2;       // shift into the end of the table
+		} else if (empty(x)) {
+			end = x;
+			return 0;       // shift into an empty slot
+		} else if (tomb(x)) {
+			end = x-1;
+			while (x <= last && tomb(x)) ++x;
+			next = x;
+			return 1;       // shift up to a run of tombstones
+		}
+		++x;
+	}
+}
+
+template<typename K, typename V, typename Stats>
+uint32_t graveyard_bkt<K, V, Stats>::
+rebuild_shift(uint32_t start)
+{
+	record_t lastscratch, scratch;
+	enum slot_state lastscratch_state, scratch_state;
+	bool valid = false;
+	uint32_t end, next;
+
+	while(1) {
+		int res = rebuild_seek(start, end, next);
+
+		// the slot itself is a tombstone (only ever the first one:
+		// later starts are past a run): nothing to move, the record
+		// takes it
+		if (res == 1 && end + 1 == start) {
+			assert(!valid);
+			return start;
+		}
+
+		scratch = rec(end);
+		scratch_state = state(end);
+
+		slotmove(start+1, start, end-start);
+		if (valid)
+			put(start, lastscratch, lastscratch_state);
+		lastscratch = scratch;
+		lastscratch_state = scratch_state;
+		valid = true;
+
+		if (res == 0) break;
+		if (res == 2 || next > buckets-1) {
+			end = rebuild_shift(0);
+			put(0, lastscratch, lastscratch_state);
+			break;
+		}
+		start = next;
+	}
+
+	return end;
+}
+
+template<typename K, typename V, typename Stats>
+graveyard_bkt<K, V, Stats>::result graveyard_bkt<K, V, Stats>::
+insert(K k, V v, bool rebuilding)
+{
+	uint32_t slot;
+	bool wrapped=false;
+
+	if (records>=buckets) {
+		this->count_fail(INSERT);
+		return result::FULLTABLE;
+	}
+
+	optype ins_type = rebuilding ? optype::REBUILD_INS : optype::INSERT;
+	if (!probe(k, &slot, ins_type, &wrapped)) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return result::DUPLICATE;
+	}
+
+	if (!empty(slot)) {
+		uint32_t end;
+		end = !rebuilding ? shift(slot) : rebuild_shift(slot);
+		if (((end < slot) || wrapped) && end >= table_head)
+			++table_head;
+		if (end >= slot)
+			this->count_shifts(end - slot, ins_type);
+		else
+			this->count_shifts(buckets - slot + end, ins_type);
+	} else {
+		this->count_shifts(0, ins_type);
+		if (wrapped && slot == table_head) table_head++;
+	}
+
+	if (rebuilding && tomb(table_head)) ++table_head;
+	put(slot, record_t{ k, v }, FULL);
+
+	++records;
+	this->count_op(rebuilding ? REBUILD_INS : INSERT);
+
+	// automatic resizing
+	if (load_factor() > max_load_factor) {
+		cerr << "load factor " << max_load_factor << " exceeded\n";
+		resize(primes[++prime_index]);
+	}
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return result::REBUILD;
+	}
+
+	return result::SUCCESS;
+}
+
+template<typename K, typename V, typename Stats>
+bool graveyard_bkt<K, V, Stats>::
+query(K k, V *v)
+{
+	uint32_t slot;
+	this->count_op(QUERY);
+
+	if (probe(k, &slot, QUERY)) {
+		*v = value(slot);
+		return true;
+	}
+
+	this->count_fail(QUERY);
+	return false;
+}
+
+template<typename K, typename V, typename Stats>
+graveyard_bkt<K, V, Stats>::result graveyard_bkt<K, V, Stats>::
+remove(K k)
+{
+	uint32_t slot;
+	this->count_op(REMOVE);
+
+	if (probe(k, &slot, REMOVE)) {
+		settomb(slot);
+		++tombs;
+		--records;
+		--rebuild_window;
+		if(rebuild_window > 0)
+			return result::SUCCESS;
+		else
+			return result::REBUILD;
+	}
+
+	this->count_fail(REMOVE);
+	return result::FAILURE;
+}
+
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+reset_rebuild_window()
+{
+	rebuild_window = buckets/4.0 * (1.0 - load_factor()); // 1-a = 1/x
+}
+
+// graveyard_aos's rebuild, with the tombstones dealt out per block: block
+// i gets floor((i+1)*B/interval) - floor(i*B/interval) of them, in its
+// last slots, so their density is the same as every interval slots
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+rebuild()
+{
+	int tombcount = (buckets/2) * (1.0 - load_factor()); // 1-a = 1/x
+	double interval = tombcount ? (buckets / tombcount) : buckets;
+	uint32_t t = 0;         // this block's tombstones
+	struct rec_t {
+		record_t kv;
+		enum slot_state state;
+	};
+
+	// save the part of the table that wrapped for reinsertion later.
+	// all of it turns to tombstones, the empty slots too: the head
+	// goes back to 0, and the pass below has to pull the records at
+	// the old head down over any gap left under it
+	std::vector<rec_t> overflow;
+	for(uint32_t p = 0; p < table_head; ++p) {
+		if (full(p)) {
+			overflow.push_back({rec(p), FULL});
+			--records;
+		}
+		settomb(p);
+	}
+	table_head = 0;
+	tombs = 0;
+
+	boost::circular_buffer<rec_t> queue(buckets / interval + 1);
+	for(uint32_t p = 0, q = 1; p < buckets; p++) {
+		uint32_t i = p % per_block;
+		if (i == 0) {
+			uint32_t b = p / per_block;
+			t = (uint32_t)((b + 1) * per_block / interval)
+			    - (uint32_t)(b * per_block / interval);
+		}
+		if (i >= per_block - t) {
+			if (full(p)) queue.push_back({rec(p), FULL});
+			this->rebuild_queue((int)queue.size());
+			settomb(p);
+		} else {
+			if (queue.empty()) {
+				if (tomb(p)) {
+					while(q < buckets && !full(q)) q++;
+					if (q < buckets) {
+						if (hash(key(q)) > p)
+							setempty(p);
+						else {
+							put(p, rec(q), FULL);
+							settomb(q);
+							++tombs;
+						}
+					} else
+						setempty(p);
+				}
+			} else {
+				if (full(p)) queue.push_back({rec(p), FULL});
+				put(p, queue.front().kv, queue.front().state);
+				queue.pop_front();
+			}
+		}
+		if (q <= p) q = p + 1;
+	}
+
+	// tops only ever rise as records come and go: tighten them
+	for (uint32_t b = 0; b < nblocks; ++b)
+		retop(b);
+
+	records -= queue.size(); // avoid double count on reinsert
+	for (rec_t r : queue) insert(r.kv.key, r.kv.value, true);
+
+	for (rec_t r : overflow) insert(r.kv.key, r.kv.value, true);
+	reset_rebuild_window();
+	this->count_rebuild();
+}
+
+// fill in a histogram of cluster lengths (tombstones count as boundaries)
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+cluster_len(std::map<int,int> *clust) const
+{
+	uint32_t last_empty, last_tomb;
+	last_empty = last_tomb = table_head;
+	for(uint32_t p = table_head; p < buckets; ++p) {
+		if (!full(p)) {
+			int dist = std::min(p - last_empty, p - last_tomb);
+			if (dist > 1) (*clust)[dist-1]++;
+			if (empty(p)) last_empty = p;
+			if (tomb(p)) last_tomb = p;
+		}
+	}
+
+	// keep counting once we wrap the table
+	for(uint32_t p = 0; p < table_head; ++p) {
+		if (!full(p)) {
+			// detect if the cluster wrapped
+			int x = last_empty >= table_head ?
+				(buckets - last_empty + p) : (p - last_empty);
+			int y = last_tomb >= table_head ?
+				(buckets - last_tomb + p) : (p - last_tomb);
+			int dist = std::min(x, y);
+			if (dist > 1) (*clust)[dist-1]++;
+			if (empty(p)) last_empty = p;
+			if (tomb(p)) last_tomb = p;
+		}
+	}
+}
+
+// fill in a histogram of search distances
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+search_distance(std::map<int,int> *disp) const
+{
+	for(uint32_t p = 0; p < buckets; ++p)
+		if (full(p)) {
+			uint32_t h = hash(key(p));
+			(*disp)[p >= table_head ? p - h : buckets - h + p]++;
+		}
+}
+
+// keys monotonically increasing from the table head, and every top at
+// least the hashes in its block
+template<typename K, typename V, typename Stats>
+bool graveyard_bkt<K, V, Stats>::
+check_ordering()
+{
+	uint32_t p = table_head, q;
+	bool wrapped = false, res = true;
+
+	for (p = 0; p < buckets; ++p)
+		if (full(p) && hash(key(p)) > block(p).top) {
+			std::cerr << "Block top too low at slot " << p << "\n";
+			res = false;
+		}
+
+	if (!records) return res;
+	p = table_head;
+	while (!full(p)) ++p;
+	q = p;
+	while(1) {
+		do {
+			if (++q == buckets) {
+				q = 0;
+				wrapped = true;
+			}
+		} while (!full(q));
+
+		if (wrapped && q >= table_head) break;
+
+		if (hash(key(p)) > hash(key(q))) {
+			std::cerr << "Ordering violated at slot " << q << "\n";
+			res = false;
+		}
+
+		p = q;
+	}
+
+	return res;
+}
+
+template<typename K, typename V, typename Stats>
+void graveyard_bkt<K, V, Stats>::
+dump()
+{
+	for(uint32_t i=0; i<buckets; i++) {
+		if ((i!=0) && (i%per_block == 0)) std::cout << "\n";
+		std::cout.width(4);
+		std::cout << i << ':';
+
+		if (tomb(i)) std::cout << "\e[1;31m";
+		if (i==table_head)
+			std::cout << "\033[0;22m*\033[0m[";
+		else
+			std::cout << " [";
+
+		if(full(i)) {
+			std::cout.width(4);
+			std::cout << hash(key(i)) << "]";
+			std::cout.width(4);
+			std::cout << key(i);
+		} else if (empty(i)) {
+			std::cout << "    ]    ";
+		} else {
+			std::cout.width(4);
+			std::cout << "____]";
+			std::cout << "____";
+		}
+		if (tomb(i)) std::cout << "\e[0m";
+	}
+}
@@ -0,0 +1,215 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+// slot storage policies.
+//
+// a table written against a layout keeps a Layout<K, V, S> and reaches
+// slot i only through key(i), value(i) and state(i) (S is the table's per
+// slot state: a slot_state enum, a probe length, ...), so one probing
+// scheme builds in each of:
+//
+//   aos_layout     one array of {key, value, state} records: a hit reads
+//                  one line, but a key scan drags the values along
+//   soa_layout     three arrays: a key scan reads only keys (and states),
+//                  a hit touches three lines
+//   aosoa_layout   cache line blocks of keys, then their states, then their
+//                  values: key scans stay dense and a hit's value is in
+//                  the same block, a line or two further on
+//
+// allocate() leaves the states uninitialized; release() frees what
+// allocate() got.  copies share storage, which is how resize() keeps the
+// old table around while it reinserts.  name is the table_type() suffix.
+//
+// move(dest, src, n) moves slots [src, src+n) to [dest, dest+n), the
+// ranges free to overlap, as memmove does: the ordered tables' shifts.
+// arrays(b, f) calls f(p, bytes) on each array of a b slot table in turn
+// while f returns true, which is how a snapshot writes the table out as
+// it lies in memory.
+
+template <typename K, typename V, typename S>
+class aos_layout {
+	private:
+		struct record_t {
+			K key;
+			V value;
+			S state;
+		} *table = nullptr;
+
+	public:
+		static constexpr const char *name = "aos";
+
+		void allocate(uint32_t b) {
+			table = new record_t[b];
+			if (!table) {
+				std::cerr << "Couldn't allocate\n";
+				exit(1);
+			}
+		}
+		void release() { delete[] table; }
+
+		inline K& key(uint32_t k) const { return table[k].key; }
+		inline V& value(uint32_t k) const { return table[k].value; }
+		inline S& state(uint32_t k) const { return table[k].state; }
+
+		void move(uint32_t dest, uint32_t src, std::size_t n) {
+			std::memmove(&table[dest], &table[src],
+			             sizeof(record_t) * n);
+		}
+		template <typename F>
+		bool arrays(uint32_t b, F f) const {
+			return f(table, bytes(b));
+		}
+
+		static std::size_t bytes(std::size_t b) {
+			return b*sizeof(record_t);
+		}
+		static std::size_t rec_width() { return sizeof(record_t); }
+		// states live inside the records
+		static std::size_t state_width() { return 0; }
+};
+
+template <typename K, typename V, typename S>
+class soa_layout {
+	private:
+		K *keys = nullptr;
+		V *values = nullptr;
+		S *states = nullptr;
+
+	public:
+		static constexpr const char *name = "soa";
+
+		void allocate(uint32_t b) {
+			keys = new K[b];
+			values = new V[b];
+			states = new S[b];
+			if (!keys || !values || !states) {
+				std::cerr << "Couldn't allocate\n";
+				exit(1);
+			}
+		}
+		void release() {
+			delete[] keys;
+			delete[] values;
+			delete[] states;
+		}
+
+		inline K& key(uint32_t k) const { return keys[k]; }
+		inline V& value(uint32_t k) const { return values[k]; }
+		inline S& state(uint32_t k) const { return states[k]; }
+
+		void move(uint32_t dest, uint32_t src, std::size_t n) {
+			std::memmove(&keys[dest], &keys[src], sizeof(K) * n);
+			std::memmove(&values[dest], &values[src], sizeof(V) * n);
+			std::memmove(&states[dest], &states[src], sizeof(S) * n);
+		}
+		template <typename F>
+		bool arrays(uint32_t b, F f) const {
+			return f(keys, b*sizeof(K)) && f(values, b*sizeof(V))
+			    && f(states, b*sizeof(S));
+		}
+
+		static std::size_t bytes(std::size_t b) {
+			return b*(sizeof(K) + sizeof(V) + sizeof(S));
+		}
+		static std::size_t rec_width() { return sizeof(K); }
+		static std::size_t state_width() { return sizeof(S); }
+};
+
+// a block is one cache line of keys (16 32 bit keys, 8 64 bit ones) and
+// their states and values, so the index math is a shift and a mask
+template <typename K, typename V, typename S>
+class aosoa_layout {
+	private:
+		static constexpr uint32_t per_block =
+			sizeof(K) >= 64 ? 1 : 64 / sizeof(K);
+		static_assert((per_block & (per_block - 1)) == 0,
+		              "keys per block must be a power of two");
+		static constexpr uint32_t shift = __builtin_ctz(per_block);
+		static constexpr uint32_t mask = per_block - 1;
+
+		struct alignas(64) block_t {
+			K key[per_block];
+			S state[per_block];
+			V value[per_block];
+		} *blocks = nullptr;
+
+		static uint32_t nblocks(std::size_t b) {
+			return (b + per_block - 1) / per_block;
+		}
+
+		// n slots that don't cross a block boundary at either end
+		void move_run(uint32_t dest, uint32_t src, std::size_t n) {
+			block_t &d = blocks[dest >> shift];
+			block_t &s = blocks[src >> shift];
+			std::memmove(&d.key[dest & mask], &s.key[src & mask],
+			             sizeof(K) * n);
+			std::memmove(&d.state[dest & mask], &s.state[src & mask],
+			             sizeof(S) * n);
+			std::memmove(&d.value[dest & mask], &s.value[src & mask],
+			             sizeof(V) * n);
+		}
+
+	public:
+		static constexpr const char *name = "aosoa";
+
+		void allocate(uint32_t b) {
+			blocks = new block_t[nblocks(b)];
+			if (!blocks) {
+				std::cerr << "Couldn't allocate\n";
+				exit(1);
+			}
+		}
+		void release() { delete[] blocks; }
+
+		inline K& key(uint32_t k) const {
+			return blocks[k >> shift].key[k & mask];
+		}
+		inline V& value(uint32_t k) const {
+			return blocks[k >> shift].value[k & mask];
+		}
+		inline S& state(uint32_t k) const {
+			return blocks[k >> shift].state[k & mask];
+		}
+
+		// a run at a time, from the end that doesn't overwrite slots
+		// still to be moved
+		void move(uint32_t dest, uint32_t src, std::size_t n) {
+			if (dest > src)
+				while (n) {
+					uint32_t d = dest + n - 1, s = src + n - 1;
+					std::size_t r = std::min<std::size_t>(
+					    { n, (d & mask) + 1, (s & mask) + 1 });
+					n -= r;
+					move_run(dest + n, src + n, r);
+				}
+			else
+				while (n) {
+					std::size_t r = std::min<std::size_t>(
+					    { n, per_block - (dest & mask),
+					      per_block - (src & mask) });
+					move_run(dest, src, r);
+					dest += r;
+					src += r;
+					n -= r;
+				}
+		}
+		template <typename F>
+		bool arrays(uint32_t b, F f) const {
+			return f(blocks, bytes(b));
+		}
+
+		static std::size_t bytes(std::size_t b) {
+			return nblocks(b)*sizeof(block_t);
+		}
+		static std::size_t rec_width() { return sizeof(K); }
+		static std::size_t state_width() { return sizeof(S); }
+};
+
+#endif
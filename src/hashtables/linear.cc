@@ -0,0 +1,341 @@
+#include <iostream>
+#include <cassert>
+#include "linear.h"
+#include "primes.h"
+#include "wide.h"
+
+using std::cerr, std::size_t;
+
+template class linear<uint32_t, int, FullStats, aos_layout>;
+template class linear<uint32_t, int, CheapCounters, aos_layout>;
+template class linear<uint32_t, int, ProbeHistograms, aos_layout>;
+template class linear<uint32_t, int, NoStats, aos_layout>;
+template class linear<uint32_t, uint32_t, FullStats, aos_layout>;
+template class linear<uint32_t, uint32_t, CheapCounters, aos_layout>;
+template class linear<uint32_t, uint32_t, ProbeHistograms, aos_layout>;
+template class linear<uint32_t, uint32_t, NoStats, aos_layout>;
+template class linear<uint32_t, uint64_t, FullStats, aos_layout>;
+template class linear<uint64_t, uint32_t, FullStats, aos_layout>;
+template class linear<uint64_t, uint64_t, FullStats, aos_layout>;
+template class linear<key64, uint32_t, FullStats, aos_layout>;
+template class linear<key64, uint64_t, FullStats, aos_layout>;
+template class linear<uint32_t, blob<32>, FullStats, aos_layout>;
+template class linear<uint32_t, blob<64>, FullStats, aos_layout>;
+template class linear<uint32_t, blob<128>, FullStats, aos_layout>;
+template class linear<key64, blob<32>, FullStats, aos_layout>;
+template class linear<key64, blob<64>, FullStats, aos_layout>;
+template class linear<key64, blob<128>, FullStats, aos_layout>;
+template class linear<key128, uint32_t, FullStats, aos_layout>;
+template class linear<key128, uint64_t, FullStats, aos_layout>;
+template class linear<key128, blob<32>, FullStats, aos_layout>;
+template class linear<key128, blob<64>, FullStats, aos_layout>;
+template class linear<key128, blob<128>, FullStats, aos_layout>;
+
+template class linear<uint32_t, uint32_t, FullStats, soa_layout>;
+template class linear<uint32_t, uint32_t, CheapCounters, soa_layout>;
+template class linear<uint32_t, uint32_t, ProbeHistograms, soa_layout>;
+template class linear<uint32_t, uint32_t, NoStats, soa_layout>;
+template class linear<uint32_t, uint64_t, FullStats, soa_layout>;
+template class linear<uint64_t, uint32_t, FullStats, soa_layout>;
+template class linear<uint64_t, uint64_t, FullStats, soa_layout>;
+template class linear<key64, uint32_t, FullStats, soa_layout>;
+template class linear<key64, uint64_t, FullStats, soa_layout>;
+template class linear<uint32_t, blob<32>, FullStats, soa_layout>;
+template class linear<uint32_t, blob<64>, FullStats, soa_layout>;
+template class linear<uint32_t, blob<128>, FullStats, soa_layout>;
+template class linear<key64, blob<32>, FullStats, soa_layout>;
+template class linear<key64, blob<64>, FullStats, soa_layout>;
+template class linear<key64, blob<128>, FullStats, soa_layout>;
+template class linear<key128, uint32_t, FullStats, soa_layout>;
+template class linear<key128, uint64_t, FullStats, soa_layout>;
+template class linear<key128, blob<32>, FullStats, soa_layout>;
+template class linear<key128, blob<64>, FullStats, soa_layout>;
+template class linear<key128, blob<128>, FullStats, soa_layout>;
+
+template class linear<uint32_t, uint32_t, FullStats, aosoa_layout>;
+template class linear<uint32_t, uint32_t, CheapCounters, aosoa_layout>;
+template class linear<uint32_t, uint32_t, ProbeHistograms, aosoa_layout>;
+template class linear<uint32_t, uint32_t, NoStats, aosoa_layout>;
+template class linear<uint32_t, uint64_t, FullStats, aosoa_layout>;
+template class linear<uint64_t, uint32_t, FullStats, aosoa_layout>;
+template class linear<uint64_t, uint64_t, FullStats, aosoa_layout>;
+template class linear<key64, uint32_t, FullStats, aosoa_layout>;
+template class linear<key64, uint64_t, FullStats, aosoa_layout>;
+template class linear<uint32_t, blob<32>, FullStats, aosoa_layout>;
+template class linear<uint32_t, blob<64>, FullStats, aosoa_layout>;
+template class linear<uint32_t, blob<128>, FullStats, aosoa_layout>;
+template class linear<key64, blob<32>, FullStats, aosoa_layout>;
+template class linear<key64, blob<64>, FullStats, aosoa_layout>;
+template class linear<key64, blob<128>, FullStats, aosoa_layout>;
+template class linear<key128, uint32_t, FullStats, aosoa_layout>;
+template class linear<key128, uint64_t, FullStats, aosoa_layout>;
+template class linear<key128, blob<32>, FullStats, aosoa_layout>;
+template class linear<key128, blob<64>, FullStats, aosoa_layout>;
+template class linear<key128, blob<128>, FullStats, aosoa_layout>;
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+linear<K, V, Stats, L>::linear(uint32_t b)
+{
+	prime_index = 0;
+	while(b > primes[prime_index])
+		prime_index++;
+
+	allocate(b);
+	records = 0;
+	max_load_factor = 0.5;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+	tombs = 0;
+	disable_rebuilds = false;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+linear<K, V, Stats, L>::~linear()
+{
+	table.release();
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+uint32_t
+linear<K, V, Stats, L>::hash(K k) const
+{
+	return fastrange(k, buckets);
+}
+
+// a table of b empty slots
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+linear<K, V, Stats, L>::allocate(uint32_t b)
+{
+	table.allocate(b);
+	for(uint32_t i=0; i<b; i++)
+		setempty(i);
+	buckets = b;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+linear<K, V, Stats, L>::resize(uint32_t b)
+{
+	uint32_t oldbuckets = buckets;
+	L<K, V, slot_state> oldtable = table;
+
+	//cerr << "resize(): rehashing into " << b << " buckets\n";
+
+	allocate(b);
+	records = 0;
+	tombs = 0;
+
+	for(uint32_t i=0; i<oldbuckets; ++i)
+		if (oldtable.state(i) == FULL)
+			insert(oldtable.key(i), oldtable.value(i), true);
+
+	oldtable.release();
+	this->count_resize();
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+linear<K, V, Stats, L>::probe(K k, uint32_t *slot, optype operation)
+{
+	uint32_t probe = hash(k);
+	uint32_t miss = 0;
+	bool res = false;
+
+	if (operation == INSERT || operation == REBUILD_INS) {
+		while(true) {
+			if (!full(probe)) {
+				*slot = probe;
+				res = true;
+				break;
+			} else if (key(probe) == k) {
+				res = false;
+				break;
+			}
+			if (++probe == buckets) probe = 0;
+			++miss;
+		}
+	} else if (operation == QUERY || operation == REMOVE) {
+		while(true) {
+			if (full(probe) && key(probe) == k) {
+				*slot = probe;
+				res = true;
+				break;
+			} else if (empty(probe)) {
+				res = false;
+				break;
+			}
+			if (++probe == buckets) probe = 0;
+			++miss;
+		}
+	}
+
+	this->record_probe(miss, operation);
+	return res;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+linear<K, V, Stats, L>::result
+linear<K, V, Stats, L>::insert(K k, V v, bool rebuilding)
+{
+	uint32_t slot;
+
+	if (records>=buckets) {
+		this->count_fail(INSERT);
+		return FULLTABLE;
+	}
+
+	if(!probe(k, &slot, rebuilding ? REBUILD_INS : INSERT)) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return DUPLICATE;
+	}
+
+	if (tomb(slot)) --tombs;
+	setkey(slot, k);
+	setvalue(slot, v);
+	setfull(slot);
+	++records;
+
+	this->count_op(rebuilding ? REBUILD_INS : INSERT);
+
+	// automatic resizing
+	if (load_factor() > max_load_factor) {
+		cerr << "load factor " << max_load_factor << " exceeded\n";
+		resize(primes[++prime_index]);
+	}
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return REBUILD;
+	}
+
+	return SUCCESS;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+linear<K, V, Stats, L>::query(K k, V *v)
+{
+	uint32_t slot;
+	this->count_op(QUERY);
+
+	if (probe(k, &slot, QUERY)) {
+		*v = value(slot);
+		return true;
+	} else {
+		this->count_fail(QUERY);
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+linear<K, V, Stats, L>::result
+linear<K, V, Stats, L>::remove(K k)
+{
+	uint32_t slot;
+	this->count_op(REMOVE);
+	if (probe(k, &slot, REMOVE)) {
+		settomb(slot);
+		++tombs;
+		--records;
+		return result::SUCCESS;
+	} else {
+		this->count_fail(REMOVE);
+		return result::FAILURE;
+	}
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+linear<K, V, Stats, L>::reset_rebuild_window()
+{
+	rebuild_window = buckets/2 * (1.0 - load_factor()) + 1;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+linear<K, V, Stats, L>::rebuild()
+{
+	resize(buckets);
+	reset_rebuild_window();
+}
+
+// fill in a histogram of cluster lengths (tombstones count as boundaries)
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+linear<K, V, Stats, L>::cluster_len(std::map<int,int> *clust) const
+{
+	uint32_t first_nonfull, last_nonfull, p=0;
+
+	while (full(p)) ++p;
+	first_nonfull = last_nonfull = p;
+
+	while(p < buckets) {
+		if (!full(p)) {
+			int dist = p - last_nonfull;
+			if (dist > 1) (*clust)[dist-1]++;
+			last_nonfull = p;
+		}
+		p++;
+	}
+
+	(*clust)[buckets-last_nonfull+first_nonfull-1]++;
+}
+
+// fill in a histogram of shift lengths
+// i.e. the distance from a key's slot and the hash of that key
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+linear<K, V, Stats, L>::search_distance(std::map<int,int> *disp) const
+{
+	for(uint32_t p = 0; p < buckets; ++p)
+		if (full(p)) {
+			uint32_t h = hash(key(p));
+			int d = (p > h ? p - h : buckets - h + p);
+			(*disp)[d]++;
+		}
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+linear<K, V, Stats, L>::dump()
+{
+	for(size_t i=0; i<buckets; i++) {
+		if ((i!=0) && (i%10 == 0)) std::cout << "\n";
+		std::cout.width(4);
+		std::cout << i << ':';
+
+		if (tomb(i)) std::cout << "\e[1;31m";
+		std::cout << " [";
+
+		if(full(i)) {
+			std::cout.width(4);
+			std::cout << hash(key(i)) << "]";
+			std::cout.width(4);
+			std::cout << key(i);
+		} else if (empty(i)) {
+			std::cout << "    ]    ";
+		} else {
+			std::cout.width(4);
+			std::cout << "____]";
+			std::cout << "____";
+		}
+		if (tomb(i)) std::cout << "\e[0m";
+	}
+}
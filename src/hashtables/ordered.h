@@ -6,58 +6,66 @@
 #include <iostream>
 #include <vector>
 #include <map>
-
-template <typename K = uint32_t,
-          typename V = uint32_t>
-class ordered_aos {
+#include "perfstats.h"
+#include "layout.h"
+#include "snapshot.h"
+
+// ordered linear probing, once for every slot layout (layout.h):
+// ordered_aos, ordered_soa and ordered_aosoa below.
+
+template <typename K,
+          typename V,
+          typename Stats,
+          template <typename, typename, typename> class Layout>
+class ordered : public Stats {
 	private:
 		enum slot_state { FULL, EMPTY, TOMB };
-		enum optype { INSERT, QUERY, REMOVE, REBUILD_INS };
+		using optype = perf::optype;
+		using enum perf::optype;
 
-		struct record {
-			K key;
-			V value;
-			slot_state state;
-		} *table;
+		Layout<K, V, slot_state> table;
 
 		uint32_t buckets;
 		uint32_t records;
 		uint32_t tombs;
 		uint32_t table_head;
 		int rebuild_window;
-		
+
 		int prime_index;
 		double max_load_factor;
+		uint32_t gallop_after;
 
-		uint64_t search_count;
-		double miss_running_avg;
+		snapshotter snap;
 
 		uint32_t hash(K k) const;
 		bool probe(K k, uint32_t *slot, optype operation,
 		           bool* wrapped = NULL);
+		uint32_t gallop(uint32_t s, uint32_t h, uint64_t *miss) const;
 		uint32_t shift(uint32_t slot);
+		void allocate(uint32_t b);
+		inline void slotmove(uint32_t destidx, uint32_t srcidx,
+		                     size_t count);
 
 		void reset_rebuild_window();
-		void update_misses(uint64_t misses, enum optype op);
 
 		inline slot_state state(uint32_t k) const {
-			return table[k].state;
+			return table.state(k);
 		}
 		inline K& key(uint32_t k) const {
-			return table[k].key;
+			return table.key(k);
 		}
 		inline V& value(uint32_t k) const {
-			return table[k].value;
+			return table.value(k);
 		}
 
 		inline void setkey(uint32_t k, K x)
-			{ table[k].key = x; }
+			{ table.key(k) = x; }
 		inline void setvalue(uint32_t k, V v)
-			{ table[k].value = v; }
+			{ table.value(k) = v; }
 
-		inline void setfull(uint32_t k) { table[k].state = FULL; }
-		inline void setempty(uint32_t k) { table[k].state = EMPTY; }
-		inline void settomb(uint32_t k) { table[k].state = TOMB; }
+		inline void setfull(uint32_t k) { table.state(k) = FULL; }
+		inline void setempty(uint32_t k) { table.state(k) = EMPTY; }
+		inline void settomb(uint32_t k) { table.state(k) = TOMB; }
 
 		inline bool full(uint32_t k) const {
 			return state(k) == FULL;
@@ -71,43 +79,49 @@ class ordered_aos {
 
 	public:
 		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
 
-		ordered_aos(uint32_t b);
-		~ordered_aos();
-		std::string table_type() const { return "ordered_aos"; }
+		ordered(uint32_t b);
+		~ordered();
+		std::string table_type() const {
+			return std::string("ordered_") + Layout<K, V, slot_state>::name;
+		}
 
 		void resize(uint32_t);
 		void set_max_load_factor(double f) { max_load_factor = f; }
-		
+		// slots probe() walks before it gallops; 0 never does
+		void set_gallop_after(uint32_t n) { gallop_after = n; }
+
 		result insert(K key, V value, bool rebuilding = false);
 		bool query(K key, V *value);
 		result remove(K key);
 		void rebuild();
 
-		// Performance characteristics
-		uint64_t total_misses;
-		uint64_t inserts, queries, removes;
-		uint64_t insert_misses, query_misses, remove_misses;
-		uint64_t insert_shifts, longest_search;
-		uint64_t rebuild_inserts, rebuild_insert_misses;
-		uint64_t failed_inserts, failed_queries, failed_removes;
-		uint64_t duplicates;
-		uint64_t resizes, rebuilds;
-
-		void reset_perf_counts();
-		void report_testing_stats(std::ostream &os = std::cout,
-		                          bool verbose = true);
-
 		void cluster_len(std::map<int, int>*) const;
 		void search_distance(std::map<int, int>*) const;
 
+		// background snapshots: fork a child that writes the table
+		// to path while this table keeps taking operations
+		bool snapshot(const std::string &path);
+		bool snapshot_poll() { return snap.poll(); }
+		bool snapshot_wait() { return snap.wait(); }
+		bool snapshot_active() const { return snap.active(); }
+		uint64_t snapshot_dirty_regions() const {
+			return snap.dirty_regions;
+		}
+		uint64_t snapshot_regions() const { return snap.total_regions; }
+
 		int get_rebuild_window() const { return rebuild_window; }
 		double load_factor() const { return (double)records/buckets; }
-		double avg_misses() const { return miss_running_avg; }
 		uint32_t table_size() const { return buckets; }
 		uint64_t table_size_bytes() const {
-			return buckets*sizeof(record);
+			return table.bytes(buckets);
 		}
+		std::size_t rec_width() const { return table.rec_width(); }
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		std::size_t state_width() const { return table.state_width(); }
 		uint32_t num_records() const { return records; }
 
 		// debugging
@@ -117,120 +131,17 @@ class ordered_aos {
 };
 
 template <typename K = uint32_t,
-          typename V = uint32_t>
-class ordered_soa {
-	private:
-		enum slot_state { FULL, EMPTY, TOMB };
-		enum optype { INSERT, QUERY, REMOVE, REBUILD_INS };
-
-		struct record_t {
-			K key;
-			V value;
-			slot_state state;
-		};
-
-		struct table_t {
-			K *key;
-			V *value;
-			slot_state *state;
-		} table;
-
-		std::size_t buckets;
-		std::size_t records;
-		std::size_t tombs;
-		uint32_t table_head;
-		int rebuild_window;
-		
-		int prime_index;
-		double max_load_factor;
-
-		uint64_t search_count;
-		double miss_running_avg;
-
-		uint32_t hash(K k) const;
-		bool probe(K k, uint32_t *slot, optype operation,
-		           bool* wrapped = NULL);
-		uint32_t shift(uint32_t slot);
-
-		void reset_rebuild_window();
-		void update_misses(uint64_t misses, enum optype op);
-
-		inline void slotmove(uint32_t destidx, uint32_t srcidx,
-		                     size_t count);
-
-		inline slot_state state(uint32_t k) const {
-			return table.state[k];
-		}
-		inline K& key(uint32_t k) const {
-			return table.key[k];
-		}
-		inline V& value(uint32_t k) const {
-			return table.value[k];
-		}
-
-		inline void setkey(uint32_t k, K x)
-			{ table.key[k] = x; }
-		inline void setvalue(uint32_t k, V v)
-			{ table.value[k] = v; }
-
-		inline void setfull(uint32_t k) { table.state[k] = FULL; }
-		inline void setempty(uint32_t k) { table.state[k] = EMPTY; }
-		inline void settomb(uint32_t k) { table.state[k] = TOMB; }
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using ordered_aos = ordered<K, V, Stats, aos_layout>;
 
-		inline bool full(uint32_t k) const {
-			return state(k) == FULL;
-		}
-		inline bool empty(uint32_t k) const {
-			return state(k) == EMPTY;
-		}
-		inline bool tomb(uint32_t k) const {
-			return state(k) == TOMB;
-		}
-
-	public:
-		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
-
-		ordered_soa(uint32_t b);
-		~ordered_soa();
-		std::string table_type() const { return "ordered_soa"; }
-
-		void resize(uint32_t);
-		void set_max_load_factor(double f) { max_load_factor = f; }
-		
-		result insert(K key, V value, bool rebuilding = false);
-		bool query(K key, V *value);
-		result remove(K key);
-		void rebuild();
-
-		// Performance characteristics
-		uint64_t total_misses;
-		uint64_t inserts, queries, removes;
-		uint64_t insert_misses, query_misses, remove_misses;
-		uint64_t insert_shifts, longest_search;
-		uint64_t rebuild_inserts, rebuild_insert_misses;
-		uint64_t failed_inserts, failed_queries, failed_removes;
-		uint64_t duplicates;
-		uint64_t resizes, rebuilds;
-
-		void reset_perf_counts();
-		void report_testing_stats(std::ostream &os = std::cout,
-		                          bool verbose = true);
-
-		void cluster_len(std::map<int, int>*) const;
-		void search_distance(std::map<int, int>*) const;
-
-		int get_rebuild_window() const { return rebuild_window; }
-		double load_factor() const { return (double)records/buckets; }
-		double avg_misses() const { return miss_running_avg; }
-		uint32_t table_size() const { return buckets; }
-		uint64_t table_size_bytes() const {
-			return buckets*sizeof(record_t);
-		}
-		uint32_t num_records() const { return records; }
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using ordered_soa = ordered<K, V, Stats, soa_layout>;
 
-		// debugging
-		void dump();
-		bool disable_rebuilds;
-		bool check_ordering();
-};
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using ordered_aosoa = ordered<K, V, Stats, aosoa_layout>;
 #endif
@@ -0,0 +1,341 @@
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+// instrumentation policies for the hash tables.
+//
+// every table takes a Stats template parameter and inherits from it, so the
+// counters stay public members of the table (ht.inserts, ht.insert_misses,
+// ...).  the tables only ever call the hooks below; in NoStats they are
+// empty inline functions and the bookkeeping compiles away.
+//
+//   NoStats          nothing, for production builds
+//   CheapCounters    one integer increment per operation, no per-probe work
+//   ProbeHistograms  CheapCounters plus log2 probe/shift length histograms
+//   FullStats        CheapCounters plus per-operation miss and shift
+//                    totals, the longest search and the running miss
+//                    average (research runs); the same bookkeeping the
+//                    tables always did, and no histograms
+//
+// stats_name is the policy's name in bench's stats= and in the results.
+
+namespace perf {
+	enum optype { INSERT, QUERY, REMOVE, REBUILD_INS };
+	const int noptypes = 4;
+}
+
+// histogram with power-of-two buckets: bucket 0 counts zeros, bucket i
+// counts values in [2^(i-1), 2^i).  add() is a count-leading-zeros and an
+// increment, cheap enough to keep on the hot path
+struct log2_histogram {
+	static const int nbuckets = 65;
+	uint64_t count[nbuckets];
+
+	log2_histogram() { reset(); }
+	void reset() { std::fill(count, count + nbuckets, 0); }
+
+	static inline int bucket(uint64_t v) {
+		return v ? 64 - __builtin_clzll(v) : 0;
+	}
+	static uint64_t lower(int b) { return b ? 1ull << (b-1) : 0; }
+	static uint64_t upper(int b) { return b ? (1ull << (b-1))*2 - 1 : 0; }
+
+	inline void add(uint64_t v) { ++count[bucket(v)]; }
+
+	uint64_t total() const {
+		uint64_t t = 0;
+		for (int b = 0; b < nbuckets; ++b) t += count[b];
+		return t;
+	}
+
+	// upper bound of the bucket holding the p-th quantile, 0 <= p <= 1
+	uint64_t quantile(double p) const {
+		uint64_t t = total(), seen = 0;
+		if (!t) return 0;
+		for (int b = 0; b < nbuckets; ++b) {
+			seen += count[b];
+			if (seen >= p * t) return upper(b);
+		}
+		return upper(nbuckets-1);
+	}
+
+	// highest non-empty bucket
+	int max_bucket() const {
+		for (int b = nbuckets-1; b > 0; --b)
+			if (count[b]) return b;
+		return 0;
+	}
+
+	log2_histogram& operator+=(const log2_histogram &h) {
+		for (int b = 0; b < nbuckets; ++b) count[b] += h.count[b];
+		return *this;
+	}
+};
+
+// [lo-hi]:count for each non-empty bucket
+inline std::ostream&
+operator<<(std::ostream &os, const log2_histogram &h)
+{
+	os << '[';
+	for (int b = 0; b <= h.max_bucket(); ++b) {
+		if (!h.count[b]) continue;
+		os << log2_histogram::lower(b);
+		if (b > 1) os << '-' << log2_histogram::upper(b);
+		os << ':' << h.count[b] << ' ';
+	}
+	os << ']';
+	return os;
+}
+
+class NoStats {
+	public:
+	static constexpr const char *stats_name = "none";
+
+	protected:
+	using optype = perf::optype;
+
+	inline void count_op(optype) {}
+	inline void count_fail(optype) {}
+	inline void count_duplicate() {}
+	inline void count_resize() {}
+	inline void count_rebuild() {}
+	inline void record_probe(uint64_t, optype) {}
+	inline void count_shifts(uint64_t, optype) {}
+	inline void rebuild_queue(int) {}
+
+	public:
+	void reset_perf_counts() {}
+	void report_testing_stats(std::ostream &os = std::cout,
+	                          bool verbose = true) {}
+	double avg_misses() const { return 0; }
+};
+
+class CheapCounters {
+	public:
+	static constexpr const char *stats_name = "cheap";
+
+	protected:
+	using optype = perf::optype;
+
+	inline void count_op(optype op) {
+		switch(op) {
+		case perf::INSERT: ++inserts; break;
+		case perf::QUERY: ++queries; break;
+		case perf::REMOVE: ++removes; break;
+		case perf::REBUILD_INS: ++rebuild_inserts; break;
+		}
+	}
+	inline void count_fail(optype op) {
+		switch(op) {
+		case perf::INSERT:
+		case perf::REBUILD_INS: ++failed_inserts; break;
+		case perf::QUERY: ++failed_queries; break;
+		case perf::REMOVE: ++failed_removes; break;
+		}
+	}
+	inline void count_duplicate() { ++duplicates; }
+	inline void count_resize() { ++resizes; }
+	inline void count_rebuild() { ++rebuilds; }
+	inline void record_probe(uint64_t, optype) {}
+	inline void count_shifts(uint64_t, optype) {}
+	inline void rebuild_queue(int) {}
+
+	public:
+	uint64_t inserts, queries, removes, duplicates;
+	uint64_t rebuild_inserts;
+	uint64_t failed_inserts, failed_queries, failed_removes;
+	uint64_t resizes, rebuilds;
+
+	CheapCounters() : rebuilds(0) { reset_perf_counts(); }
+
+	void reset_perf_counts()
+	{
+		inserts = queries = removes = rebuild_inserts = 0;
+		failed_inserts = failed_removes = failed_queries = 0;
+		duplicates = 0;
+		resizes = 0;
+	}
+
+	void report_testing_stats(std::ostream &os = std::cout,
+	                          bool verbose = true)
+	{
+		if (verbose) {
+			os << "Fails\nInserts: " << failed_inserts
+			   << " (" << duplicates << " dup) / " << inserts
+			   << ", Queries: " << failed_queries << " / " << queries
+			   << ", Removes: " << failed_removes << " / " << removes
+			   << "\n";
+		} else {
+			os << inserts << "," << queries << "," << removes << ","
+			   << failed_inserts << "," << failed_queries << ","
+			   << failed_removes << "\n";
+		}
+	}
+
+	double avg_misses() const { return 0; }
+};
+
+class ProbeHistograms : public CheapCounters {
+	private:
+	log2_histogram probe_hist[perf::noptypes];
+	log2_histogram shift_hist[perf::noptypes];
+
+	protected:
+	inline void record_probe(uint64_t misses, optype op) {
+		probe_hist[op].add(misses);
+	}
+	inline void count_shifts(uint64_t s, optype op) {
+		shift_hist[op].add(s);
+	}
+
+	public:
+	static constexpr const char *stats_name = "histograms";
+
+	ProbeHistograms() { reset_perf_counts(); }
+
+	void reset_perf_counts()
+	{
+		CheapCounters::reset_perf_counts();
+		for (int op = 0; op < perf::noptypes; ++op) {
+			probe_hist[op].reset();
+			shift_hist[op].reset();
+		}
+	}
+
+	// probe lengths (slots passed over) and shift lengths (records
+	// moved to make room) for every operation since the last reset.
+	// only insert and rebuild-insert shift.
+	const log2_histogram& probe_histogram(perf::optype op) const {
+		return probe_hist[op];
+	}
+	const log2_histogram& shift_histogram(perf::optype op) const {
+		return shift_hist[op];
+	}
+
+	void report_histograms(std::ostream &os = std::cout) const
+	{
+		const char *name[] = { "insert", "query", "remove",
+		                       "rebuild insert" };
+		for (int op = 0; op < perf::noptypes; ++op) {
+			if (probe_hist[op].total())
+				os << name[op] << " probe lengths: "
+				   << probe_hist[op] << "\n";
+			if (shift_hist[op].total())
+				os << name[op] << " shift lengths: "
+				   << shift_hist[op] << "\n";
+		}
+	}
+};
+
+class FullStats : public CheapCounters {
+	private:
+	uint64_t search_count;
+	double miss_running_avg;
+
+	inline void update_misses(uint64_t misses, optype op)
+	{
+		int n = ++search_count;
+		total_misses += misses;
+		switch(op) {
+		case perf::INSERT:
+			insert_misses += misses; break;
+		case perf::QUERY:
+			query_misses += misses; break;
+		case perf::REMOVE:
+			remove_misses += misses; break;
+		case perf::REBUILD_INS:
+			rebuild_insert_misses += misses; break;
+		}
+		if (misses > longest_search) longest_search = misses;
+
+		miss_running_avg =
+		    miss_running_avg * (double)(n-1)/n + (double)misses/n;
+	}
+
+	protected:
+	inline void record_probe(uint64_t misses, optype op) {
+		if (misses) update_misses(misses, op);
+	}
+	inline void count_shifts(uint64_t s, optype op) {
+		if (op == perf::INSERT) insert_shifts += s;
+	}
+	inline void rebuild_queue(int q) {
+		max_rebuild_queue = std::max(max_rebuild_queue, q);
+	}
+
+	public:
+	static constexpr const char *stats_name = "full";
+
+	uint64_t total_misses;
+	uint64_t insert_misses, query_misses, remove_misses;
+	uint64_t rebuild_insert_misses;
+	uint64_t insert_shifts, longest_search;
+	int max_rebuild_queue;
+
+	FullStats() { reset_perf_counts(); }
+
+	void reset_perf_counts()
+	{
+		CheapCounters::reset_perf_counts();
+		insert_misses = query_misses = remove_misses = 0;
+		rebuild_insert_misses = 0;
+		insert_shifts = 0;
+		max_rebuild_queue = 0;
+		longest_search = 0;
+		total_misses = 0;
+		miss_running_avg = 0;
+		search_count = 0;
+	}
+
+	void report_testing_stats(std::ostream &os = std::cout,
+	                          bool verbose = true)
+	{
+		if (verbose) {
+			os << "Misses\n";
+			os << "Insert: " << insert_misses;
+			if (inserts)
+				os << ", " << (double)insert_misses/inserts
+				   << " miss/insert";
+			os << "\n";
+
+			os << "Query: " << query_misses;
+			if (queries)
+				os << ", " << (double)query_misses/queries
+				   << " miss/query";
+			os << "\n";
+
+			os << "Remove: " << remove_misses;
+			if (removes)
+				os << ", " << (double)remove_misses/removes
+				   << " miss/remove";
+			os << "\n";
+
+			os << "Total: " << total_misses
+			   << ", " << (double)total_misses/(inserts+queries+removes)
+			   << " miss/op\n";
+
+			os << "Fails\nInserts: " << failed_inserts
+			   << " (" << duplicates << " dup) / " << inserts
+			   << ", Queries: " << failed_queries << " / " << queries
+			   << ", Removes: " << failed_removes << " / " << removes
+			   << "\n";
+		} else {
+			os << insert_misses << ","
+			   << (inserts ? (double)insert_misses/inserts : 0) << ","
+			   << query_misses << ","
+			   << (queries ? (double)query_misses/queries : 0) << ","
+			   << remove_misses << ","
+			   << (removes ? (double)remove_misses/removes : 0) << ","
+			   << total_misses << ","
+			   << (double)total_misses/(inserts+queries+removes)
+			   << "\n";
+		}
+	}
+
+	double avg_misses() const { return miss_running_avg; }
+};
+
+#endif
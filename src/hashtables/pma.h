@@ -0,0 +1,138 @@
+#ifndef PMA_H
+#define PMA_H
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <map>
+#include "perfstats.h"
+
+// ordered linear probing on a packed memory array.
+//
+// records are kept sorted by (hash, key), as in ordered_aos, so a search
+// starts at hash(k) and walks only as far as the order says (left or
+// right, skipping gaps).  ordered_aos inserts by sliding everything up to
+// the next free slot, which at high load can be a very long memmove.
+// here the slots are split into segments of S ~ log2(n) slots, and
+// aligned runs of 2, 4, ... segments form the windows of an implicit
+// tree.  an insert that fits in its segment shifts at most S records;
+// into a full segment, it finds the smallest window whose density after
+// the insert is within that level's threshold and spreads the window's
+// records out again (rebalance), which is O(log^2 n) amortized moves.
+//
+// thresholds run from 1 at the segments to (1 + alpha)/2 at the root,
+// alpha being the load after the insert, so they leave room at any load
+// the testers ask for (up to x = 1000); the amortized bound grows as
+// 1/(1 - alpha) there, the price of packing the array that tightly.
+// if no window is within its threshold, the smallest one with room is
+// spread instead of the whole table.
+// a rebalance puts each record at its hash slot if it can, and as far
+// left as order and room allow otherwise, so records stay near home.
+// removes just empty the slot (no tombstones, no lower thresholds);
+// rebuild() rebalances the whole table, re-anchoring every record.
+//
+// with 32 bit keys the hash is monotone in the key, so the array is in
+// key order and a range is a contiguous run of slots.
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+class pma_aos : public Stats {
+	private:
+		enum slot_state { FULL, EMPTY };
+		using optype = perf::optype;
+		using enum perf::optype;
+
+		struct record_t {
+			K key;
+			V value;
+			slot_state state;
+		} *table;
+
+		uint32_t buckets;
+		uint32_t records;
+		int rebuild_window;
+
+		uint32_t seg_size;              // S
+		uint32_t segments;
+		int height;                     // levels above the segments
+		std::vector<uint32_t> seg_records;
+
+		int prime_index;
+		double max_load_factor;
+
+		uint32_t hash(K k) const;
+		inline bool before(K a, K b) const {
+			uint32_t ha = hash(a), hb = hash(b);
+			return ha < hb || (ha == hb && a < b);
+		}
+		void allocate(uint32_t b);
+		bool locate(K k, int64_t *left, int64_t *right, uint64_t *miss)
+		           const;
+		uint32_t seg_len(uint32_t g) const;
+		uint64_t slide(uint32_t from, uint32_t to);
+		void put(uint32_t slot, K k, V v);
+		uint64_t rebalance(uint32_t g, K k, V v);
+		uint64_t place(std::vector<record_t> &recs, uint32_t first,
+		               uint32_t end);
+
+		void reset_rebuild_window();
+
+		inline slot_state state(uint32_t k) const {
+			return table[k].state;
+		}
+		inline K& key(uint32_t k) const {
+			return table[k].key;
+		}
+		inline V& value(uint32_t k) const {
+			return table[k].value;
+		}
+
+		inline bool full(uint32_t k) const {
+			return state(k) == FULL;
+		}
+		inline bool empty(uint32_t k) const {
+			return state(k) == EMPTY;
+		}
+
+	public:
+		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
+
+		pma_aos(uint32_t b);
+		~pma_aos();
+		std::string table_type() const { return "pma_aos"; }
+
+		void resize(uint32_t);
+		void set_max_load_factor(double f) { max_load_factor = f; }
+
+		result insert(K key, V value, bool rebuilding = false);
+		bool query(K key, V *value);
+		result remove(K key);
+		void rebuild();
+
+		void cluster_len(std::map<int,int> *clust) const;
+		void search_distance(std::map<int,int> *disp) const;
+
+		int get_rebuild_window() const { return rebuild_window; }
+		double load_factor() const { return (double)records/buckets; }
+		std::size_t table_size() const { return buckets; }
+		std::size_t table_size_bytes() const {
+			return buckets*sizeof(record_t)
+			       + segments*sizeof(uint32_t);
+		}
+		std::size_t rec_width() const { return sizeof(record_t); }
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		// states live inside the records
+		std::size_t state_width() const { return 0; }
+		std::size_t num_records() const { return records; }
+
+		// debugging
+		void dump();
+		bool disable_rebuilds;
+		bool check_ordering();
+};
+#endif
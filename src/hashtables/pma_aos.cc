@@ -0,0 +1,455 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include "pma.h"
+#include "primes.h"
+#include "wide.h"
+
+using std::cerr, std::size_t;
+
+template class pma_aos<>;
+template class pma_aos<uint32_t, uint32_t, CheapCounters>;
+template class pma_aos<uint32_t, uint32_t, ProbeHistograms>;
+template class pma_aos<uint32_t, uint32_t, NoStats>;
+template class pma_aos<uint32_t, uint64_t>;
+template class pma_aos<uint64_t, uint32_t>;
+template class pma_aos<uint64_t, uint64_t>;
+template class pma_aos<key64, uint32_t>;
+template class pma_aos<key64, uint64_t>;
+template class pma_aos<uint32_t, blob<32>>;
+template class pma_aos<uint32_t, blob<64>>;
+template class pma_aos<uint32_t, blob<128>>;
+template class pma_aos<key64, blob<32>>;
+template class pma_aos<key64, blob<64>>;
+template class pma_aos<key64, blob<128>>;
+template class pma_aos<key128, uint32_t>;
+template class pma_aos<key128, uint64_t>;
+template class pma_aos<key128, blob<32>>;
+template class pma_aos<key128, blob<64>>;
+template class pma_aos<key128, blob<128>>;
+
+template <typename K, typename V, typename Stats>
+pma_aos<K, V, Stats>::pma_aos(uint32_t b)
+{
+	prime_index = 0;
+	while(b > primes[prime_index])
+		prime_index++;
+
+	allocate(b);
+	records = 0;
+	max_load_factor = 0.5;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+	disable_rebuilds = false;
+}
+
+template <typename K, typename V, typename Stats>
+pma_aos<K, V, Stats>::~pma_aos()
+{
+	delete[] table;
+}
+
+template <typename K, typename V, typename Stats>
+uint32_t
+pma_aos<K, V, Stats>::hash(K k) const
+{
+	return fastrange(k, buckets);
+}
+
+// segments of the next power of two >= log2(b) slots (at least 8)
+template <typename K, typename V, typename Stats>
+void
+pma_aos<K, V, Stats>::allocate(uint32_t b)
+{
+	uint32_t lg = 32 - __builtin_clz(b | 1);
+
+	buckets = b;
+	seg_size = 8;
+	while (seg_size < lg) seg_size *= 2;
+	segments = (b + seg_size - 1) / seg_size;
+	height = 0;
+	while ((1u << height) < segments) ++height;
+	seg_records.assign(segments, 0);
+
+	table = new record_t[b];
+	if (!table) {
+		cerr << "Couldn't allocate\n";
+		exit(1);
+	}
+	for (uint32_t i = 0; i < b; ++i)
+		table[i].state = EMPTY;
+}
+
+template <typename K, typename V, typename Stats>
+uint32_t
+pma_aos<K, V, Stats>::seg_len(uint32_t g) const
+{
+	return std::min(seg_size, buckets - g*seg_size);
+}
+
+template <typename K, typename V, typename Stats>
+void
+pma_aos<K, V, Stats>::resize(uint32_t b)
+{
+	std::vector<record_t> recs;
+	recs.reserve(records);
+	for (uint32_t i = 0; i < buckets; ++i)
+		if (full(i)) recs.push_back(table[i]);
+	delete[] table;
+
+	// the order depends on the hash, which depends on the size
+	allocate(b);
+	std::sort(recs.begin(), recs.end(),
+	          [this](const record_t &x, const record_t &y) {
+		return before(x.key, y.key);
+	});
+	place(recs, 0, buckets);
+	for (size_t i = 0; i < recs.size(); ++i)
+		this->count_op(REBUILD_INS);
+
+	this->count_resize();
+}
+
+// find k, or the gap it belongs in: *left is the last record before k
+// (-1 if none), *right the first at or after it (buckets if none).
+// starts at hash(k) and walks towards k, skipping empty slots
+template <typename K, typename V, typename Stats>
+bool
+pma_aos<K, V, Stats>::locate(K k, int64_t *left, int64_t *right,
+                             uint64_t *miss) const
+{
+	int64_t s = hash(k);
+	int64_t q = s, p;
+
+	while (q < buckets && empty(q)) { ++q; ++*miss; }
+
+	if (q < buckets && before(key(q), k)) {
+		do {
+			p = q;
+			++*miss;
+			++q;
+			while (q < buckets && empty(q)) { ++q; ++*miss; }
+		} while (q < buckets && before(key(q), k));
+	} else {
+		p = s - 1;
+		while (true) {
+			while (p >= 0 && empty(p)) { --p; ++*miss; }
+			if (p < 0 || before(key(p), k)) break;
+			q = p--;
+			++*miss;
+		}
+	}
+
+	*left = p;
+	*right = q;
+	return q < buckets && key(q) == k;
+}
+
+template <typename K, typename V, typename Stats>
+void
+pma_aos<K, V, Stats>::put(uint32_t slot, K k, V v)
+{
+	table[slot] = record_t{ k, v, FULL };
+	++seg_records[slot / seg_size];
+}
+
+// move the records between 'from' and the free slot 'to' one slot
+// towards 'to', leaving 'from' free
+template <typename K, typename V, typename Stats>
+uint64_t
+pma_aos<K, V, Stats>::slide(uint32_t from, uint32_t to)
+{
+	if (to > from) {
+		memmove(&table[from+1], &table[from], sizeof(record_t)*(to-from));
+		return to - from;
+	} else {
+		memmove(&table[to], &table[to+1], sizeof(record_t)*(from-to));
+		return from - to;
+	}
+}
+
+// lay recs (in order) out over [first, end): each at its hash slot if
+// possible, else as close to it as order and the room left allow.
+// returns how many records changed slot
+template <typename K, typename V, typename Stats>
+uint64_t
+pma_aos<K, V, Stats>::place(std::vector<record_t> &recs, uint32_t first,
+                            uint32_t end)
+{
+	for (uint32_t g = first / seg_size; g*seg_size < end; ++g)
+		seg_records[g] = 0;
+
+	// slots only go up, so table[pos] still holds what was there before
+	uint64_t moved = 0;
+	int64_t prev = (int64_t)first - 1;
+	const size_t m = recs.size();
+	for (size_t i = 0; i < m; ++i) {
+		int64_t lo = prev + 1;
+		int64_t hi = (int64_t)end - (int64_t)(m - i);
+		int64_t pos = std::clamp((int64_t)hash(recs[i].key), lo, hi);
+		for (int64_t j = lo; j < pos; ++j)
+			table[j].state = EMPTY;
+		if (!full(pos) || key(pos) != recs[i].key)
+			++moved;
+		put(pos, recs[i].key, recs[i].value);
+		prev = pos;
+	}
+	for (int64_t j = prev + 1; j < end; ++j)
+		table[j].state = EMPTY;
+	return moved;
+}
+
+// segment g is full: spread the smallest enclosing window that is
+// within its density threshold with k in it.  if none is (the table is
+// packed tighter than the root threshold), the smallest that has room
+template <typename K, typename V, typename Stats>
+uint64_t
+pma_aos<K, V, Stats>::rebalance(uint32_t g, K k, V v)
+{
+	const double alpha = (records + 1.0) / buckets;
+	const double root = (1 + alpha) / 2;
+	uint32_t first = 0, last = segments;
+	int64_t fit_first = -1, fit_last = -1;
+
+	for (int l = 1; l < height; ++l) {
+		first = (g >> l) << l;
+		last = std::min(first + (1u << l), segments);
+		uint64_t n = 1;
+		for (uint32_t i = first; i < last; ++i)
+			n += seg_records[i];
+		uint32_t slots = std::min(last*seg_size, buckets)
+		                 - first*seg_size;
+		if (n <= (1 - (1 - root) * l / height) * slots)
+			break;
+		if (fit_first < 0 && n <= slots) {
+			fit_first = first;
+			fit_last = last;
+		}
+		first = 0;
+		last = segments;
+	}
+	if (first == 0 && last == segments && fit_first >= 0) {
+		first = fit_first;
+		last = fit_last;
+	}
+
+	uint32_t a = first*seg_size, b = std::min(last*seg_size, buckets);
+	std::vector<record_t> recs;
+	bool added = false;
+	for (uint32_t i = a; i < b; ++i)
+		if (full(i)) {
+			if (!added && before(k, key(i))) {
+				recs.push_back(record_t{ k, v, FULL });
+				added = true;
+			}
+			recs.push_back(table[i]);
+		}
+	if (!added) recs.push_back(record_t{ k, v, FULL });
+
+	return place(recs, a, b);
+}
+
+template <typename K, typename V, typename Stats>
+pma_aos<K, V, Stats>::result
+pma_aos<K, V, Stats>::insert(K k, V v, bool rebuilding)
+{
+	int64_t left, right;
+	uint64_t miss = 0, moved = 0;
+	optype ins_type = rebuilding ? REBUILD_INS : INSERT;
+
+	if (records>=buckets) {
+		this->count_fail(INSERT);
+		return FULLTABLE;
+	}
+
+	bool found = locate(k, &left, &right, &miss);
+	this->record_probe(miss, ins_type);
+	if (found) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return DUPLICATE;
+	}
+
+	if (right - left > 1) {
+		// a gap: as close to home as it allows
+		put(std::clamp((int64_t)hash(k), left + 1, right - 1), k, v);
+	} else {
+		// the segment it goes in; right's unless k goes last
+		uint32_t g = (right < buckets ? right : left) / seg_size;
+		uint32_t a = g*seg_size, b = a + seg_len(g);
+
+		if (seg_records[g] < seg_len(g)) {
+			// nearest free slot in the segment
+			int64_t f = -1;
+			for (int64_t d = 1; f < 0; ++d) {
+				if (right + d - 1 < b && right + d - 1 >= a &&
+				    empty(right + d - 1))
+					f = right + d - 1;
+				else if (left - d + 1 >= a && left - d + 1 < b &&
+				         empty(left - d + 1))
+					f = left - d + 1;
+			}
+			if (f >= right) {
+				moved = slide(right, f);
+				put(right, k, v);
+			} else {
+				moved = slide(left, f);
+				put(left, k, v);
+			}
+		} else {
+			moved = rebalance(g, k, v);
+		}
+	}
+	++records;
+
+	this->count_shifts(moved, ins_type);
+	this->count_op(ins_type);
+
+	// automatic resizing
+	if (load_factor() > max_load_factor) {
+		cerr << "load factor " << max_load_factor << " exceeded\n";
+		resize(primes[++prime_index]);
+	}
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return REBUILD;
+	}
+
+	return SUCCESS;
+}
+
+template <typename K, typename V, typename Stats>
+bool
+pma_aos<K, V, Stats>::query(K k, V *v)
+{
+	int64_t left, right;
+	uint64_t miss = 0;
+	this->count_op(QUERY);
+
+	bool found = locate(k, &left, &right, &miss);
+	this->record_probe(miss, QUERY);
+	if (found) {
+		*v = value(right);
+		return true;
+	} else {
+		this->count_fail(QUERY);
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+pma_aos<K, V, Stats>::result
+pma_aos<K, V, Stats>::remove(K k)
+{
+	int64_t left, right;
+	uint64_t miss = 0;
+	this->count_op(REMOVE);
+
+	bool found = locate(k, &left, &right, &miss);
+	this->record_probe(miss, REMOVE);
+	if (found) {
+		table[right].state = EMPTY;
+		--seg_records[right / seg_size];
+		--records;
+		return result::SUCCESS;
+	} else {
+		this->count_fail(REMOVE);
+		return result::FAILURE;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+void
+pma_aos<K, V, Stats>::reset_rebuild_window()
+{
+	rebuild_window = buckets/2 * (1.0 - load_factor()) + 1;
+}
+
+template <typename K, typename V, typename Stats>
+void
+pma_aos<K, V, Stats>::rebuild()
+{
+	std::vector<record_t> recs;
+	recs.reserve(records);
+	for (uint32_t i = 0; i < buckets; ++i)
+		if (full(i)) recs.push_back(table[i]);
+	place(recs, 0, buckets);
+
+	this->count_rebuild();
+	reset_rebuild_window();
+}
+
+// fill in a histogram of cluster lengths
+template <typename K, typename V, typename Stats>
+void
+pma_aos<K, V, Stats>::cluster_len(std::map<int,int> *clust) const
+{
+	int run = 0;
+	for (uint32_t p = 0; p < buckets; ++p) {
+		if (full(p)) {
+			++run;
+		} else if (run) {
+			(*clust)[run]++;
+			run = 0;
+		}
+	}
+	if (run) (*clust)[run]++;
+}
+
+// fill in a histogram of distances between a record and its hash slot,
+// either way
+template <typename K, typename V, typename Stats>
+void
+pma_aos<K, V, Stats>::search_distance(std::map<int,int> *disp) const
+{
+	for (uint32_t p = 0; p < buckets; ++p)
+		if (full(p)) {
+			uint32_t h = hash(key(p));
+			(*disp)[p > h ? p - h : h - p]++;
+		}
+}
+
+template <typename K, typename V, typename Stats>
+bool
+pma_aos<K, V, Stats>::check_ordering()
+{
+	int64_t prev = -1;
+	std::vector<uint32_t> count(segments, 0);
+
+	for (uint32_t p = 0; p < buckets; ++p) {
+		if (!full(p)) continue;
+		++count[p / seg_size];
+		if (prev >= 0 && !before(key(prev), key(p))) {
+			cerr << "Ordering violated at slot " << p << "\n";
+			return false;
+		}
+		prev = p;
+	}
+	if (count != seg_records) {
+		cerr << "Segment counts are off\n";
+		return false;
+	}
+	return true;
+}
+
+template <typename K, typename V, typename Stats>
+void
+pma_aos<K, V, Stats>::dump()
+{
+	for(size_t i=0; i<buckets; i++) {
+		if ((i!=0) && (i%seg_size == 0)) std::cout << "\n";
+		std::cout.width(4);
+		std::cout << i << ": [";
+
+		if(full(i)) {
+			std::cout.width(4);
+			std::cout << hash(key(i)) << "]";
+			std::cout.width(4);
+			std::cout << key(i);
+		} else {
+			std::cout << "    ]    ";
+		}
+	}
+}
@@ -0,0 +1,359 @@
+#include <iostream>
+#include <cassert>
+#include "robinhood.h"
+#include "primes.h"
+#include "wide.h"
+
+using std::cerr, std::size_t;
+
+template class robinhood<uint32_t, uint32_t, FullStats, aos_layout>;
+template class robinhood<uint32_t, uint32_t, CheapCounters, aos_layout>;
+template class robinhood<uint32_t, uint32_t, ProbeHistograms, aos_layout>;
+template class robinhood<uint32_t, uint32_t, NoStats, aos_layout>;
+template class robinhood<uint32_t, uint64_t, FullStats, aos_layout>;
+template class robinhood<uint64_t, uint32_t, FullStats, aos_layout>;
+template class robinhood<uint64_t, uint64_t, FullStats, aos_layout>;
+template class robinhood<key64, uint32_t, FullStats, aos_layout>;
+template class robinhood<key64, uint64_t, FullStats, aos_layout>;
+template class robinhood<uint32_t, blob<32>, FullStats, aos_layout>;
+template class robinhood<uint32_t, blob<64>, FullStats, aos_layout>;
+template class robinhood<uint32_t, blob<128>, FullStats, aos_layout>;
+template class robinhood<key64, blob<32>, FullStats, aos_layout>;
+template class robinhood<key64, blob<64>, FullStats, aos_layout>;
+template class robinhood<key64, blob<128>, FullStats, aos_layout>;
+template class robinhood<key128, uint32_t, FullStats, aos_layout>;
+template class robinhood<key128, uint64_t, FullStats, aos_layout>;
+template class robinhood<key128, blob<32>, FullStats, aos_layout>;
+template class robinhood<key128, blob<64>, FullStats, aos_layout>;
+template class robinhood<key128, blob<128>, FullStats, aos_layout>;
+
+template class robinhood<uint32_t, uint32_t, FullStats, soa_layout>;
+template class robinhood<uint32_t, uint32_t, CheapCounters, soa_layout>;
+template class robinhood<uint32_t, uint32_t, ProbeHistograms, soa_layout>;
+template class robinhood<uint32_t, uint32_t, NoStats, soa_layout>;
+template class robinhood<uint32_t, uint64_t, FullStats, soa_layout>;
+template class robinhood<uint64_t, uint32_t, FullStats, soa_layout>;
+template class robinhood<uint64_t, uint64_t, FullStats, soa_layout>;
+template class robinhood<key64, uint32_t, FullStats, soa_layout>;
+template class robinhood<key64, uint64_t, FullStats, soa_layout>;
+template class robinhood<uint32_t, blob<32>, FullStats, soa_layout>;
+template class robinhood<uint32_t, blob<64>, FullStats, soa_layout>;
+template class robinhood<uint32_t, blob<128>, FullStats, soa_layout>;
+template class robinhood<key64, blob<32>, FullStats, soa_layout>;
+template class robinhood<key64, blob<64>, FullStats, soa_layout>;
+template class robinhood<key64, blob<128>, FullStats, soa_layout>;
+template class robinhood<key128, uint32_t, FullStats, soa_layout>;
+template class robinhood<key128, uint64_t, FullStats, soa_layout>;
+template class robinhood<key128, blob<32>, FullStats, soa_layout>;
+template class robinhood<key128, blob<64>, FullStats, soa_layout>;
+template class robinhood<key128, blob<128>, FullStats, soa_layout>;
+
+template class robinhood<uint32_t, uint32_t, FullStats, aosoa_layout>;
+template class robinhood<uint32_t, uint32_t, CheapCounters, aosoa_layout>;
+template class robinhood<uint32_t, uint32_t, ProbeHistograms, aosoa_layout>;
+template class robinhood<uint32_t, uint32_t, NoStats, aosoa_layout>;
+template class robinhood<uint32_t, uint64_t, FullStats, aosoa_layout>;
+template class robinhood<uint64_t, uint32_t, FullStats, aosoa_layout>;
+template class robinhood<uint64_t, uint64_t, FullStats, aosoa_layout>;
+template class robinhood<key64, uint32_t, FullStats, aosoa_layout>;
+template class robinhood<key64, uint64_t, FullStats, aosoa_layout>;
+template class robinhood<uint32_t, blob<32>, FullStats, aosoa_layout>;
+template class robinhood<uint32_t, blob<64>, FullStats, aosoa_layout>;
+template class robinhood<uint32_t, blob<128>, FullStats, aosoa_layout>;
+template class robinhood<key64, blob<32>, FullStats, aosoa_layout>;
+template class robinhood<key64, blob<64>, FullStats, aosoa_layout>;
+template class robinhood<key64, blob<128>, FullStats, aosoa_layout>;
+template class robinhood<key128, uint32_t, FullStats, aosoa_layout>;
+template class robinhood<key128, uint64_t, FullStats, aosoa_layout>;
+template class robinhood<key128, blob<32>, FullStats, aosoa_layout>;
+template class robinhood<key128, blob<64>, FullStats, aosoa_layout>;
+template class robinhood<key128, blob<128>, FullStats, aosoa_layout>;
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+robinhood<K, V, Stats, L>::robinhood(uint32_t b)
+{
+	prime_index = 0;
+	while(b > primes[prime_index])
+		prime_index++;
+
+	allocate(b);
+	records = 0;
+	max_load_factor = 0.5;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+	disable_rebuilds = false;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+robinhood<K, V, Stats, L>::~robinhood()
+{
+	table.release();
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+uint32_t
+robinhood<K, V, Stats, L>::hash(K k) const
+{
+	return fastrange(k, buckets);
+}
+
+// a table of b empty slots
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+robinhood<K, V, Stats, L>::allocate(uint32_t b)
+{
+	table.allocate(b);
+	for(uint32_t i=0; i<b; i++)
+		setempty(i);
+	buckets = b;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+robinhood<K, V, Stats, L>::resize(uint32_t b)
+{
+	uint32_t oldbuckets = buckets;
+	L<K, V, uint32_t> oldtable = table;
+
+	allocate(b);
+	records = 0;
+
+	for(uint32_t i=0; i<oldbuckets; ++i)
+		if (oldtable.state(i))
+			insert(oldtable.key(i), oldtable.value(i), true);
+
+	oldtable.release();
+	this->count_resize();
+}
+
+// walk from k's home slot while the records there are at least as far
+// from home as k would be.  *slot is k's slot if found, otherwise where
+// k belongs, with *len the probe sequence length it would have there
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+robinhood<K, V, Stats, L>::probe(K k, uint32_t *slot, uint32_t *len,
+                                  optype operation)
+{
+	uint32_t s = hash(k);
+	uint32_t l = 1;
+	bool res = false;
+
+	while (psl(s) >= l) {
+		if (psl(s) == l && key(s) == k) {
+			res = true;
+			break;
+		}
+		if (++s == buckets) s = 0;
+		++l;
+	}
+
+	this->record_probe(l - 1, operation);
+	*slot = s;
+	*len = l;
+	return res;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+robinhood<K, V, Stats, L>::result
+robinhood<K, V, Stats, L>::insert(K k, V v, bool rebuilding)
+{
+	uint32_t slot, l;
+	optype ins_type = rebuilding ? REBUILD_INS : INSERT;
+
+	if (records>=buckets) {
+		this->count_fail(INSERT);
+		return FULLTABLE;
+	}
+
+	if (probe(k, &slot, &l, ins_type)) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return DUPLICATE;
+	}
+
+	// take the slot, and carry whoever had it further along, swapping
+	// with every record closer to home than the one carried
+	uint64_t moved = 0;
+	while (full(slot)) {
+		if (psl(slot) < l) {
+			swap(slot, &k, &v, &l);
+			++moved;
+		}
+		if (++slot == buckets) slot = 0;
+		++l;
+	}
+	set(slot, k, v, l);
+	++records;
+
+	this->count_shifts(moved, ins_type);
+	this->count_op(ins_type);
+
+	// automatic resizing
+	if (load_factor() > max_load_factor) {
+		cerr << "load factor " << max_load_factor << " exceeded\n";
+		resize(primes[++prime_index]);
+	}
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return REBUILD;
+	}
+
+	return SUCCESS;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+robinhood<K, V, Stats, L>::query(K k, V *v)
+{
+	uint32_t slot, l;
+	this->count_op(QUERY);
+
+	if (probe(k, &slot, &l, QUERY)) {
+		*v = value(slot);
+		return true;
+	} else {
+		this->count_fail(QUERY);
+		return false;
+	}
+}
+
+// backward shift: pull the rest of the cluster one slot closer to home,
+// up to a record already at home or an empty slot
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+robinhood<K, V, Stats, L>::result
+robinhood<K, V, Stats, L>::remove(K k)
+{
+	uint32_t slot, l;
+	this->count_op(REMOVE);
+
+	if (!probe(k, &slot, &l, REMOVE)) {
+		this->count_fail(REMOVE);
+		return result::FAILURE;
+	}
+
+	uint64_t moved = 0;
+	uint32_t next = slot + 1 == buckets ? 0 : slot + 1;
+	while (psl(next) > 1) {
+		move(slot, next);
+		slot = next;
+		if (++next == buckets) next = 0;
+		++moved;
+	}
+	setempty(slot);
+	--records;
+
+	this->count_shifts(moved, REMOVE);
+	return result::SUCCESS;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+robinhood<K, V, Stats, L>::reset_rebuild_window()
+{
+	rebuild_window = buckets/2 * (1.0 - load_factor()) + 1;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+robinhood<K, V, Stats, L>::rebuild()
+{
+	reset_rebuild_window();
+	this->count_rebuild();
+}
+
+// fill in a histogram of cluster lengths
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+robinhood<K, V, Stats, L>::cluster_len(std::map<int,int> *clust) const
+{
+	uint32_t first_empty, last_empty, p=0;
+
+	while (p < buckets && full(p)) ++p;
+	if (p == buckets) {
+		(*clust)[buckets]++;
+		return;
+	}
+	first_empty = last_empty = p;
+
+	while(p < buckets) {
+		if (empty(p)) {
+			int dist = p - last_empty;
+			if (dist > 1) (*clust)[dist-1]++;
+			last_empty = p;
+		}
+		p++;
+	}
+
+	if (buckets-last_empty+first_empty-1 > 0)
+		(*clust)[buckets-last_empty+first_empty-1]++;
+}
+
+// fill in a histogram of distances from home
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+robinhood<K, V, Stats, L>::search_distance(std::map<int,int> *disp) const
+{
+	for(uint32_t p = 0; p < buckets; ++p)
+		if (full(p))
+			(*disp)[psl(p) - 1]++;
+}
+
+// every record's length matches its position, and no record is more
+// than one further from home than the one before it
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+bool
+robinhood<K, V, Stats, L>::check_ordering()
+{
+	for(uint32_t p = 0; p < buckets; ++p) {
+		if (empty(p)) continue;
+		uint32_t h = hash(key(p));
+		uint32_t d = p >= h ? p - h : buckets - h + p;
+		if (d + 1 != psl(p)) {
+			cerr << "Wrong length at slot " << p << "\n";
+			return false;
+		}
+		uint32_t prev = p ? p - 1 : buckets - 1;
+		if (psl(p) > psl(prev) + 1) {
+			cerr << "Ordering violated at slot " << p << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename K, typename V, typename Stats,
+          template <typename, typename, typename> class L>
+void
+robinhood<K, V, Stats, L>::dump()
+{
+	for(size_t i=0; i<buckets; i++) {
+		if ((i!=0) && (i%10 == 0)) std::cout << "\n";
+		std::cout.width(4);
+		std::cout << i << ": [";
+
+		if(full(i)) {
+			std::cout.width(4);
+			std::cout << psl(i) << "]";
+			std::cout.width(4);
+			std::cout << key(i);
+		} else {
+			std::cout << "    ]    ";
+		}
+	}
+}
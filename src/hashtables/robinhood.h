@@ -0,0 +1,136 @@
+#ifndef ROBINHOOD_H
+#define ROBINHOOD_H
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <map>
+#include "perfstats.h"
+#include "layout.h"
+
+// Robin Hood linear probing.
+//
+// each slot keeps its record's probe sequence length: 1 in its home slot,
+// 2 one past it, ..., 0 if the slot is empty.  an insert walking past a
+// record closer to home than itself takes that slot and carries the
+// evicted record on, so lengths stay even and a search can stop at the
+// first record closer to home than the key would be.  removes shift the
+// rest of the cluster back one slot until a record in its home slot or
+// an empty one: no tombstones, so there's nothing for a rebuild to clean
+// up.  rebuild() only restarts the rebuild window, which the tables keep
+// so the testers' rebuild protocol runs unchanged.  written once for
+// every slot layout (layout.h).
+
+template <typename K,
+          typename V,
+          typename Stats,
+          template <typename, typename, typename> class Layout>
+class robinhood : public Stats {
+	private:
+		using optype = perf::optype;
+		using enum perf::optype;
+
+		// the probe sequence length is the slot's state
+		Layout<K, V, uint32_t> table;
+
+		uint32_t buckets;
+		uint32_t records;
+		int rebuild_window;
+
+		int prime_index;
+		double max_load_factor;
+
+		uint32_t hash(K k) const;
+		bool probe(K k, uint32_t *slot, uint32_t *len,
+		           optype operation);
+		void allocate(uint32_t b);
+
+		void reset_rebuild_window();
+
+		inline uint32_t psl(uint32_t k) const {
+			return table.state(k);
+		}
+		inline K& key(uint32_t k) const {
+			return table.key(k);
+		}
+		inline V& value(uint32_t k) const {
+			return table.value(k);
+		}
+
+		inline void set(uint32_t k, K x, V v, uint32_t l) {
+			table.key(k) = x;
+			table.value(k) = v;
+			table.state(k) = l;
+		}
+		inline void swap(uint32_t k, K *x, V *v, uint32_t *l) {
+			std::swap(table.key(k), *x);
+			std::swap(table.value(k), *v);
+			std::swap(table.state(k), *l);
+		}
+		inline void move(uint32_t dst, uint32_t src) {
+			table.key(dst) = table.key(src);
+			table.value(dst) = table.value(src);
+			table.state(dst) = table.state(src) - 1;
+		}
+		inline void setempty(uint32_t k) { table.state(k) = 0; }
+
+		inline bool full(uint32_t k) const { return psl(k) != 0; }
+		inline bool empty(uint32_t k) const { return psl(k) == 0; }
+
+	public:
+		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
+
+		robinhood(uint32_t b);
+		~robinhood();
+		std::string table_type() const {
+			return std::string("robinhood_")
+			       + Layout<K, V, uint32_t>::name;
+		}
+
+		void resize(uint32_t);
+		void set_max_load_factor(double f) { max_load_factor = f; }
+
+		result insert(K key, V value, bool rebuilding = false);
+		bool query(K key, V *value);
+		result remove(K key);
+		void rebuild();
+
+		void cluster_len(std::map<int,int> *clust) const;
+		void search_distance(std::map<int,int> *disp) const;
+
+		int get_rebuild_window() const { return rebuild_window; }
+		double load_factor() const { return (double)records/buckets; }
+		std::size_t table_size() const { return buckets; }
+		std::size_t table_size_bytes() const {
+			return table.bytes(buckets);
+		}
+		std::size_t rec_width() const { return table.rec_width(); }
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		std::size_t state_width() const { return table.state_width(); }
+		std::size_t num_records() const { return records; }
+
+		// debugging
+		void dump();
+		bool disable_rebuilds;
+		bool check_ordering();
+};
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using robinhood_aos = robinhood<K, V, Stats, aos_layout>;
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using robinhood_soa = robinhood<K, V, Stats, soa_layout>;
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+using robinhood_aosoa = robinhood<K, V, Stats, aosoa_layout>;
+#endif
@@ -0,0 +1,122 @@
+#ifndef SWISS_H
+#define SWISS_H
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <map>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "perfstats.h"
+
+// Swiss-table style group probing.
+//
+// next to the records is one control byte per slot: EMPTY, DELETED, or
+// for a full slot 7 bits of the key's hash (its tag).  slots come in
+// groups of 16; a search compares a whole group's control bytes against
+// the tag at once (SSE2, or a loop without it), checks the keys of the
+// matches, and moves on to the next group only if this one has no empty
+// slot.  a miss in a group with an empty slot costs one compare and no
+// key reads, which is the case the linear schemes do worst.
+//
+// a remove leaves EMPTY if its group still has an empty slot (no search
+// ever went past it) and a DELETED tombstone otherwise; rebuild() rehashes
+// in place of the tombstones, on the same rebuild window as linear_aos.
+//
+// the slot count is rounded up to whole groups.  misses count the extra
+// groups probed plus tag matches whose key differed; nothing shifts.
+
+template <typename K = uint32_t,
+          typename V = uint32_t,
+          typename Stats = FullStats>
+class swiss_aos : public Stats {
+	private:
+		using optype = perf::optype;
+		using enum perf::optype;
+
+		static const int group_size = 16;
+		static const uint8_t EMPTY = 0x80;
+		static const uint8_t DELETED = 0xfe;
+
+		struct record_t {
+			K key;
+			V value;
+		} *table;
+		uint8_t *ctrl;
+
+		uint32_t buckets;
+		uint32_t groups;
+		uint32_t records;
+		uint32_t tombs;
+		int rebuild_window;
+
+		int prime_index;
+		double max_load_factor;
+
+		uint64_t hash(K k) const;
+		inline uint32_t home(uint64_t h) const {
+			return (uint32_t)(((h >> 32) * groups) >> 32);
+		}
+		static inline uint8_t tag(uint64_t h) { return h & 0x7f; }
+
+		// bit i set if slot i of group g matches
+		uint32_t match(uint32_t g, uint8_t t) const;
+		uint32_t match_empty(uint32_t g) const;
+		uint32_t match_free(uint32_t g) const;     // empty or deleted
+
+		bool probe(K k, uint64_t h, uint32_t *slot, optype operation);
+		void allocate(uint32_t b);
+
+		void reset_rebuild_window();
+
+		inline K& key(uint32_t k) const {
+			return table[k].key;
+		}
+		inline V& value(uint32_t k) const {
+			return table[k].value;
+		}
+		inline bool full(uint32_t k) const { return !(ctrl[k] & 0x80); }
+		inline bool empty(uint32_t k) const { return ctrl[k] == EMPTY; }
+		inline bool tomb(uint32_t k) const { return ctrl[k] == DELETED; }
+
+	public:
+		enum result { SUCCESS, FAILURE, REBUILD, DUPLICATE, FULLTABLE };
+		using key_type = K;
+		using value_type = V;
+
+		swiss_aos(uint32_t b);
+		~swiss_aos();
+		std::string table_type() const { return "swiss_aos"; }
+
+		void resize(uint32_t);
+		void set_max_load_factor(double f) { max_load_factor = f; }
+
+		result insert(K key, V value, bool rebuilding = false);
+		bool query(K key, V *value);
+		result remove(K key);
+		void rebuild();
+
+		// runs of full groups, and groups from home to each record
+		void cluster_len(std::map<int,int> *clust) const;
+		void search_distance(std::map<int,int> *disp) const;
+
+		int get_rebuild_window() const { return rebuild_window; }
+		double load_factor() const { return (double)records/buckets; }
+		std::size_t table_size() const { return buckets; }
+		std::size_t table_size_bytes() const {
+			return buckets*(sizeof(record_t) + 1);
+		}
+		std::size_t rec_width() const { return sizeof(record_t); }
+		std::size_t key_width() const { return sizeof(K); }
+		std::size_t value_width() const { return sizeof(V); }
+		std::size_t state_width() const { return 1; }
+		std::size_t num_records() const { return records; }
+
+		// debugging
+		void dump();
+		bool disable_rebuilds;
+		bool check_ordering() { return true; }
+};
+#endif
@@ -0,0 +1,334 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include "swiss.h"
+#include "primes.h"
+#include "wide.h"
+
+using std::cerr, std::size_t;
+
+template class swiss_aos<>;
+template class swiss_aos<uint32_t, uint32_t, CheapCounters>;
+template class swiss_aos<uint32_t, uint32_t, ProbeHistograms>;
+template class swiss_aos<uint32_t, uint32_t, NoStats>;
+template class swiss_aos<uint32_t, uint64_t>;
+template class swiss_aos<uint64_t, uint32_t>;
+template class swiss_aos<uint64_t, uint64_t>;
+template class swiss_aos<key64, uint32_t>;
+template class swiss_aos<key64, uint64_t>;
+template class swiss_aos<uint32_t, blob<32>>;
+template class swiss_aos<uint32_t, blob<64>>;
+template class swiss_aos<uint32_t, blob<128>>;
+template class swiss_aos<key64, blob<32>>;
+template class swiss_aos<key64, blob<64>>;
+template class swiss_aos<key64, blob<128>>;
+template class swiss_aos<key128, uint32_t>;
+template class swiss_aos<key128, uint64_t>;
+template class swiss_aos<key128, blob<32>>;
+template class swiss_aos<key128, blob<64>>;
+template class swiss_aos<key128, blob<128>>;
+
+template <typename K, typename V, typename Stats>
+swiss_aos<K, V, Stats>::swiss_aos(uint32_t b)
+{
+	prime_index = 0;
+	while(b > primes[prime_index])
+		prime_index++;
+
+	allocate(b);
+	records = 0;
+	tombs = 0;
+	max_load_factor = 0.5;
+
+	this->reset_perf_counts();
+	reset_rebuild_window();
+	disable_rebuilds = false;
+}
+
+template <typename K, typename V, typename Stats>
+swiss_aos<K, V, Stats>::~swiss_aos()
+{
+	delete[] table;
+	free(ctrl);
+}
+
+// whole groups, control bytes aligned for the group loads
+template <typename K, typename V, typename Stats>
+void
+swiss_aos<K, V, Stats>::allocate(uint32_t b)
+{
+	groups = (b + group_size - 1) / group_size;
+	buckets = groups * group_size;
+
+	table = new record_t[buckets];
+	ctrl = (uint8_t *)aligned_alloc(group_size, buckets);
+	if (!table || !ctrl) {
+		cerr << "Couldn't allocate\n";
+		exit(1);
+	}
+	memset(ctrl, EMPTY, buckets);
+}
+
+// multiplicative hash; the group comes from the top half, the tag from
+// bits 25-31, which depend on all of a 32 bit key
+template <typename K, typename V, typename Stats>
+uint64_t
+swiss_aos<K, V, Stats>::hash(K k) const
+{
+	uint64_t x = fold(k);
+	if constexpr (sizeof(K) > 4) x ^= x >> 32;
+	uint64_t h = x * 0x9e3779b97f4a7c15ull;
+	return (h & ~0x7full) | ((h >> 25) & 0x7f);
+}
+
+#if defined(__SSE2__)
+template <typename K, typename V, typename Stats>
+uint32_t
+swiss_aos<K, V, Stats>::match(uint32_t g, uint8_t t) const
+{
+	__m128i c = _mm_load_si128((const __m128i *)(ctrl + g*group_size));
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(t)));
+}
+
+template <typename K, typename V, typename Stats>
+uint32_t
+swiss_aos<K, V, Stats>::match_empty(uint32_t g) const
+{
+	return match(g, EMPTY);
+}
+
+// the high bit is set in EMPTY and DELETED only
+template <typename K, typename V, typename Stats>
+uint32_t
+swiss_aos<K, V, Stats>::match_free(uint32_t g) const
+{
+	__m128i c = _mm_load_si128((const __m128i *)(ctrl + g*group_size));
+	return _mm_movemask_epi8(c);
+}
+#else
+template <typename K, typename V, typename Stats>
+uint32_t
+swiss_aos<K, V, Stats>::match(uint32_t g, uint8_t t) const
+{
+	uint32_t m = 0;
+	for (int i = 0; i < group_size; ++i)
+		if (ctrl[g*group_size + i] == t) m |= 1u << i;
+	return m;
+}
+
+template <typename K, typename V, typename Stats>
+uint32_t
+swiss_aos<K, V, Stats>::match_empty(uint32_t g) const
+{
+	return match(g, EMPTY);
+}
+
+template <typename K, typename V, typename Stats>
+uint32_t
+swiss_aos<K, V, Stats>::match_free(uint32_t g) const
+{
+	uint32_t m = 0;
+	for (int i = 0; i < group_size; ++i)
+		if (ctrl[g*group_size + i] & 0x80) m |= 1u << i;
+	return m;
+}
+#endif
+
+template <typename K, typename V, typename Stats>
+void
+swiss_aos<K, V, Stats>::resize(uint32_t b)
+{
+	uint32_t oldbuckets = buckets;
+	record_t *oldtable = table;
+	uint8_t *oldctrl = ctrl;
+
+	allocate(b);
+	records = 0;
+	tombs = 0;
+
+	for(uint32_t i=0; i<oldbuckets; ++i)
+		if (!(oldctrl[i] & 0x80))
+			insert(oldtable[i].key, oldtable[i].value, true);
+
+	delete[] oldtable;
+	free(oldctrl);
+	this->count_resize();
+}
+
+// look for k group by group from its home group.  if found, *slot is its
+// slot; if not, the first free slot on the way (for insert)
+template <typename K, typename V, typename Stats>
+bool
+swiss_aos<K, V, Stats>::probe(K k, uint64_t h, uint32_t *slot,
+                              optype operation)
+{
+	const uint8_t t = tag(h);
+	uint32_t g = home(h);
+	uint64_t miss = 0;
+	bool res = false, have_free = false;
+
+	for (uint32_t n = 0; n < groups; ++n) {
+		for (uint32_t m = match(g, t); m; m &= m - 1) {
+			uint32_t s = g*group_size + __builtin_ctz(m);
+			if (key(s) == k) {
+				*slot = s;
+				res = true;
+				goto done;
+			}
+			++miss;
+		}
+		if (!have_free && (operation == INSERT ||
+		                   operation == REBUILD_INS)) {
+			uint32_t f = match_free(g);
+			if (f) {
+				*slot = g*group_size + __builtin_ctz(f);
+				have_free = true;
+			}
+		}
+		if (match_empty(g)) break;
+		if (++g == groups) g = 0;
+		++miss;
+	}
+done:
+	this->record_probe(miss, operation);
+	return res;
+}
+
+template <typename K, typename V, typename Stats>
+swiss_aos<K, V, Stats>::result
+swiss_aos<K, V, Stats>::insert(K k, V v, bool rebuilding)
+{
+	uint32_t slot;
+	uint64_t h = hash(k);
+	optype ins_type = rebuilding ? REBUILD_INS : INSERT;
+
+	if (records>=buckets) {
+		this->count_fail(INSERT);
+		return FULLTABLE;
+	}
+
+	if (probe(k, h, &slot, ins_type)) {
+		this->count_fail(INSERT);
+		this->count_duplicate();
+		return DUPLICATE;
+	}
+
+	if (tomb(slot)) --tombs;
+	table[slot] = record_t{ k, v };
+	ctrl[slot] = tag(h);
+	++records;
+
+	this->count_shifts(0, ins_type);
+	this->count_op(ins_type);
+
+	// automatic resizing
+	if (load_factor() > max_load_factor) {
+		cerr << "load factor " << max_load_factor << " exceeded\n";
+		resize(primes[++prime_index]);
+	}
+
+	if (!rebuilding) {
+		--rebuild_window;
+		if (rebuild_window <= 0) return REBUILD;
+	}
+
+	return SUCCESS;
+}
+
+template <typename K, typename V, typename Stats>
+bool
+swiss_aos<K, V, Stats>::query(K k, V *v)
+{
+	uint32_t slot;
+	this->count_op(QUERY);
+
+	if (probe(k, hash(k), &slot, QUERY)) {
+		*v = value(slot);
+		return true;
+	} else {
+		this->count_fail(QUERY);
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Stats>
+swiss_aos<K, V, Stats>::result
+swiss_aos<K, V, Stats>::remove(K k)
+{
+	uint32_t slot;
+	this->count_op(REMOVE);
+
+	if (!probe(k, hash(k), &slot, REMOVE)) {
+		this->count_fail(REMOVE);
+		return result::FAILURE;
+	}
+
+	// a group that still has an empty slot never sent a search on
+	if (match_empty(slot / group_size)) {
+		ctrl[slot] = EMPTY;
+	} else {
+		ctrl[slot] = DELETED;
+		++tombs;
+	}
+	--records;
+	return result::SUCCESS;
+}
+
+template <typename K, typename V, typename Stats>
+void
+swiss_aos<K, V, Stats>::reset_rebuild_window()
+{
+	rebuild_window = buckets/2 * (1.0 - load_factor()) + 1;
+}
+
+template <typename K, typename V, typename Stats>
+void
+swiss_aos<K, V, Stats>::rebuild()
+{
+	resize(buckets);
+	reset_rebuild_window();
+	this->count_rebuild();
+}
+
+// runs of groups without an empty slot, which searches walk through
+template <typename K, typename V, typename Stats>
+void
+swiss_aos<K, V, Stats>::cluster_len(std::map<int,int> *clust) const
+{
+	int run = 0;
+	for (uint32_t g = 0; g < groups; ++g) {
+		if (!match_empty(g)) {
+			++run;
+		} else if (run) {
+			(*clust)[run]++;
+			run = 0;
+		}
+	}
+	if (run) (*clust)[run]++;
+}
+
+template <typename K, typename V, typename Stats>
+void
+swiss_aos<K, V, Stats>::search_distance(std::map<int,int> *disp) const
+{
+	for (uint32_t p = 0; p < buckets; ++p)
+		if (full(p)) {
+			uint32_t h = home(hash(key(p)));
+			uint32_t g = p / group_size;
+			(*disp)[g >= h ? g - h : groups - h + g]++;
+		}
+}
+
+template <typename K, typename V, typename Stats>
+void
+swiss_aos<K, V, Stats>::dump()
+{
+	for(size_t i=0; i<buckets; i++) {
+		if ((i!=0) && (i%group_size == 0)) std::cout << "\n";
+		if (full(i))
+			std::cout << key(i) << ' ';
+		else
+			std::cout << (empty(i) ? "_ " : "x ");
+	}
+	std::cout << "\n";
+}
@@ -0,0 +1,84 @@
+#ifndef WIDE_H
+#define WIDE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+// wide keys and values, for record shapes past 32 bits (widthstats).
+//
+// the testers draw 32-bit keys and convert them, so the wide types are
+// built from a uint64_t.  a key64 or key128 spreads its key over every
+// bit it has (odd multipliers, so distinct keys stay distinct), as a
+// real 8 or 16 byte key would, and equality and order compare all of
+// it.  a blob<N> is N bytes, all of them written.
+
+struct key64 {
+	uint64_t v;
+
+	key64() = default;
+	key64(uint64_t x) : v(x * 0xbf58476d1ce4e5b9ull) {}
+
+	bool operator==(const key64 &o) const { return v == o.v; }
+	bool operator!=(const key64 &o) const { return v != o.v; }
+	bool operator<(const key64 &o) const { return v < o.v; }
+};
+
+inline std::ostream& operator<<(std::ostream &o, const key64 &k)
+{
+	return o << k.v;
+}
+
+struct key128 {
+	uint64_t lo, hi;
+
+	key128() = default;
+	key128(uint64_t x) : lo(x * 0xbf58476d1ce4e5b9ull),
+	                     hi(x * 0x9e3779b97f4a7c15ull) {}
+
+	bool operator==(const key128 &o) const {
+		return lo == o.lo && hi == o.hi;
+	}
+	bool operator!=(const key128 &o) const { return !(*this == o); }
+	bool operator<(const key128 &o) const {
+		return lo < o.lo || (lo == o.lo && hi < o.hi);
+	}
+};
+
+inline std::ostream& operator<<(std::ostream &o, const key128 &k)
+{
+	return o << k.lo;
+}
+
+template <std::size_t N>
+struct blob {
+	static_assert(N % sizeof(uint64_t) == 0, "blobs are whole words");
+	uint64_t w[N / sizeof(uint64_t)];
+
+	blob() = default;
+	blob(uint64_t x) {
+		for (auto &y : w) y = x;
+	}
+};
+
+// the tables' hashes read every bit of a key through these.
+//
+// fold(k) is k in 64 bits: an integer key as it is, a wide one with its
+// words xored.  fastrange(k, b) is k's home slot out of b, fold(k)'s two
+// halves xored and scaled by b.  a key below 2^32 is scaled as it is,
+// so integer keys keep the monotone fastrange the tables were written
+// for, whatever their type's width, and keys past 2^32 land in range.
+
+template <typename K>
+inline uint64_t fold(K k) { return (uint64_t)k; }
+inline uint64_t fold(const key64 &k) { return k.v; }
+inline uint64_t fold(const key128 &k) { return k.lo ^ k.hi; }
+
+template <typename K>
+inline uint32_t fastrange(const K &k, uint32_t b)
+{
+	uint64_t x = fold(k);
+	return (uint32_t)(((uint32_t)(x ^ (x >> 32)) * (uint64_t)b) >> 32);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include <iostream>
+#include <fstream>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+
+#include "testers/latencytester.hpp"
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+
+pcg_extras::seed_seq_from<std::random_device> seed_source;
+pcg64 rng(seed_source);
+
+int main(int argc, char **argv)
+{
+	const std::vector<int> xs{2,3,4,5,6,7,8,9,10,15,20,25,
+	                          30,40,50,60,70,80,90,100};
+	const uint64_t b = 1'000'000;
+	const int nops = 1'000'000;      // ops per test
+	const int nt = 5;                // number of tests per x
+
+	{ std::ofstream f("latency_graveyard_aos");
+	  f << latencytester<graveyard_aos<>>(rng, xs, b, nops, nt); }
+
+	{ std::ofstream f("latency_graveyard_soa");
+	  f << latencytester<graveyard_soa<>>(rng, xs, b, nops, nt); }
+
+	{ std::ofstream f("latency_ordered_aos");
+	  f << latencytester<ordered_aos<>>(rng, xs, b, nops, nt); }
+
+	{ std::ofstream f("latency_ordered_soa");
+	  f << latencytester<ordered_soa<>>(rng, xs, b, nops, nt); }
+
+	{ std::ofstream f("latency_linear_aos");
+	  f << latencytester<linear_aos<>>(rng, xs, b, nops, nt); }
+
+	{ std::ofstream f("latency_linear_soa");
+	  f << latencytester<linear_soa<>>(rng, xs, b, nops, nt); }
+
+	return 0;
+}
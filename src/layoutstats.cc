@@ -0,0 +1,106 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+#include "measure.h"
+
+#include "testers/filltable.hpp"
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+
+// layoutstats [n [trials [cold]]]
+//
+// AoS against SoA for each table family, with the measurement controls
+// of measure.h: both layouts get the same keys inserted in the same
+// order and are queried in the same order, with their trials interleaved
+// in random order round by round, after a warmup, pinned to one cpu.
+// the ratio's confidence interval says whether the difference is real;
+// "-" when it contains 1.  written to layout_compare.
+
+pcg64 rng(42u);
+
+template <typename aos, typename soa>
+void compare(std::ostream &o, const measure &m, uint64_t b,
+             const std::vector<int> &xs, int nq, int nt)
+{
+	for (auto x : xs) {
+		aos a(next_prime(b));
+		soa s(next_prime(b));
+		a.set_max_load_factor(1.0);
+		s.set_max_load_factor(1.0);
+
+		std::vector<uint32_t> keys, ka, ks;
+		std::uniform_int_distribution<uint32_t> data(0, UINT32_MAX);
+		double lf = 1.0 - 1.0 / x;
+		fill_table(&a, lf, [&] {
+			keys.push_back(data(rng));
+			return keys.back();
+		}, &ka, rebuild_on_load<aos>);
+		std::size_t i = 0;
+		fill_table(&s, lf, [&] {
+			return i < keys.size() ? keys[i++] : data(rng);
+		}, &ks, rebuild_on_load<soa>);
+		a.rebuild();
+		s.rebuild();
+
+		int shuffled = -1;
+		auto trial = [&](int v, int t) {
+			if (t != shuffled) {
+				std::shuffle(ka.begin(), ka.end(), rng);
+				shuffled = t;
+			}
+			auto run = [&](auto &ht) {
+				typename std::remove_reference_t<decltype(ht)>
+				        ::value_type val;
+				return m.time([&] {
+					std::size_t j = 0;
+					for (int q = 0; q < nq; ++q) {
+						ht.query(ka[j], &val);
+						if (++j == ka.size()) j = 0;
+					}
+				});
+			};
+			return v == 0 ? run(a) : run(s);
+		};
+		auto d = m.interleave(2, nt, rng, trial);
+
+		interval r = m.ratio_ci(d[0], d[1]);
+		o << a.table_type() << ", " << s.table_type() << ", " << x
+		  << ", " << a.load_factor() << ", "
+		  << mean(d[0]) << ", " << m.mean_ci(d[0]) << ", "
+		  << mean(d[1]) << ", " << m.mean_ci(d[1]) << ", "
+		  << mean(d[1]) / mean(d[0]) << ", " << r << ", "
+		  << (r.hi < 1 ? "soa" : r.lo > 1 ? "aos" : "-") << ", "
+		  << measure::outliers(d[0]) + measure::outliers(d[1]) << "\n"
+		  << std::flush;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t b = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+	int nt = argc > 2 ? std::stoi(argv[2]) : 30;
+	const int nq = 1'000'000;
+	const std::vector<int> xs { 2, 5, 10, 20, 50, 100 };
+
+	measure::options mo;
+	mo.cpu = 0;
+	mo.cold = argc > 3 && !strcmp(argv[3], "cold");
+	measure m(mo);
+	m.setup();
+
+	std::ofstream f("layout_compare");
+	f << "AoS, SoA, x, Loadfactor, AoS mean, AoS CI, SoA mean, SoA CI, "
+	     "SoA/AoS, Ratio CI, Faster, Outliers\n";
+	compare<graveyard_aos<>, graveyard_soa<>>(f, m, b, xs, nq, nt);
+	compare<ordered_aos<>, ordered_soa<>>(f, m, b, xs, nq, nt);
+	compare<linear_aos<>, linear_soa<>>(f, m, b, xs, nq, nt);
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <fstream>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+
+#include "testers/openlooptester.hpp"
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+
+pcg_extras::seed_seq_from<std::random_device> seed_source;
+pcg64 rng(seed_source);
+
+int main(int argc, char **argv)
+{
+	const std::vector<double> rates{ 100'000, 250'000, 500'000,
+	                                 1'000'000, 2'000'000, 4'000'000,
+	                                 8'000'000 };
+	const std::vector<int> xs{ 2, 5, 10, 20, 50 };
+	const uint64_t b = 1'000'000;
+	const int nops = 2'000'000;     // ops per offered rate
+	const double slo = 50'000;      // p99 response time target, ns
+
+	std::ofstream f("openloop_sustainable");
+	f << "type, x, sustainable ops/sec\n";
+
+	for (auto x : xs) {
+		std::ofstream d("openloop_x" + std::to_string(x));
+		double r;
+
+		{ openlooptester<graveyard_aos<>> t(rng, x, b, rates, nops, slo);
+		  d << t; r = t.sustainable_rate(); }
+		f << "graveyard_aos, " << x << ", " << r << std::endl;
+
+		{ openlooptester<graveyard_soa<>> t(rng, x, b, rates, nops, slo);
+		  d << t; r = t.sustainable_rate(); }
+		f << "graveyard_soa, " << x << ", " << r << std::endl;
+
+		{ openlooptester<ordered_aos<>> t(rng, x, b, rates, nops, slo);
+		  d << t; r = t.sustainable_rate(); }
+		f << "ordered_aos, " << x << ", " << r << std::endl;
+
+		{ openlooptester<ordered_soa<>> t(rng, x, b, rates, nops, slo);
+		  d << t; r = t.sustainable_rate(); }
+		f << "ordered_soa, " << x << ", " << r << std::endl;
+
+		{ openlooptester<linear_aos<>> t(rng, x, b, rates, nops, slo);
+		  d << t; r = t.sustainable_rate(); }
+		f << "linear_aos, " << x << ", " << r << std::endl;
+
+		{ openlooptester<linear_soa<>> t(rng, x, b, rates, nops, slo);
+		  d << t; r = t.sustainable_rate(); }
+		f << "linear_soa, " << x << ", " << r << std::endl;
+	}
+
+	return 0;
+}
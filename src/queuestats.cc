@@ -11,6 +11,7 @@
 #include "pcg_random.hpp"
 #include "primes.h"
 #include "graveyard.h"
+#include "testers/filltable.hpp"
 
 #define NTESTS 10
 
@@ -38,34 +39,9 @@ struct queue_stats_t {
 // maintain list of all keys inserted until target load factor reached
 void loadtable(hashtable *ht, std::vector<uint32_t> *keys, double lf)
 {
-	double start = ht->load_factor();
-	int interval = (lf - ht->load_factor()) * ht->table_size() / 20;
-	int stat_timer = interval;
-	uint64_t k;
-
 	uniform_int_distribution<uint64_t> data(0,UINT32_MAX);
-	cout << "Loading: " << ht->load_factor() << " -> " << lf << "\n";
-
-	while(ht->load_factor() < lf) {
-		k = data(rng);
-		using result = hashtable::result;
-		result r = ht->insert(k, k/2);
-		if (r == result::SUCCESS) {
-			keys->push_back(k);
-		} else if (r == result::REBUILD) {
-			keys->push_back(k);
-			ht->rebuild();
-		}
-
-		if (--stat_timer == 0) {
-			stat_timer = interval;
-			cout << "\r["
-			     << 100.0*(ht->load_factor() - start)/(lf - start)
-			     << "%]   " << std::flush;
-		}
-	}
-
-	cout << "\r[done]     ";
+	fill_table(ht, lf, [&] { return data(rng); }, keys,
+	           rebuild_on_load<hashtable>);
 }
 
 void floating(hashtable *ht, std::vector<uint32_t> *keys)
@@ -0,0 +1,47 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+
+#include "testers/replaytester.hpp"
+#include "testers/ycsbtester.hpp"
+#include "trace.h"
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+
+pcg_extras::seed_seq_from<std::random_device> seed_source;
+pcg64 rng(seed_source);
+
+// replaystats [trace [trials]]
+// replay a trace against every table type, first letting each table
+// rebuild when it asks to, then following the recorded rebuilds.  with no
+// trace, record YCSB workload A on graveyard_aos and replay that.
+int main(int argc, char **argv)
+{
+	std::string path = argc > 1 ? argv[1] : "";
+	int trials = argc > 2 ? std::stoi(argv[2]) : 5;
+
+	if (path.empty()) {
+		const uint64_t b = 1'000'000;
+		path = "graveyard_aos.trace";
+		std::cout << "recording " << path << "\n";
+		ycsbtester<recording<graveyard_aos<>>>(rng, ycsb_preset('A'),
+		                                        b, b * 0.9, b, 1);
+	}
+
+	std::ofstream f("replay");
+	for (auto m : { replay_rebuilds::OWN, replay_rebuilds::RECORDED }) {
+		f << replaytester<graveyard_aos<>>(path, trials, m);
+		f << replaytester<graveyard_soa<>>(path, trials, m);
+		f << replaytester<ordered_aos<>>(path, trials, m);
+		f << replaytester<ordered_soa<>>(path, trials, m);
+		f << replaytester<linear_aos<>>(path, trials, m);
+		f << replaytester<linear_soa<>>(path, trials, m);
+	}
+
+	return 0;
+}
@@ -0,0 +1,39 @@
+#include <iostream>
+#include <fstream>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+
+#include "testers/floattester.hpp"
+#include "graveyard.h"
+#include "ordered.h"
+
+pcg_extras::seed_seq_from<std::random_device> seed_source;
+pcg64 rng(seed_source);
+
+// overhead of a background snapshot on the floating-ops workload:
+// each table runs once without snapshots and once with a snapshot taken
+// at the start of every trial
+
+int main(int argc, char **argv)
+{
+	const vector<int> xs{2,5,10,20,50,100};
+	const vector<uint64_t> bs{10'000'000};
+	const int nops = 1'000'000;     // ops per test
+	const int nt = 10;              // number of tests to average over
+
+	{ std::ofstream f("snapbench_graveyard_aos");
+	  f << floattester<graveyard_aos<>>(rng, xs, bs, nops, nt);
+	  f << floattester<graveyard_aos<>>(rng, xs, bs, nops, nt,
+	                                    "snapshot_graveyard_aos"); }
+
+	{ std::ofstream f("snapbench_ordered_aos");
+	  f << floattester<ordered_aos<>>(rng, xs, bs, nops, nt);
+	  f << floattester<ordered_aos<>>(rng, xs, bs, nops, nt,
+	                                  "snapshot_ordered_aos"); }
+
+	cout << "Complete\n";
+
+	return 0;
+}
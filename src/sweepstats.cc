@@ -0,0 +1,113 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+#include "sweep.h"
+
+#include "testers/querytester.hpp"
+#include "testers/loadtester.hpp"
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+
+// sweepstats query|load [threads [bw_jobs [mem_budget_gb]]]
+//
+// the xtester and loadstats matrices with every (table type, n, x)
+// configuration as a separate job, spread over the cores by sweep.
+// results are merged in configuration order into query_sweep or
+// load_sweep.  threads defaults to one per cpu, bw_jobs to 1 and the
+// budget to 3/4 of physical memory (sweep.h); 0 lifts either limit.
+
+// slots plus the testers' key vector
+template <typename hashtable>
+std::size_t footprint(uint64_t b)
+{
+	return b * (sizeof(typename hashtable::key_type)
+	            + sizeof(typename hashtable::value_type) + 1
+	            + sizeof(uint32_t));
+}
+
+template <typename hashtable>
+void add_query_jobs(sweep *s, const std::vector<uint64_t> &bs,
+                    const std::vector<int> &xs, int nq, int nt)
+{
+	const std::string type = hashtable(5).table_type();
+	for (auto b : bs)
+		for (auto x : xs)
+			s->add(type + " n=" + std::to_string(b) + " x="
+			       + std::to_string(x), footprint<hashtable>(b),
+			       [=](pcg64 &rng, std::ostream &o) {
+				o << querytester<hashtable>(rng, { x }, { b },
+				                            nq, nt, 0);
+			});
+}
+
+template <typename hashtable>
+void add_load_jobs(sweep *s, const std::vector<uint64_t> &ns, int x,
+                   int points)
+{
+	const std::string type = hashtable(5).table_type();
+	for (bool rb : { true, false })
+		for (auto n : ns)
+			s->add(type + " n=" + std::to_string(n)
+			       + (rb ? "" : " norebuild"), footprint<hashtable>(n),
+			       [=](pcg64 &rng, std::ostream &o) {
+				o << loadtester<hashtable>(rng, n, x, points, rb);
+			});
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || (strcmp(argv[1], "query") && strcmp(argv[1], "load"))) {
+		std::cerr << "usage: " << argv[0] << " query|load [threads "
+		             "[bw_jobs [mem_budget_gb]]]\n";
+		return 1;
+	}
+
+	sweep::options opt;
+	opt.seed = 42;
+	if (argc > 2) opt.threads = std::stoi(argv[2]);
+	if (argc > 3) opt.bw_jobs = std::stoi(argv[3]);
+	if (argc > 4) opt.mem_budget = std::stod(argv[4]) * (1ull << 30);
+	sweep s(opt);
+
+	if (!strcmp(argv[1], "query")) {
+		const std::vector<uint64_t> bs { 1'000'000 };
+		std::vector<int> xs;
+		for (int x = 2; x <= 400; ++x)
+			xs.push_back(x);
+		const int nq = 1'000'000, nt = 10;
+
+		add_query_jobs<graveyard_aos<>>(&s, bs, xs, nq, nt);
+		add_query_jobs<graveyard_soa<>>(&s, bs, xs, nq, nt);
+		add_query_jobs<ordered_aos<>>(&s, bs, xs, nq, nt);
+		add_query_jobs<ordered_soa<>>(&s, bs, xs, nq, nt);
+		add_query_jobs<linear_aos<>>(&s, bs, xs, nq, nt);
+		add_query_jobs<linear_soa<>>(&s, bs, xs, nq, nt);
+
+		std::ofstream f("query_sweep");
+		s.run(f);
+	} else {
+		const std::vector<uint64_t> ns {
+			10'000'000, 25'000'000, 50'000'000, 100'000'000,
+			250'000'000, 500'000'000, 750'000'000, 1'000'000'000,
+		};
+		const int x = 1000, points = 250;
+
+		add_load_jobs<graveyard_aos<>>(&s, ns, x, points);
+		add_load_jobs<ordered_aos<>>(&s, ns, x, points);
+		add_load_jobs<linear_aos<>>(&s, ns, x, points);
+		add_load_jobs<graveyard_soa<>>(&s, ns, x, points);
+		add_load_jobs<ordered_soa<>>(&s, ns, x, points);
+		add_load_jobs<linear_soa<>>(&s, ns, x, points);
+
+		std::ofstream f("load_sweep");
+		s.run(f);
+	}
+
+	return 0;
+}
@@ -3,10 +3,13 @@
 #include <vector>
 #include <random>
 #include <cassert>
+#include <cstdlib>
+#include <unordered_map>
 
 #include "graveyard.h"
 #include "ordered.h"
 #include "linear.h"
+#include "testers/dispatch.hpp"
 
 #define SIZE 400
 #define INFINITE	/* test in an infinite loop, breaking only on error */
@@ -37,8 +40,195 @@ display(hashtable &h, const char *message)
 	std::cout << "\n\n";
 }
 
+// random inserts, removes and queries against std::unordered_map, with
+// a rebuild whenever the table asks for one.  every answer, the values
+// and the ordering have to agree with it.  b buckets, resizing past load
+template <typename hashtable>
+bool
+crosscheck(uint64_t seed, uint32_t b, double load, int ops)
+{
+	using K = typename hashtable::key_type;
+	using V = typename hashtable::value_type;
+	using res = typename hashtable::result;
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<uint32_t> anykey;
+	std::uniform_int_distribution<int> pct(0, 99);
+
+	hashtable t(b);
+	std::unordered_map<K, V> ref;
+	std::vector<K> keys;    // ref's keys, to pick hits from
+	t.set_max_load_factor(load);
+
+	auto fail = [&](const char *what, K k) {
+		std::cout << t.table_type() << " seed " << seed << " b " << b
+		          << " load " << load << ": " << what << " " << k
+		          << "\n";
+		return false;
+	};
+	auto pick = [&]() {
+		std::uniform_int_distribution<std::size_t> p(0, keys.size()-1);
+		return p(rng);
+	};
+
+	for (int i = 0; i < ops; ++i) {
+		int op = pct(rng);
+		bool hit = !keys.empty() && pct(rng) < 75;
+		std::size_t p = hit ? pick() : 0;
+		K k = hit ? keys[p] : (K)anykey(rng);
+		bool in = ref.count(k);
+		V v;
+
+		if (op < 40) {
+			// the tables only look for duplicates as far as a
+			// new key's place, so, like the testers, insert new keys
+			do k = anykey(rng); while (ref.count(k));
+			res r = t.insert(k, (V)(k * 7 + 1));
+			if (r != res::SUCCESS && r != res::REBUILD)
+				return fail("failed insert of", k);
+			ref[k] = (V)(k * 7 + 1);
+			keys.push_back(k);
+			if (r == res::REBUILD) t.rebuild();
+		} else if (op < 70) {
+			res r = t.remove(k);
+			if (r == res::FAILURE) {
+				if (in) return fail("failed remove of", k);
+				continue;
+			}
+			if (!in) return fail("removed absent", k);
+			ref.erase(k);
+			if (!hit)
+				for (p = 0; keys[p] != k; ++p) ;
+			std::swap(keys[p], keys.back());
+			keys.pop_back();
+			if (r == res::REBUILD) t.rebuild();
+		} else {
+			bool found = t.query(k, &v);
+			if (found != in)
+				return fail(in ? "lost" : "found absent", k);
+			if (found && !(v == ref[k]))
+				return fail("wrong value for", k);
+		}
+	}
+
+	if (t.num_records() != ref.size())
+		return fail("record count off, last key", (K)0);
+	if (!t.check_ordering())
+		return fail("ordering violated, last key", (K)0);
+	for (auto &kv : ref) {
+		V v;
+		if (!t.query(kv.first, &v) || !(v == kv.second))
+			return fail("lost at the end", kv.first);
+	}
+	return true;
+}
+
+// the same random operations on two copies of a table, one galloping
+// after 2 slots of a probe and one never galloping: every answer, every
+// value and the final contents have to match.  high loads, for clusters
+// long enough to gallop through
+template <typename hashtable>
+bool
+gallop_agrees(uint64_t seed, uint32_t b, double load, int ops)
+{
+	using K = typename hashtable::key_type;
+	using V = typename hashtable::value_type;
+	using res = typename hashtable::result;
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<uint32_t> anykey;
+	std::uniform_int_distribution<int> pct(0, 99);
+
+	hashtable g(b), w(b);
+	std::vector<K> keys;
+	g.set_max_load_factor(load);
+	w.set_max_load_factor(load);
+	g.set_gallop_after(2);
+	w.set_gallop_after(0);
+
+	auto fail = [&](const char *what, K k) {
+		std::cout << g.table_type() << " seed " << seed << " b " << b
+		          << " load " << load << ": gallop " << what << " "
+		          << k << "\n";
+		return false;
+	};
+
+	for (int i = 0; i < ops; ++i) {
+		int op = pct(rng);
+		K k = !keys.empty() && pct(rng) < 75 ?
+		      keys[rng() % keys.size()] : (K)anykey(rng);
+
+		if (op < 45) {
+			res r = g.insert(k, (V)(k * 7 + 1));
+			if (r != w.insert(k, (V)(k * 7 + 1)))
+				return fail("changed insert of", k);
+			if (r == res::SUCCESS || r == res::REBUILD)
+				keys.push_back(k);
+			if (r == res::REBUILD) {
+				g.rebuild();
+				w.rebuild();
+			}
+		} else if (op < 65) {
+			res r = g.remove(k);
+			if (r != w.remove(k))
+				return fail("changed remove of", k);
+			if (r == res::REBUILD) {
+				g.rebuild();
+				w.rebuild();
+			}
+		} else {
+			V x, y;
+			bool found = g.query(k, &x);
+			if (found != w.query(k, &y))
+				return fail("changed query of", k);
+			if (found && !(x == y))
+				return fail("changed value of", k);
+		}
+	}
+
+	if (g.num_records() != w.num_records())
+		return fail("changed record count, last key", (K)0);
+	for (K k : keys) {
+		V x, y;
+		bool found = g.query(k, &x);
+		if (found != w.query(k, &y) || (found && !(x == y)))
+			return fail("differs at the end on", k);
+	}
+	return true;
+}
+
+// every table type, a few seeds and loads
+bool
+crosscheck_all()
+{
+	bool ok = true;
+	std::vector<std::string> names = table_names;
+	names.insert(names.end(), baseline_names.begin(),
+	             baseline_names.end());
+
+	for (auto &name : names) {
+		bool pass = true;
+		with_table(name, 32, 32, "full", [&]<typename hashtable>() {
+			for (double load : { 0.5, 0.9 })
+				for (uint64_t seed = 1; seed <= 5; ++seed)
+					pass &= crosscheck<hashtable>(seed, 1009,
+					                              load, 100000);
+			if constexpr (requires(hashtable &t) {
+				t.set_gallop_after(0);
+			})
+				for (double load : { 0.9, 0.98 })
+					for (uint64_t seed = 1; seed <= 5; ++seed)
+						pass &= gallop_agrees<hashtable>(
+						    seed, 1009, load, 100000);
+		});
+		std::cout << name << (pass ? ": ok\n" : ": FAILED\n");
+		ok &= pass;
+	}
+	return ok;
+}
+
+// tabletest [runs]: the cross checks, then runs of graveyard_aos's dump
+// test, forever if runs is 0 or left out
 int
-main()
+main(int argc, char **argv)
 {
 	using std::uniform_int_distribution, std::mt19937;
 	std::random_device dev;
@@ -46,9 +236,12 @@ main()
 	const std::size_t max = std::numeric_limits<uint32_t>::max();
 	uniform_int_distribution<mt19937::result_type> testset(0,max);
 	int run = 0;
+	int runs = argc > 1 ? atoi(argv[1]) : 0;
+
+	if (!crosscheck_all()) return 1;
 
 #ifdef INFINITE
-	while (1) {
+	while (!runs || run < runs) {
 #endif
 		hashtable t(SIZE);
 		std::vector<uint32_t> keys(SIZE,0);
@@ -16,6 +16,10 @@
 #include "primes.h"
 #include "graveyard.h"
 #include "util.h"
+#include "workload.h"
+#include "filltable.hpp"
+#include "perfcounters.h"
+#include "results.h"
 
 using std::chrono::duration;
 using std::chrono::steady_clock;
@@ -31,6 +35,8 @@ class amorttester {
 	double x;
 	int nops, ntests;
 	uint64_t b;
+	perfcounters hw;
+	workload wl;
 
 	struct amort_stats_t {
 		uint64_t b;     // desired # of slots
@@ -48,8 +54,10 @@ class amorttester {
 		unsigned int rb;        // number of rebuilds
 		double alpha;           // actual load factor after test
 		std::size_t n;          // actual size (smallest prime >= b)
+		hw_counts hw;           // floating ops incl. rebuilds, all tests
 	};
 	std::vector<amort_stats_t> stats;
+	std::vector<result_record> rows;
 
 	inline void
 	loadrebuild(hashtable *ht)
@@ -63,13 +71,9 @@ class amorttester {
 	gen_testset(std::vector<uint32_t>* loadset, uint32_t n)
 	{
 		n += nops * ntests;
-		cout << "Reserve testset, size " << n << "..." << std::flush; 
-		loadset->reserve(n);
-		cout << "done. Generate testset..." << std::flush; 
-		selsample(loadset,n,std::numeric_limits<uint32_t>::max(),rng);
-
-		cout << "done. Shuffling..." << std::flush;
-		std::shuffle(std::begin(*loadset), std::end(*loadset), rng);
+		cout << "Generate testset..." << std::flush;
+		loadset->resize(n);
+		keyset(wl, rng).fill(loadset->data(), 0, n);
 		cout << "done, size = " << loadset->size() << "\n";
 	}
 
@@ -79,52 +83,51 @@ class amorttester {
 	loadtable(hashtable *ht, std::vector<uint32_t> *loadset,
 	          std::vector<uint32_t> *inserted, double lf)
 	{
-		using result = hashtable::result;
-		int loadops = ht->table_size() * lf;
-		int interval = loadops / 20;
-		int stat_timer = interval;
-		uint64_t k;
-		int start = 0;
-
-		cout << "Load: " << start << " -> " << lf << "\n";
-
-		for (int i = 0; i < loadops; ++i) {
-			k = loadset->back();
+		auto next = [loadset] {
+			uint32_t k = loadset->back();
 			loadset->pop_back();
-			result r = ht->insert(k, k);
-			switch(r) {
-			case result::SUCCESS:
-				inserted->push_back(k);
-				break;
-			case result::REBUILD:
-				inserted->push_back(k);
-				loadrebuild(ht);
-				break;
-			case result::FULLTABLE: // this should never happen
-				std::cerr << "Table full!\n";
-				return;
-			case result::DUPLICATE: // this also shouldn't happen
-				std::cerr << "Duplicate found\n";
-			default:
-				break;
-			}
+			return k;
+		};
+		fill_table(ht, lf, next, inserted,
+		           [this](hashtable *h) { loadrebuild(h); });
+	}
 
-			if (--stat_timer == 0) {
-				stat_timer = interval;
-				cout << "\r["
-				     << 100 * (ht->load_factor() - start)
-				        / (lf - start)
-				     << "%]   " << std::flush;
+	// the keys a trial's removes take, picked before it runs.  every
+	// key keeps its place in *inserted, the insertion order, for the
+	// whole run, a removed one just marked gone, so a picker rank stays
+	// on one key (LATEST's on the newest) while the others come and go.
+	// draws that land on a key not in yet, or gone, are drawn again
+	std::vector<uint32_t>
+	pick_removes(picker &access, std::size_t total,
+	             const std::vector<uint32_t> &testset,
+	             std::vector<uint32_t> *inserted, std::vector<bool> *gone,
+	             const std::vector<uint8_t> &opset)
+	{
+		std::vector<uint32_t> removes;
+		std::size_t next = testset.size();
+
+		removes.reserve(opset.size()/2+1);
+		for (uint8_t op : opset) {
+			if (op == 0) {
+				assert(next > 0);
+				inserted->push_back(testset[--next]);
+				gone->push_back(false);
+				continue;
 			}
+			std::size_t n = wl.access == accessdist::LATEST ?
+			                inserted->size() : total;
+			std::size_t p;
+			do p = access(rng, n);
+			while (p >= inserted->size() || (*gone)[p]);
+			(*gone)[p] = true;
+			removes.push_back((*inserted)[p]);
 		}
-
-		cout << "\r[done]     , inserted=" << inserted->size() << "\n";
+		return removes;
 	}
 
 	void floating(hashtable *ht,
 	              std::vector<uint32_t> *testset,
-	              std::vector<uint32_t> *inserted,
-		      std::vector<uint32_t> *delorder,
+	              const std::vector<uint32_t> &removes,
 	              const std::vector<uint8_t> &opset,
 		      std::vector<duration<double>> *insert_times,
 		      std::vector<duration<double>> *rebuild_times)
@@ -132,38 +135,30 @@ class amorttester {
 		enum hashtable::result r;
 
 		uint32_t k;
+		std::size_t next = 0;
 		time_point<steady_clock> t1, t2;
 
 		duration<double> insert_time(0), rebuild_time(0);
 
 		t1 = steady_clock::now();
-		for (int i=0; i<nops; ++i) {
-			if (opset[i] == 0) {
+		for (uint8_t op : opset) {
+			if (op == 0) {
 				assert(ht->num_records() < ht->table_size());
 				assert(!testset->empty());
 				k = testset->back();
+				testset->pop_back();
 				r = ht->insert(k, k);
-				if (r == hashtable::result::SUCCESS ||
-				    r == hashtable::result::REBUILD) {
-					testset->pop_back();
-					inserted->push_back(k);
-				} else
+				if (r != hashtable::result::SUCCESS &&
+				    r != hashtable::result::REBUILD)
 					std::cerr << "Duplicate insert!\n";
 			} else {
-				assert(!inserted->empty());
-				assert(!delorder->empty());
-				k = (*inserted)[delorder->back()];
+				k = removes[next++];
 				/* uint32_t v; // check
 				   assert(ht->query(k,&v)); 
 				   assert(v == k); */
 				r = ht->remove(k);
-				if (r != hashtable::result::FAILURE) {
-					(*inserted)[delorder->back()] =
-						inserted->back();
-					inserted->pop_back();
-					delorder->pop_back();
-				}
-				else { std::cerr << "What?\n"; }
+				if (r == hashtable::result::FAILURE)
+					std::cerr << "What?\n";
 			}
 
 			if (r == hashtable::result::REBUILD) {
@@ -185,13 +180,21 @@ class amorttester {
 	                 std::vector<uint32_t> *inserted,
 	                 std::vector<duration<double>> *optimes,
 	                 std::vector<duration<double>> *insert_times,
-			 std::vector<duration<double>> *rebuild_times)
+			 std::vector<duration<double>> *rebuild_times,
+			 hw_counts *h, sw_counts *sw)
 	{
 		time_point<steady_clock> t1,t2;
 		ht->rebuild(); 
 		ht->reset_perf_counts();
 		cout << "Timing floating operations with rebuilds.\n";
 
+		// every key the run can insert, for the picker's ranks; built
+		// once, as it works out the zipfian's zeta for that many
+		std::size_t total = inserted->size()
+		                    + (std::size_t)ntests * (nops/2+1);
+		picker access(wl, total);
+		std::vector<bool> gone(inserted->size(), false);
+
 		for (int i=0; i<ntests; ++i) {
 			cout << i+1 << "/" << ntests << std::flush;
 			// operations 
@@ -200,26 +203,25 @@ class amorttester {
 			for (int j = (i&1); j < nops; ++j) opset.push_back(j & 1);
 			// std::shuffle(std::begin(opset), std::end(opset), rng);
 
-			// deletion order
-			std::vector<uint32_t> delorder;
-			delorder.reserve(nops/2+1);
-			std::uniform_int_distribution<> U(0,inserted->size()/2);
-			while((int)delorder.size() < nops/2+1) 
-				delorder.push_back(U(rng));
+			std::vector<uint32_t> removes = pick_removes(access,
+			    total, *testset, inserted, &gone, opset);
 
-			ht->rebuilds = 0;
 			// timed section - floating ops and rebuild
+			hw.start();
 			t1 = steady_clock::now();
-			floating(ht, testset, inserted, &delorder, opset,
+			floating(ht, testset, removes, opset,
 			         insert_times, rebuild_times);
 			t2 = steady_clock::now();
+			hw.stop();
 			optimes->push_back(t2 - t1);
+			*h += hw.read();
 
 			cout << " Time: " << optimes->back()
 			     << ", Inserting: " << insert_times->back()
 			     << ", Rebuilding: " << rebuild_times->back()
 			     << std::endl;
 
+			sw->add(*ht);
 			ht->rebuild();
 			ht->reset_perf_counts();
 		}
@@ -241,7 +243,10 @@ class amorttester {
 			  << q.total_rb_time << ", "
 			  << q.rw << ", "
 			  << q.rb << ", "
-			  << q.alpha << '\n';
+			  << q.alpha;
+			if (hw.available())
+				q.hw.csv(o << ", ", (double)q.nops * ntests);
+			o << '\n';
 		}
 
 		return o;
@@ -258,6 +263,8 @@ class amorttester {
 		ht.set_max_load_factor(1.0);
 
 		vector <duration<double>> op_times, ins_times, rb_times;
+		hw_counts h;
+		sw_counts sw;
 		double lf = 1.0 - (1.0 / x);
 
 		cout << ht.table_type() << " "
@@ -271,7 +278,7 @@ class amorttester {
 
 		loadtable(&ht, &testset, &inserted, lf);
 		float_timer(&ht, &testset, &inserted,
-		            &op_times, &ins_times, &rb_times);
+		            &op_times, &ins_times, &rb_times, &h, &sw);
 
 		amort_stats_t q {
 			.b                = b,
@@ -291,17 +298,34 @@ class amorttester {
 			       (unsigned int)(nops * 4 * x / ht.table_size()),
 			.alpha            = ht.load_factor(),
 			.n                = ht.table_size(),
+			.hw               = h,
 		};
 
 		stats.push_back(q);
+
+		result_record r("amort");
+		r.describe(ht).times(op_times);
+		r.x = x;
+		r.op = "insert/remove";
+		r.ops = nops;
+		r.extra["insert_time"] = q.total_ins_time;
+		r.extra["rebuild_time"] = q.total_rb_time;
+		r.extra["rebuild_window"] = q.rw;
+		r.extra["rebuilds"] = q.rb;
+		r.sw = sw;
+		r.hw = h;
+		rows.push_back(r);
 	}
 
 	public:
-	amorttester(pcg64 &r, double x, uint64_t b, int no, int nt)
-	             : rng(r), x(x), nops(no), ntests(nt), b(b) {
+	amorttester(pcg64 &r, double x, uint64_t b, int no, int nt,
+	            workload const &w = workload())
+	             : rng(r), x(x), nops(no), ntests(nt), b(b), wl(w) {
 		run_test();
 	}
 
+	const std::vector<result_record>& results() const { return rows; }
+
 	friend std::ostream&
 	operator<<(std::ostream& os, amorttester const& h) {
 		return h.dump_amort_stats(os);
@@ -0,0 +1,150 @@
+#ifndef DISPATCH_HPP
+#define DISPATCH_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+#include "robinhood.h"
+#include "swiss.h"
+#include "pma.h"
+#include "funnel.h"
+#include "baselines.h"
+
+// pick a table type at runtime, once.
+//
+// with_table(name, key_bits, value_bits, stats, f) calls f.template
+// operator()<T>() for the matching table, e.g. with a lambda
+//   [&]<typename hashtable>() { o << querytester<hashtable>(...); }
+// so everything under f is compiled per table type and the inner loops
+// never branch on it.  stats is the instrumentation policy (perfstats.h)
+// by name; all but full are built for 32 bit keys and values only.
+// returns false for an unknown name, width or policy.
+
+const std::vector<std::string> table_names {
+	"graveyard_aos", "graveyard_soa", "graveyard_aosoa", "ordered_aos",
+	"ordered_soa", "ordered_aosoa", "linear_aos", "linear_soa",
+	"linear_aosoa", "robinhood_aos", "robinhood_soa", "robinhood_aosoa",
+	"swiss_aos", "pma_aos", "funnel_aos", "graveyard_bkt",
+};
+
+// not ours, for comparison (baselines.h); "all" leaves them out
+const std::vector<std::string> baseline_names {
+	"stl_unordered", "stl_map", "sorted_array",
+};
+
+// perfstats.h's policies, by stats_name
+const std::vector<std::string> stats_names {
+	"full", "histograms", "cheap", "none",
+};
+
+template <template <typename, typename, typename> class table, typename F>
+bool
+with_stats(int key_bits, int value_bits, const std::string &stats, F &&f)
+{
+	if (key_bits != 32 || value_bits != 32) {
+		std::cerr << "stats=" << stats << " only with 32 bit keys and "
+		          << "values\n";
+		return false;
+	}
+	if (stats == "histograms")
+		f.template operator()<table<uint32_t, uint32_t,
+		                            ProbeHistograms>>();
+	else if (stats == "cheap")
+		f.template operator()<table<uint32_t, uint32_t,
+		                            CheapCounters>>();
+	else if (stats == "none")
+		f.template operator()<table<uint32_t, uint32_t, NoStats>>();
+	else {
+		std::cerr << "unknown stats policy " << stats << "\n";
+		return false;
+	}
+	return true;
+}
+
+template <template <typename, typename, typename> class table, typename F>
+bool
+with_widths(int key_bits, int value_bits, const std::string &stats, F &&f)
+{
+	if (stats != "full")
+		return with_stats<table>(key_bits, value_bits, stats, f);
+	if (key_bits == 32 && value_bits == 32)
+		f.template operator()<table<uint32_t, uint32_t, FullStats>>();
+	else if (key_bits == 32 && value_bits == 64)
+		f.template operator()<table<uint32_t, uint64_t, FullStats>>();
+	else if (key_bits == 64 && value_bits == 32)
+		f.template operator()<table<uint64_t, uint32_t, FullStats>>();
+	else if (key_bits == 64 && value_bits == 64)
+		f.template operator()<table<uint64_t, uint64_t, FullStats>>();
+	else {
+		std::cerr << "no " << key_bits << "/" << value_bits
+		          << " bit key/value tables (32 or 64 each)\n";
+		return false;
+	}
+	return true;
+}
+
+template <typename F>
+bool
+with_table(const std::string &name, int key_bits, int value_bits,
+           const std::string &stats, F &&f)
+{
+	if (name == "graveyard_aos")
+		return with_widths<graveyard_aos>(key_bits, value_bits,
+		                                  stats, f);
+	if (name == "graveyard_soa")
+		return with_widths<graveyard_soa>(key_bits, value_bits,
+		                                  stats, f);
+	if (name == "graveyard_aosoa")
+		return with_widths<graveyard_aosoa>(key_bits, value_bits,
+		                                    stats, f);
+	if (name == "graveyard_bkt")
+		return with_widths<graveyard_bkt>(key_bits, value_bits,
+		                                  stats, f);
+	if (name == "ordered_aos")
+		return with_widths<ordered_aos>(key_bits, value_bits, stats, f);
+	if (name == "ordered_soa")
+		return with_widths<ordered_soa>(key_bits, value_bits, stats, f);
+	if (name == "ordered_aosoa")
+		return with_widths<ordered_aosoa>(key_bits, value_bits,
+		                                  stats, f);
+	if (name == "linear_aos")
+		return with_widths<linear_aos>(key_bits, value_bits, stats, f);
+	if (name == "linear_soa")
+		return with_widths<linear_soa>(key_bits, value_bits, stats, f);
+	if (name == "linear_aosoa")
+		return with_widths<linear_aosoa>(key_bits, value_bits,
+		                                 stats, f);
+	if (name == "robinhood_aos")
+		return with_widths<robinhood_aos>(key_bits, value_bits,
+		                                  stats, f);
+	if (name == "robinhood_soa")
+		return with_widths<robinhood_soa>(key_bits, value_bits,
+		                                  stats, f);
+	if (name == "robinhood_aosoa")
+		return with_widths<robinhood_aosoa>(key_bits, value_bits,
+		                                    stats, f);
+	if (name == "swiss_aos")
+		return with_widths<swiss_aos>(key_bits, value_bits, stats, f);
+	if (name == "pma_aos")
+		return with_widths<pma_aos>(key_bits, value_bits, stats, f);
+	if (name == "funnel_aos")
+		return with_widths<funnel_aos>(key_bits, value_bits, stats, f);
+	if (name == "stl_unordered")
+		return with_widths<stl_unordered>(key_bits, value_bits,
+		                                  stats, f);
+	if (name == "stl_map")
+		return with_widths<stl_map>(key_bits, value_bits, stats, f);
+	if (name == "sorted_array")
+		return with_widths<sorted_array>(key_bits, value_bits,
+		                                 stats, f);
+
+	std::cerr << "unknown table type " << name << "\n";
+	return false;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef FILLTABLE_HPP
+#define FILLTABLE_HPP
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+// the untimed load phase shared by the testers: insert next_key() until
+// the table reaches load factor lf, appending every key that went in to
+// *inserted.  when an insert returns REBUILD, on_rebuild(ht) decides what
+// to do (rebuild, or nothing to let the rebuild window run out).
+// returns false if the table filled up.
+
+template <typename hashtable, typename keyfn, typename rebuildfn>
+bool
+fill_table(hashtable *ht, double lf, keyfn next_key,
+           std::vector<uint32_t> *inserted, rebuildfn on_rebuild)
+{
+	using result = hashtable::result;
+	double start = ht->load_factor();
+	int64_t interval = (lf - start) * ht->table_size() / 20 + 1;
+	int64_t stat_timer = interval;
+
+	std::cout << "Load: " << start << " -> " << lf << std::flush;
+
+	while (ht->load_factor() < lf) {
+		uint32_t k = next_key();
+		switch (ht->insert(k, k>>2)) {
+		case result::SUCCESS:
+			inserted->push_back(k);
+			break;
+		case result::REBUILD:
+			inserted->push_back(k);
+			on_rebuild(ht);
+			break;
+		case result::FULLTABLE: // this should never happen
+			std::cerr << "Table full!\n";
+			return false;
+		default:                // random keys may repeat
+			break;
+		}
+
+		if (--stat_timer == 0) {
+			stat_timer = interval;
+			std::cout << "\rLoad: [" << (int)(100 * (ht->load_factor()
+			             - start) / (lf - start)) << "%]   "
+			          << std::flush;
+		}
+	}
+
+	std::cout << "\rLoad: " << start << " -> " << lf
+	          << " [done], inserted=" << inserted->size() << "\n";
+	return true;
+}
+
+template <typename hashtable>
+void rebuild_on_load(hashtable *ht) { ht->rebuild(); }
+
+template <typename hashtable>
+void ignore_rebuild(hashtable *) {}
+
+#endif
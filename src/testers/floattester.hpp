@@ -14,6 +14,11 @@
 #include "pcg_random.hpp"
 #include "primes.h"
 #include "graveyard.h"
+#include "ordered.h"
+#include "workload.h"
+#include "filltable.hpp"
+#include "results.h"
+#include "measure.h"
 
 using std::chrono::duration;
 using std::chrono::steady_clock;
@@ -30,6 +35,10 @@ class floattester {
 	const std::vector<uint64_t> &bs;
 	int nops;
 	int ntests;
+	std::string snap_path;  // if set, snapshot at the start of each trial
+	keyset keys;            // key(i) is unique for every i
+	uint64_t next_key;      // index of the next unused key
+	measure m;
 
 	struct float_stats_t {
 		int nops;
@@ -39,8 +48,11 @@ class floattester {
 		double alpha;
 		int x;
 		std::size_t n;
+		std::vector<duration<double>> snap_time; // fork() stall
+		std::vector<double> snap_dirty;  // fraction of regions dirtied
 	};
 	std::vector<float_stats_t> stats;
+	std::vector<result_record> rows;
 
 	inline void
 	loadrebuild(hashtable *ht)
@@ -49,85 +61,45 @@ class floattester {
 		// because rebuilding really speeds up loading for graveyards
 	}
 
-	// make a set of keys for loading and floating ops, no duplicates
-	void
-	gen_testset(std::vector<uint32_t>* loadset, uint32_t n,
-	            std::vector<uint32_t>* testset,
-	            std::vector<uint8_t>* opset)
+	// for the tables that take background snapshots (the graveyard
+	// and ordered tables, in every layout)
+	inline bool
+	start_snapshot(hashtable *ht)
 	{
-		cout << "Generate test set\n";
-		loadset->reserve(UINT32_MAX);
-		for (uint32_t i = 0; i< UINT32_MAX; ++i)
-			loadset->push_back(i);
-
-		cout << "Loadset generated\n";
-		std::shuffle(std::begin(*loadset), std::end(*loadset), rng);
-
-		cout << "Loadset shuffled\n";
-
-		uint32_t idx = (nops/2) * ntests * xs.size();
-		testset->reserve(idx);
-		testset->insert(testset->end(),
-		                std::make_move_iterator(loadset->end() - idx),
-		                std::make_move_iterator(loadset->end()));
+		if constexpr (requires { ht->snapshot(snap_path); })
+			return ht->snapshot(snap_path);
+		return false;
+	}
 
-		loadset->resize(n);
-		loadset->shrink_to_fit();
+	inline double
+	finish_snapshot(hashtable *ht)
+	{
+		if constexpr (requires { ht->snapshot_wait(); }) {
+			if (!ht->snapshot_wait())
+				std::cerr << "Snapshot failed!\n";
+			return (double)ht->snapshot_dirty_regions()
+			       / ht->snapshot_regions();
+		}
+		return 0;
+	}
 
+	// operations for one trial: half inserts, half removes
+	void
+	gen_opset(std::vector<uint8_t>* opset)
+	{
 		opset->reserve(nops);
 		for (int i = 0; i < nops; ++i)
 			opset->push_back(i & 1);
 		std::shuffle(std::begin(*opset), std::end(*opset), rng);
-
-		cout << "loadset=" << loadset->size() << ", testset=" << testset->size() << ", opset="<<opset->size()<<'\n';
 	}
 
 	// generate random numbers and insert into the table.
 	// maintain list of all keys inserted until target load factor reached
 	void
-	loadtable(hashtable *ht, std::vector<uint32_t> *loadset,
-	          std::vector<uint32_t> *inserted, double lf)
+	loadtable(hashtable *ht, std::vector<uint32_t> *inserted, double lf)
 	{
-		double start = ht->load_factor();
-		int loadops = ht->table_size() * (lf - start);
-		int interval = loadops / 20;
-		int stat_timer = interval;
-		uint64_t k;
-
-		cout << "Load: " << start << " -> " << lf << "\n";
-
-		for (int i = 0; i < loadops; ++i) {
-			k = loadset->back();
-			loadset->pop_back();
-			using result = hashtable::result;
-			result r = ht->insert(k, k>>2);
-			switch(r) {
-			case result::SUCCESS:
-				inserted->push_back(k);
-				break;
-			case result::REBUILD:
-				inserted->push_back(k);
-				loadrebuild(ht);
-				break;
-			case result::FULLTABLE: // this should never happen
-				std::cerr << "Table full!\n";
-				return;
-			case result::DUPLICATE: // this also shouldn't happen
-				std::cerr << "Duplicate found\n";
-			default:
-				break;
-			}
-
-			if (--stat_timer == 0) {
-				stat_timer = interval;
-				cout << "\r["
-				     << 100 * (ht->load_factor() - start)
-				        / (lf - start)
-				     << "%]   " << std::flush;
-			}
-		}
-
-		cout << "\r[done]     , inserted=" << inserted->size() << "\n";
+		fill_table(ht, lf, [this] { return keys(next_key++); }, inserted,
+		           [this](hashtable *h) { loadrebuild(h); });
 	}
 
 	void
@@ -163,25 +135,54 @@ class floattester {
 	void float_timer(hashtable *ht, std::vector<uint32_t> *testset,
 	                 std::vector<uint32_t> *inserted,
 	                 std::vector<uint8_t> *opset,
-			 std::vector<duration<double>> *optimes)
+			 std::vector<duration<double>> *optimes,
+			 std::vector<duration<double>> *snaptimes,
+			 std::vector<double> *snapdirty,
+			 sw_counts *sw)
 	{
 		time_point<steady_clock> start, end;
+		bool snapping = false;
 		ht->rebuild();  // start from a "good" state
-		ht->reset_perf_counts();
 		cout << "timing floating operations: ";
+		// a trial's ops in a fresh order, with fresh keys to insert
+		auto next_trial = [&] {
+			std::shuffle(std::begin(*opset), std::end(*opset), rng);
+			std::size_t nins = std::count(opset->begin(),
+			                              opset->end(), 1);
+			testset->resize(nins);
+			keys.fill(testset->data(), next_key, nins);
+			next_key += nins;
+		};
+		m.warmup([&] {
+			next_trial();
+			floating(ht, testset, inserted, opset);
+			ht->rebuild();
+		});
+		ht->reset_perf_counts();
 		for (int i=0; i<ntests; ++i) {
 			cout << i+1 << std::flush;
-			std::shuffle(std::begin(*opset), std::end(*opset), rng);
+			next_trial();
 			cout << "." << std::flush;
 
+			if (!snap_path.empty()) {
+				start = steady_clock::now();
+				snapping = start_snapshot(ht);
+				end = steady_clock::now();
+				snaptimes->push_back(end - start);
+			}
+
 			// timed section
+			m.prepare();
 			start = steady_clock::now();
 			floating(ht, testset, inserted, opset);
 			end = steady_clock::now();
 			optimes->push_back(end - start);
 
+			if (snapping) snapdirty->push_back(finish_snapshot(ht));
+
 			cout << ". " << std::flush;
 
+			sw->add(*ht);
 			ht->rebuild();
 			ht->reset_perf_counts();
 		}
@@ -192,7 +193,10 @@ class floattester {
 	{
 		o << "\n----- " << type
 		     << " --------------------------------\n";
-		o << "# ops, times, mean, median, loadfactor, x, n\n";
+		o << "# ops, times, mean, median, loadfactor, x, n";
+		if (!snap_path.empty())
+			o << ", snapshot times, mean snapshot time, dirty";
+		o << "\n";
 
 		for (float_stats_t q : stats) {
 			o << q.nops << ", "
@@ -201,7 +205,16 @@ class floattester {
 			  << q.median_ops_time << ", "
 			  << q.alpha << ", "
 			  << q.x << ", "
-			  << q.n << '\n';
+			  << q.n;
+			if (!snap_path.empty()) {
+				double d = 0;
+				for (double f : q.snap_dirty) d += f;
+				if (!q.snap_dirty.empty()) d /= q.snap_dirty.size();
+				o << ", " << q.snap_time << ", "
+				  << (q.snap_time.empty() ? 0 : mean(q.snap_time))
+				  << ", " << d;
+			}
+			o << '\n';
 		}
 
 		return o;
@@ -209,30 +222,32 @@ class floattester {
 
 	void run_test()
 	{
-		
+		m.setup();
 		for (auto b : bs) {
-			std::vector <uint32_t> loadset, testset;
+			std::vector <uint32_t> testset;
 			std::vector <uint8_t> opset;
 			std::vector <uint32_t> inserted;
 			hashtable ht(next_prime(b));
 			type = ht.table_type();
 			cout << type << "\n";
 
-			gen_testset(&loadset, ht.table_size(), &testset, &opset);
+			gen_opset(&opset);
 
 			ht.set_max_load_factor(1.0);
 			for (auto x : xs) {
-				vector <duration<double>> op_times;
+				vector <duration<double>> op_times, snap_times;
+				vector <double> snap_dirty;
+				sw_counts sw;
 				double lf = 1.0 - (1.0 / x);
 
 				cout << ht.table_type() << " "
 				     << ht.table_size() << ", x="
 				     << x << std::endl;
 
-				loadtable(&ht, &loadset, &inserted, lf);
+				loadtable(&ht, &inserted, lf);
 
 				float_timer(&ht, &testset, &inserted, &opset, 
-				            &op_times);
+				            &op_times, &snap_times, &snap_dirty, &sw);
 
 				float_stats_t q {
 					.nops                = nops,
@@ -242,20 +257,43 @@ class floattester {
 					.alpha               = ht.load_factor(),
 					.x                   = x,
 					.n                   = ht.table_size(),
+					.snap_time           = snap_times,
+					.snap_dirty          = snap_dirty,
 				};
 
 				stats.push_back(q);
+
+				result_record r("float");
+				r.describe(ht).times(op_times);
+				r.x = x;
+				r.op = "insert/remove";
+				r.ops = nops;
+				if (!snap_times.empty())
+					r.extra["snapshot_time"] = mean(snap_times);
+				if (!snap_dirty.empty())
+					r.extra["snapshot_dirty"] =
+					    std::accumulate(snap_dirty.begin(),
+					                    snap_dirty.end(), 0.0)
+					    / snap_dirty.size();
+				r.sw = sw;
+				rows.push_back(r);
 			}
 		}
 	}
 
 	public:
 	floattester(pcg64 &r, std::vector<int> const &x,
-	            std::vector<uint64_t> const &b, int no, int nt)
-	             : rng(r), xs(x), bs(b), nops(no), ntests(nt) {
+	            std::vector<uint64_t> const &b, int no, int nt,
+	            std::string const &sp = "",
+	            workload const &w = workload(),
+	            measure_options const &mo = measure_options())
+	             : rng(r), xs(x), bs(b), nops(no), ntests(nt),
+	               snap_path(sp), keys(w, r), next_key(0), m(mo) {
 		run_test();
 	}
 
+	const std::vector<result_record>& results() const { return rows; }
+
 	friend std::ostream&
 	operator<<(std::ostream& os, floattester const& h) {
 		return h.dump_float_stats(os);
@@ -274,4 +312,10 @@ floattester<graveyard_soa<>>::loadrebuild(graveyard_soa<> *ht)
 	ht->rebuild();
 }
 
+template<> inline void
+floattester<graveyard_aosoa<>>::loadrebuild(graveyard_aosoa<> *ht)
+{
+	ht->rebuild();
+}
+
 #endif
@@ -0,0 +1,324 @@
+#ifndef LATENCYTESTER_HPP
+#define LATENCYTESTER_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+#include "latency.h"
+#include "keygen.h"
+#include "filltable.hpp"
+#include "results.h"
+#include "measure.h"
+
+using std::cout;
+
+// per-operation latency under a floating insert/remove/query mix.
+//
+// every operation is timestamped individually, and an operation that
+// returns REBUILD is charged for the rebuild it triggers, as it would be
+// in a service that rebuilds inline.  operations at or above the p99 and
+// p99.9 latencies are attributed to the worst thing that happened while
+// they ran: a rebuild, a resize, a long shift or a long probe (more than
+// long_len slots), otherwise "other" (cache/TLB misses, interrupts).
+//
+// needs the FullStats counters (the default) for the attribution.
+
+template <typename hashtable>
+class latencytester {
+	private:
+	std::string type;
+	pcg64 &rng;
+	const std::vector<int> &xs;
+	uint64_t b;
+	int nops;
+	int ntests;
+	int query_pct;
+	uint64_t long_len;
+	measure m;
+
+	enum cause { OTHER, LONG_PROBE, LONG_SHIFT, RESIZE, REBUILD, NCAUSES };
+	enum op { INS, REM, QRY };
+
+	struct latency_stats_t {
+		int nops;
+		double alpha;
+		int x;
+		std::size_t n;
+		double mean;                    // all latencies in ns
+		double p50, p99, p999, max;
+		uint64_t p99_cause[NCAUSES];    // ops >= p99, by cause
+		uint64_t p999_cause[NCAUSES];   // ops >= p99.9, by cause
+		uint64_t rebuilds, resizes;
+	};
+	std::vector<latency_stats_t> stats;
+	std::vector<result_record> rows;
+
+	// make a set of keys for loading and floating ops, no duplicates
+	void
+	gen_testset(std::vector<uint32_t>* loadset, uint32_t n)
+	{
+		n += nops * (ntests + m.opts().warmup) * xs.size();
+		cout << "Generate testset, size " << n << "..." << std::flush;
+		loadset->resize(n);
+		keygen(rng).fill(loadset->data(), 0, n);
+		cout << "done\n";
+	}
+
+	void
+	loadtable(hashtable *ht, std::vector<uint32_t> *loadset,
+	          std::vector<uint32_t> *inserted, double lf)
+	{
+		auto next = [loadset] {
+			uint32_t k = loadset->back();
+			loadset->pop_back();
+			return k;
+		};
+		fill_table(ht, lf, next, inserted, rebuild_on_load<hashtable>);
+	}
+
+	// run the ops, recording ticks and cause for each
+	void
+	floating(hashtable *ht, std::vector<uint32_t> *testset,
+	         std::vector<uint32_t> *inserted,
+	         const std::vector<uint8_t> &opset,
+	         std::vector<uint32_t> *lat, std::vector<uint8_t> *why)
+	{
+		using res = hashtable::result;
+		typename hashtable::value_type v;
+		uint32_t k;
+		res r;
+
+		for (uint8_t o : opset) {
+			uint64_t misses = ht->total_misses;
+			uint64_t shifts = ht->insert_shifts;
+			uint64_t resizes = ht->resizes;
+			std::size_t i = 0;
+			bool rebuilt = false;
+
+			if (o == INS) {
+				k = testset->back();
+				testset->pop_back();
+			} else {
+				std::uniform_int_distribution<std::size_t>
+					p(0, inserted->size()-1);
+				i = p(rng);
+				k = (*inserted)[i];
+			}
+
+			// timed section: one operation
+			uint64_t t0 = ticks();
+			if (o == INS) {
+				r = ht->insert(k, k>>2);
+			} else if (o == REM) {
+				r = ht->remove(k);
+			} else {
+				ht->query(k, &v);
+				r = res::SUCCESS;
+			}
+			if (r == res::REBUILD) {
+				ht->rebuild();
+				rebuilt = true;
+			}
+			uint64_t t1 = ticks();
+			// end timed section
+
+			lat->push_back(std::min<uint64_t>(t1 - t0, UINT32_MAX));
+
+			if (rebuilt)
+				why->push_back(REBUILD);
+			else if (ht->resizes != resizes)
+				why->push_back(RESIZE);
+			else if (ht->insert_shifts - shifts > long_len)
+				why->push_back(LONG_SHIFT);
+			else if (ht->total_misses - misses > long_len)
+				why->push_back(LONG_PROBE);
+			else
+				why->push_back(OTHER);
+
+			if (o == INS) {
+				inserted->push_back(k);
+			} else if (o == REM && r != res::FAILURE) {
+				std::swap((*inserted)[i], inserted->back());
+				inserted->pop_back();
+			}
+		}
+	}
+
+	latency_stats_t
+	latency_timer(hashtable *ht, std::vector<uint32_t> *testset,
+	              std::vector<uint32_t> *inserted, int x)
+	{
+		std::vector<uint32_t> lat;
+		std::vector<uint8_t> why;
+		std::vector<uint8_t> opset;
+		latency_histogram h;
+		uint64_t rebuilds = 0, resizes = 0;
+		std::vector<std::size_t> trial_end;
+		sw_counts sw;
+
+		lat.reserve((std::size_t)nops * ntests);
+		why.reserve((std::size_t)nops * ntests);
+
+		// equal inserts and removes keep the load factor steady
+		int nq = (int64_t)nops * query_pct / 100;
+		for (int i = 0; i < nops - nq; ++i) opset.push_back(i & 1);
+		for (int i = 0; i < nq; ++i) opset.push_back(QRY);
+
+		ht->rebuild();  // start from a "good" state
+		m.warmup([&] {
+			std::vector<uint32_t> l;
+			std::vector<uint8_t> w;
+			std::shuffle(std::begin(opset), std::end(opset), rng);
+			floating(ht, testset, inserted, opset, &l, &w);
+			ht->rebuild();
+		});
+		ht->rebuilds = 0;
+		ht->reset_perf_counts();
+		cout << "timing operations: ";
+		for (int i = 0; i < ntests; ++i) {
+			cout << i+1 << ". " << std::flush;
+			std::shuffle(std::begin(opset), std::end(opset), rng);
+			m.prepare();
+			floating(ht, testset, inserted, opset, &lat, &why);
+			trial_end.push_back(lat.size());
+			sw.add(*ht);
+			rebuilds += ht->rebuilds;
+			resizes += ht->resizes;
+			ht->rebuilds = 0;
+			ht->reset_perf_counts();
+		}
+		cout << std::endl;
+
+		double tpn = ticks_per_ns();
+		for (uint32_t t : lat) h.add(t);
+		uint64_t p99 = h.percentile(0.99), p999 = h.percentile(0.999);
+
+		latency_stats_t q {
+			.nops     = nops,
+			.alpha    = ht->load_factor(),
+			.x        = x,
+			.n        = ht->table_size(),
+			.mean     = h.mean() / tpn,
+			.p50      = h.percentile(0.5) / tpn,
+			.p99      = p99 / tpn,
+			.p999     = p999 / tpn,
+			.max      = h.max_value / tpn,
+			.p99_cause  = {},
+			.p999_cause = {},
+			.rebuilds = rebuilds,
+			.resizes  = resizes,
+		};
+		for (std::size_t i = 0; i < lat.size(); ++i) {
+			if (lat[i] >= p99) ++q.p99_cause[why[i]];
+			if (lat[i] >= p999) ++q.p999_cause[why[i]];
+		}
+
+		// the trial times are the sums of their ops' latencies
+		const char *cause_name[] = { "other", "probe", "shift",
+		                             "resize", "rebuild" };
+		result_record r("latency");
+		r.describe(*ht);
+		r.x = x;
+		r.op = "mixed";
+		r.ops = nops;
+		for (std::size_t i = 0, s = 0; i < trial_end.size(); ++i) {
+			double t = 0;
+			for (; s < trial_end[i]; ++s) t += lat[s];
+			r.trials.push_back(t / tpn / 1e9);
+		}
+		r.extra["query_pct"] = query_pct;
+		r.extra["mean_ns"] = q.mean;
+		r.extra["p50_ns"] = q.p50;
+		r.extra["p99_ns"] = q.p99;
+		r.extra["p999_ns"] = q.p999;
+		r.extra["max_ns"] = q.max;
+		for (int c = 0; c < NCAUSES; ++c) {
+			r.extra[std::string("p99_") + cause_name[c]] =
+			    q.p99_cause[c];
+			r.extra[std::string("p999_") + cause_name[c]] =
+			    q.p999_cause[c];
+		}
+		r.extra["rebuilds"] = rebuilds;
+		r.extra["resizes"] = resizes;
+		r.sw = sw;
+		rows.push_back(r);
+
+		return q;
+	}
+
+	std::ostream& dump_latency_stats(std::ostream &o = std::cout) const
+	{
+		o << "\n----- " << type
+		  << " --------------------------------\n";
+		o << "ops/trial, loadfactor, x, n, mean, p50, p99, p99.9, max, "
+		     "p99 rebuild, p99 resize, p99 shift, p99 probe, p99 other, "
+		     "p99.9 rebuild, p99.9 resize, p99.9 shift, p99.9 probe, "
+		     "p99.9 other, rebuilds, resizes\n";
+
+		for (latency_stats_t q : stats) {
+			o << q.nops << ", "
+			  << q.alpha << ", "
+			  << q.x << ", "
+			  << q.n << ", "
+			  << q.mean << ", "
+			  << q.p50 << ", "
+			  << q.p99 << ", "
+			  << q.p999 << ", "
+			  << q.max;
+			for (const uint64_t *c : { q.p99_cause, q.p999_cause })
+				o << ", " << c[REBUILD] << ", " << c[RESIZE]
+				  << ", " << c[LONG_SHIFT] << ", "
+				  << c[LONG_PROBE] << ", " << c[OTHER];
+			o << ", " << q.rebuilds << ", " << q.resizes << '\n';
+		}
+
+		return o;
+	}
+
+	void run_test()
+	{
+		m.setup();
+		std::vector <uint32_t> testset, inserted;
+		hashtable ht(next_prime(b));
+		type = ht.table_type();
+		cout << type << "\n";
+
+		gen_testset(&testset, ht.table_size());
+		inserted.reserve(ht.table_size());
+		ht.set_max_load_factor(1.0);
+
+		for (auto x : xs) {
+			double lf = 1.0 - (1.0 / x);
+			cout << type << " " << ht.table_size() << ", x="
+			     << x << std::endl;
+
+			loadtable(&ht, &testset, &inserted, lf);
+			stats.push_back(latency_timer(&ht, &testset, &inserted,
+			                              x));
+		}
+	}
+
+	public:
+	latencytester(pcg64 &r, std::vector<int> const &x, uint64_t b,
+	              int no, int nt, int qp = 50, uint64_t ll = 32,
+	              measure_options const &mo = measure_options())
+	             : rng(r), xs(x), b(b), nops(no), ntests(nt),
+	               query_pct(qp), long_len(ll), m(mo) {
+		run_test();
+	}
+
+	const std::vector<result_record>& results() const { return rows; }
+
+	friend std::ostream&
+	operator<<(std::ostream& os, latencytester const& h) {
+		return h.dump_latency_stats(os);
+	}
+};
+
+#endif
@@ -13,6 +13,10 @@
 
 #include "pcg_random.hpp"
 #include "primes.h"
+#include "perfcounters.h"
+#include "keygen.h"
+#include "results.h"
+#include "measure.h"
 
 //#define VERIFY    /* debug: exhaustively test all keys and values inserted */
 //#define VERBOSE   /* enable progress meter */
@@ -27,9 +31,12 @@ class loadtester {
 	hashtable ht;
 	std::size_t opcount;
 	double target_lf;
+	int x;
 	int intervals;
 	bool loadrebuild;
 	std::vector<uint32_t> loadset;
+	perfcounters hw;
+	measure m;              // one timed pass: no warmup
 
 	struct stats_t {
 		// record stats at the end of each interval
@@ -40,7 +47,37 @@ class loadtester {
 		std::vector<uint64_t> ins_misses;       // misses
 		std::vector<uint64_t> ins_shifts;       // shift distances
 		std::vector<uint64_t> longest_search;
+		std::vector<hw_counts> hw;              // since start of load
 	} stats;
+	std::vector<result_record> rows;
+
+	// one record per interval
+	void make_rows()
+	{
+		for (std::size_t i = 1; i < stats.wct.size(); i++) {
+			std::chrono::duration<double> t =
+			    stats.wct[i] - stats.wct[i-1];
+			result_record r("load");
+			r.describe(ht);
+			r.trials = { t.count() };
+			r.x = x;
+			r.alpha = stats.lf[i];
+			r.op = "insert";
+			r.ops = stats.op[i] - stats.op[i-1];
+			r.extra["rebuild_on_load"] = loadrebuild;
+			r.extra["interval"] = i;
+			r.sw.present = r.sw.misses = true;
+			r.sw.v[sw_counts::INSERTS] = stats.ins[i] - stats.ins[i-1];
+			r.sw.v[sw_counts::INSERT_MISSES] =
+			    stats.ins_misses[i] - stats.ins_misses[i-1];
+			r.sw.v[sw_counts::INSERT_SHIFTS] =
+			    stats.ins_shifts[i] - stats.ins_shifts[i-1];
+			r.sw.v[sw_counts::LONGEST_SEARCH] = stats.longest_search[i];
+			r.hw = stats.hw[i] - stats.hw[i-1];
+			r.hw.present = stats.hw[i].present;
+			rows.push_back(r);
+		}
+	}
 
 	void push_timing_data()
 	{
@@ -51,6 +88,7 @@ class loadtester {
 		stats.ins_misses.push_back(ht.insert_misses);
 		stats.ins_shifts.push_back(ht.insert_shifts);
 		stats.longest_search.push_back(ht.longest_search);
+		stats.hw.push_back(hw.read());
 	}
 
 	std::ostream& dump_timing_data(std::ostream &o) const
@@ -70,8 +108,14 @@ class loadtester {
 		  << setw(w) << "Load_factor"
 		  << setw(w) << "Miss_per_insert"
 		  << setw(w) << "Longest_search"
-		  << setw(w) << "Shift_per_insert"
-		  << "\n";
+		  << setw(w) << "Shift_per_insert";
+		if (hw.available())
+			for (int e = 0; e < hw_counts::NEVENTS; ++e) {
+				std::string n = hw_counts::name(e);
+				std::replace(n.begin(), n.end(), ' ', '_');
+				o << ' ' << setw(w) << n + "/ins";
+			}
+		o << "\n";
 
 		for (i=1; i<stats.wct.size(); i++) {
 			uint64_t ops, ins, ins_m, ins_s;
@@ -89,8 +133,14 @@ class loadtester {
 			  << (double)ins_m / ins
 			  << setw(w) << stats.longest_search[i]
 			  << setw(w) << std::setprecision(4)
-			  << (double)ins_s / ins
-			  << "\n";
+			  << (double)ins_s / ins;
+			if (hw.available()) {
+				hw_counts d = stats.hw[i] - stats.hw[i-1];
+				for (int e = 0; e < hw_counts::NEVENTS; ++e)
+					o << ' ' << setw(w)
+					  << (double)d.v[e] / ins;
+			}
+			o << "\n";
 		}
 
 		t = stats.wct.back() - stats.wct.front();
@@ -137,27 +187,9 @@ class loadtester {
 	gen_testset(uint32_t n)
 	{
 		std::cout << "Generate test set\n";
-		uint32_t *s = new uint32_t[UINT32_MAX];
-		for (uint32_t i = 0; i < UINT32_MAX; ++i)
-			s[i]=i;
-//		std::cout << "Loadset generated, shuffling...";
-//		std::shuffle(std::begin(loadset), std::end(loadset), rng);
-
-		//auto numbers = std::ranges::views::iota(0U, UINT32_MAX);
-		uint32_t end = UINT32_MAX;
-		loadset.reserve(n);
-		std::uniform_int_distribution<uint64_t> r(0,UINT64_MAX);
-		for (uint32_t i = 0; i < n; ++i) {
-			uint32_t idx = r(rng) % end;
-			loadset.push_back(s[idx]);
-			s[idx] = s[--end];
-		}
-
-		delete[] s;
-		std::cout << "done\n";
-
 		loadset.resize(n);
-		loadset.shrink_to_fit();
+		keygen(rng).fill(loadset.data(), 0, n);
+		std::cout << "done\n";
 	}
 
 	void run_test()
@@ -165,6 +197,7 @@ class loadtester {
 		int insert_interval, stat_timer;
 		uint32_t k, idx;
 
+		m.setup();
 		ht.set_max_load_factor(1.0);	// disable automatic resizing
 
 		std::cout << "Table type " << ht.table_type()
@@ -179,6 +212,8 @@ class loadtester {
 		opcount = 0;
 		idx = 0;
 
+		m.prepare();
+		hw.start();
 		push_timing_data();
 		while(ht.load_factor() < target_lf) {
 			using result = hashtable::result;
@@ -207,6 +242,7 @@ class loadtester {
 
 		if (stat_timer != insert_interval)
 			push_timing_data();
+		hw.stop();
 #ifdef VERBOSE
 		std::cout << "\r[" << ht.load_factor()/target_lf*100
 		          << "% complete]     \n";
@@ -215,19 +251,21 @@ class loadtester {
 
 #ifdef VERIFY
 		std::cout << "\n\e[1mVerification\e[0m:\n";
-		uint32_t v;
+		typename hashtable::value_type v;
 		for(uint32_t x : keys) {
 			assert(ht.query(x,&v) == true);
 			assert(v == x>>2);
 		}
 #endif
 		ht.report_testing_stats();
+		make_rows();
 	}
 
 	public:
-	loadtester(pcg64 &r, size_t n, int x, int i, bool lr)
-	         : rng(r), ht(next_prime(n)), 
-	           intervals(i), loadrebuild(lr)
+	loadtester(pcg64 &r, size_t n, int x, int i, bool lr,
+	           measure_options const &mo = measure_options())
+	         : rng(r), ht(next_prime(n)), x(x),
+	           intervals(i), loadrebuild(lr), m(mo)
 	{
 		target_lf = 1 - 1.0/x;
 		run_test();
@@ -252,6 +290,8 @@ class loadtester {
 
 	}
 
+	const std::vector<result_record>& results() const { return rows; }
+
 	friend std::ostream&
 	operator<<(std::ostream& os, loadtester const& h) {
 		return h.dump_timing_data(h.table_info(os));
@@ -14,6 +14,8 @@
 #include "pcg_random.hpp"
 #include "primes.h"
 #include "linear.h"
+#include "filltable.hpp"
+#include "results.h"
 
 using std::chrono::duration;
 using std::chrono::steady_clock;
@@ -46,56 +48,19 @@ class one_rb_querytester {
 	};
 
 	std::vector<query_stats_t> querystats;
+	std::vector<result_record> rows;
 
 	void loadtable(hashtable *ht, std::vector<uint32_t> *keys, double lf)
 	{
-		double start = ht->load_factor();
-		int interval = (lf - ht->load_factor()) * ht->table_size() / 20;
-		int stat_timer = interval;
-		uint32_t k;
-
 		uniform_int_distribution<uint32_t> data(0,UINT32_MAX);
-		cout << "Loading: " << ht->load_factor() << " -> "
-		     << lf << " [      %]";
-
-		std::ios old(nullptr);
-		old.copyfmt(cout);
-		while(ht->load_factor() < lf) {
-			k = data(rng);
-			using result = hashtable::result;
-			result r = ht->insert(k, k>>1);
-			switch(r) {
-			case result::SUCCESS:
-				keys->push_back(k);
-				break;
-			case result::REBUILD:
-				keys->push_back(k);
-				break;
-			case result::FULLTABLE: // this should never happen
-				std::cerr << "Table full!\n";
-				return;
-			default:
-				break;
-			}
-
-			if (--stat_timer == 0) {
-				stat_timer = interval;
-				cout << "\b\b\b\b\b\b\b\b"
-				     << std::setw(6) << std::fixed
-				     << std::setprecision(2)
-				     << 100 * (ht->load_factor() - start)
-				        / (lf - start)
-				     << "%]" << std::flush;
-			}
-		}
-		cout.copyfmt(old);
-		cout << "\b\b\b\b\b\b\b\bdone]         \n";
+		fill_table(ht, lf, [&] { return data(rng); }, keys,
+		           ignore_rebuild<hashtable>);
 	}
 
 	void querying(hashtable *ht, const std::vector<uint32_t> &keys,
 	              int nq, int f_pct)
 	{
-		uint32_t v;
+		typename hashtable::value_type v;
 		uint64_t fails = 0;
 		int j = keys.size()-1;
 
@@ -116,7 +81,8 @@ class one_rb_querytester {
 	}
 
 	void querytimer(hashtable *ht, vector<uint32_t> *keys,
-			vector<duration<double>> *d, int nq, int f_pct)
+			vector<duration<double>> *d, sw_counts *sw,
+			int nq, int f_pct)
 	{
 		time_point<steady_clock> start, end;
 		uniform_int_distribution<uint32_t> data(0,UINT32_MAX);
@@ -144,6 +110,7 @@ class one_rb_querytester {
 			//cout << ".." << std::flush;
 
 			d->push_back(end - start);
+			sw->add(*ht);
 			ht->reset_perf_counts();
 		}
 		cout << std::flush;
@@ -187,7 +154,8 @@ class one_rb_querytester {
 				if (x == magic_x) ht.rebuild();
 
 				vector <duration<double>> times;
-				querytimer(&ht, &keys, &times,
+				sw_counts sw;
+				querytimer(&ht, &keys, &times, &sw,
 				           nqueries, fail_pct);
 
 				query_stats_t q {
@@ -202,6 +170,16 @@ class one_rb_querytester {
 				};
 
 				querystats.push_back(q);
+
+				result_record r("one_rb_query");
+				r.describe(ht).times(times);
+				r.x = x;
+				r.op = "query";
+				r.ops = nqueries;
+				r.extra["fail_pct"] = fail_pct;
+				r.extra["magic_x"] = magic_x;
+				r.sw = sw;
+				rows.push_back(r);
 			}
 		}
 	}
@@ -215,6 +193,8 @@ class one_rb_querytester {
 		run_test();
 	}
 
+	const std::vector<result_record>& results() const { return rows; }
+
 	friend
 	std::ostream& operator<<(std::ostream& os, one_rb_querytester const& h) {
 		return h.dump_query_stats(os);
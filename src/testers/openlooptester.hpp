@@ -0,0 +1,274 @@
+#ifndef OPENLOOPTESTER_HPP
+#define OPENLOOPTESTER_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+#include "latency.h"
+#include "keygen.h"
+#include "filltable.hpp"
+#include "results.h"
+
+using std::cout;
+
+// open-loop load: operations arrive on a schedule (Poisson arrivals at
+// the offered rate) whether or not the table has finished the previous
+// one, and response time is measured from the intended start.  a rebuild
+// that stalls the table for 1ms therefore shows up in every operation
+// that queued behind it, not just the one that triggered it, which a
+// closed-loop tester hides (coordinated omission).
+//
+// the offered rate is swept over 'rates', then bisected between the last
+// rate that met the p99 SLO and the first that didn't.  the table is held
+// at load factor 1-1/x by an equal insert/remove mix plus query_pct%
+// queries.
+
+template <typename hashtable>
+class openlooptester {
+	private:
+	std::string type;
+	pcg64 &rng;
+	int x;
+	uint64_t b;
+	const std::vector<double> &rates;       // offered ops/sec
+	int nops;
+	double slo;                             // p99 target, ns
+	int bisect_steps;
+	int query_pct;
+
+	struct openloop_stats_t {
+		double offered;         // ops/sec
+		double achieved;
+		double p50, p99, p999, max;     // response time, ns
+		uint64_t rebuilds;
+		bool pass;
+	};
+	std::vector<openloop_stats_t> stats;
+	std::vector<result_record> rows;
+	double sustainable;
+	double alpha;
+	std::size_t n;
+
+	enum op { INS, REM, QRY };
+
+	void
+	gen_testset(std::vector<uint32_t>* loadset, uint32_t n)
+	{
+		n += nops * (rates.size() + bisect_steps);
+		cout << "Generate testset, size " << n << "..." << std::flush;
+		loadset->resize(n);
+		keygen(rng).fill(loadset->data(), 0, n);
+		cout << "done\n";
+	}
+
+	void
+	loadtable(hashtable *ht, std::vector<uint32_t> *loadset,
+	          std::vector<uint32_t> *inserted, double lf)
+	{
+		auto next = [loadset] {
+			uint32_t k = loadset->back();
+			loadset->pop_back();
+			return k;
+		};
+		fill_table(ht, lf, next, inserted, rebuild_on_load<hashtable>);
+	}
+
+	// issue nops operations at 'rate' ops/sec
+	openloop_stats_t
+	run_rate(hashtable *ht, std::vector<uint32_t> *testset,
+	         std::vector<uint32_t> *inserted, double rate)
+	{
+		using res = hashtable::result;
+		typename hashtable::value_type v;
+		latency_histogram h;
+		std::vector<uint8_t> opset;
+		std::vector<uint64_t> arrival;
+		double tpn = ticks_per_ns();
+
+		int nq = (int64_t)nops * query_pct / 100;
+		for (int i = 0; i < nops - nq; ++i) opset.push_back(i & 1);
+		for (int i = 0; i < nq; ++i) opset.push_back(QRY);
+		std::shuffle(std::begin(opset), std::end(opset), rng);
+
+		// intended start times, in ticks from the start of the run
+		std::exponential_distribution<double> gap(rate / 1e9);
+		arrival.reserve(nops);
+		double t = 0;
+		for (int i = 0; i < nops; ++i) {
+			t += gap(rng) * tpn;
+			arrival.push_back(t);
+		}
+
+		ht->rebuild();  // start from a "good" state
+		ht->reset_perf_counts();
+		uint64_t start = ticks(), now = start;
+		uint64_t rebuilds = 0;
+
+		for (int i = 0; i < nops; ++i) {
+			uint64_t intended = start + arrival[i];
+			while (now < intended) now = ticks();
+
+			uint32_t k;
+			std::size_t j = 0;
+			if (opset[i] == INS) {
+				k = testset->back();
+				testset->pop_back();
+			} else {
+				std::uniform_int_distribution<std::size_t>
+					p(0, inserted->size()-1);
+				j = p(rng);
+				k = (*inserted)[j];
+			}
+
+			res r;
+			if (opset[i] == INS) {
+				r = ht->insert(k, k>>2);
+			} else if (opset[i] == REM) {
+				r = ht->remove(k);
+			} else {
+				ht->query(k, &v);
+				r = res::SUCCESS;
+			}
+			if (r == res::REBUILD) {
+				ht->rebuild();
+				++rebuilds;
+			}
+			now = ticks();
+
+			h.add(now - intended);
+
+			if (opset[i] == INS) {
+				inserted->push_back(k);
+			} else if (opset[i] == REM && r != res::FAILURE) {
+				std::swap((*inserted)[j], inserted->back());
+				inserted->pop_back();
+			}
+		}
+
+		double p99 = h.percentile(0.99) / tpn;
+		openloop_stats_t q {
+			.offered  = rate,
+			.achieved = nops / ((now - start) / tpn / 1e9),
+			.p50      = h.percentile(0.5) / tpn,
+			.p99      = p99,
+			.p999     = h.percentile(0.999) / tpn,
+			.max      = h.max_value / tpn,
+			.rebuilds = rebuilds,
+			.pass     = p99 <= slo,
+		};
+
+		result_record rec("openloop");
+		rec.describe(*ht);
+		rec.trials = { (now - start) / tpn / 1e9 };
+		rec.x = x;
+		rec.op = "mixed";
+		rec.ops = nops;
+		rec.extra["query_pct"] = query_pct;
+		rec.extra["offered"] = q.offered;
+		rec.extra["achieved"] = q.achieved;
+		rec.extra["p50_ns"] = q.p50;
+		rec.extra["p99_ns"] = q.p99;
+		rec.extra["p999_ns"] = q.p999;
+		rec.extra["max_ns"] = q.max;
+		rec.extra["slo_ns"] = slo;
+		rec.extra["pass"] = q.pass;
+		rec.extra["rebuilds"] = q.rebuilds;
+		rec.sw.add(*ht);
+		rows.push_back(rec);
+
+		cout << "  " << rate << " ops/s: p99 " << p99 << "ns"
+		     << (q.pass ? "" : " (SLO missed)") << "\n";
+		return q;
+	}
+
+	std::ostream& dump_openloop_stats(std::ostream &o = std::cout) const
+	{
+		o << "\n----- " << type << ", x=" << x << ", n=" << n
+		  << ", lf=" << alpha << ", p99 SLO=" << slo << "ns"
+		  << " --------------------------------\n";
+		o << "offered, achieved, p50, p99, p99.9, max, rebuilds, pass\n";
+
+		for (openloop_stats_t q : stats) {
+			o << q.offered << ", "
+			  << q.achieved << ", "
+			  << q.p50 << ", "
+			  << q.p99 << ", "
+			  << q.p999 << ", "
+			  << q.max << ", "
+			  << q.rebuilds << ", "
+			  << q.pass << '\n';
+		}
+		o << "sustainable ops/sec at SLO: " << sustainable << '\n';
+
+		return o;
+	}
+
+	void run_test()
+	{
+		std::vector <uint32_t> testset, inserted;
+		hashtable ht(next_prime(b));
+		type = ht.table_type();
+		n = ht.table_size();
+
+		gen_testset(&testset, ht.table_size());
+		inserted.reserve(ht.table_size());
+		ht.set_max_load_factor(1.0);
+		loadtable(&ht, &testset, &inserted, 1.0 - 1.0/x);
+		alpha = ht.load_factor();
+
+		cout << type << " " << n << ", x=" << x << "\n";
+
+		double lo = 0, hi = 0;
+		for (double r : rates) {
+			stats.push_back(run_rate(&ht, &testset, &inserted, r));
+			if (!stats.back().pass) {
+				hi = r;
+				break;
+			}
+			lo = r;
+		}
+
+		// the SLO was missed somewhere in (lo, hi]: narrow it down
+		for (int i = 0; hi && i < bisect_steps; ++i) {
+			double mid = lo ? (lo + hi) / 2 : hi / 2;
+			stats.push_back(run_rate(&ht, &testset, &inserted, mid));
+			if (stats.back().pass)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		sustainable = lo;
+		for (auto &r : rows)
+			r.extra["sustainable"] = sustainable;
+
+		std::sort(stats.begin(), stats.end(),
+		          [](const openloop_stats_t &a,
+		             const openloop_stats_t &b)
+		          { return a.offered < b.offered; });
+	}
+
+	public:
+	openlooptester(pcg64 &r, int x, uint64_t b,
+	               std::vector<double> const &rt, int no, double slo,
+	               int bs = 6, int qp = 50)
+	              : rng(r), x(x), b(b), rates(rt), nops(no), slo(slo),
+	                bisect_steps(bs), query_pct(qp) {
+		run_test();
+	}
+
+	double sustainable_rate() const { return sustainable; }
+	const std::vector<result_record>& results() const { return rows; }
+
+	friend std::ostream&
+	operator<<(std::ostream& os, openlooptester const& h) {
+		return h.dump_openloop_stats(os);
+	}
+};
+
+#endif
@@ -10,10 +10,16 @@
 #include <vector>
 #include <random>
 #include <chrono>
+#include <numeric>
 
 #include "pcg_random.hpp"
 #include "primes.h"
 #include "linear.h"
+#include "perfcounters.h"
+#include "results.h"
+#include "measure.h"
+#include "workload.h"
+#include "filltable.hpp"
 
 using std::chrono::duration;
 using std::chrono::steady_clock;
@@ -32,6 +38,12 @@ class querytester {
 	int nqueries;
 	int ntests;
 	int fail_pct;
+	perfcounters hw;
+	measure m;
+	workload wl;
+	keyset keysrc;          // keys to insert
+	uint64_t next_key;
+	picker access;          // which stored keys get queried
 
 	struct query_stats_t {
 		int nqueries;
@@ -39,65 +51,28 @@ class querytester {
 		std::vector<duration<double> > query_time;
 		double mean_query_time;
 		double median_query_time;
+		interval mean_ci;
+		interval median_ci;
+		int outliers;
 		double alpha;
 		int x;
 		std::size_t n;
+		hw_counts hw;           // summed over all trials
 	};
 
 	std::vector<query_stats_t> querystats;
+	std::vector<result_record> rows;
 
 	void loadtable(hashtable *ht, std::vector<uint32_t> *keys, double lf)
 	{
-		double start = ht->load_factor();
-		int interval = (lf - ht->load_factor()) * ht->table_size() / 20;
-		int stat_timer = interval;
-		uint32_t k;
-
-		uniform_int_distribution<uint32_t> data(0,UINT32_MAX);
-		cout << "Loading: " << ht->load_factor() << " -> "
-		     << lf << " [      %]";
-
-		std::ios old(nullptr);
-		old.copyfmt(cout);
-		while(ht->load_factor() < lf) {
-			k = data(rng);
-			using result = hashtable::result;
-			result r = ht->insert(k, k>>1);
-			switch(r) {
-			case result::SUCCESS:
-				keys->push_back(k);
-				break;
-			case result::REBUILD:
-				keys->push_back(k);
-				cout << " REBUILD" << std::flush;
-				ht->rebuild();
-				cout << "\b\b\b\b\b\b\b\b" << std::flush;
-				break;
-			case result::FULLTABLE: // this should never happen
-				std::cerr << "Table full!\n";
-				return;
-			default:
-				break;
-			}
-
-			if (--stat_timer == 0) {
-				stat_timer = interval;
-				cout << "\b\b\b\b\b\b\b\b"
-				     << std::setw(6) << std::fixed
-				     << std::setprecision(2)
-				     << 100 * (ht->load_factor() - start)
-				        / (lf - start)
-				     << "%]" << std::flush;
-			}
-		}
-		cout.copyfmt(old);
-		cout << "\b\b\b\b\b\b\b\bdone]         \n";
+		fill_table(ht, lf, [this] { return keysrc(next_key++); }, keys,
+		           rebuild_on_load<hashtable>);
 	}
 
 	void querying(hashtable *ht, const std::vector<uint32_t> &keys,
 	              int nq, int f_pct)
 	{
-		int v;
+		typename hashtable::value_type v;
 		uint64_t fails = 0;
 		int j = keys.size()-1;
 
@@ -117,35 +92,69 @@ class querytester {
 		}
 	}
 
-	void querytimer(hashtable *ht, vector<uint32_t> *keys,
-			vector<duration<double>> *d, int nq, int f_pct)
+	void querytimer(hashtable *ht, const vector<uint32_t> &keys,
+			vector<duration<double>> *d, hw_counts *h,
+			sw_counts *sw, int nq, int f_pct)
 	{
 		time_point<steady_clock> start, end;
 		uniform_int_distribution<uint32_t> data(0,UINT32_MAX);
+		const bool skewed = wl.access != accessdist::UNIFORM;
+		const std::size_t nmiss = keys.size()*f_pct/100.0;
 
-		std::shuffle(std::begin(*keys), std::end(*keys), rng);
-		// miss test: replace some of the stored keys with random keys
-		if (f_pct > 0) 
-			for (size_t i=0; i<keys->size()*f_pct/100.0; ++i) {
-				keys->pop_back();
-				keys->push_back(data(rng));
+		// uniform access queries a shuffled copy of the stored keys,
+		// reshuffled every trial.  the skewed pickers rank the keys
+		// by insertion order (LATEST's hottest is the last one in),
+		// so they pick from an unshuffled copy, the same every trial
+		// so the hot set stays put.  for the miss test, some of the
+		// keys in either are replaced with random keys.
+		vector<uint32_t> qkeys = keys;
+		if (skewed) {
+			vector<uint32_t> idx(qkeys.size());
+			std::iota(idx.begin(), idx.end(), 0);
+			for (std::size_t i = 0; i < nmiss; ++i) {
+				std::swap(idx[i], idx[i + uniform_int_distribution
+				          <std::size_t>(0, idx.size()-1-i)(rng)]);
+				qkeys[idx[i]] = data(rng);
 			}
-		ht->reset_perf_counts();
+		} else {
+			std::shuffle(std::begin(qkeys), std::end(qkeys), rng);
+			for (std::size_t i = 0; i < nmiss; ++i) {
+				qkeys.pop_back();
+				qkeys.push_back(data(rng));
+			}
+		}
 		ht->rebuild();
+		m.warmup([&] { querying(ht, qkeys, nq, f_pct); });
+		ht->reset_perf_counts();
 
 		for (int i=0; i<ntests; ++i) {
-			std::shuffle(std::begin(*keys), std::end(*keys), rng);
 			//cout << i+1 << std::flush;
 
+			// skewed access: pick the nq keys up front so the
+			// picker stays out of the timed section
+			vector<uint32_t> picked;
+			if (skewed)
+				for (int j = 0; j < nq; ++j)
+					picked.push_back(
+					    qkeys[access(rng, qkeys.size())]);
+			else
+				std::shuffle(std::begin(qkeys), std::end(qkeys),
+				             rng);
+
 			// timed section: 'nq' queries
+			m.prepare();
+			hw.start();
 			start = steady_clock::now();
-			querying(ht, *keys, nq, f_pct);
+			querying(ht, skewed ? picked : qkeys, nq, f_pct);
 			end = steady_clock::now();
+			hw.stop();
 			// end timed section
+			*h += hw.read();
 
 			//cout << ".." << std::flush;
 
 			d->push_back(end - start);
+			sw->add(*ht);
 			ht->reset_perf_counts();
 		}
 		cout << std::flush;
@@ -156,7 +165,11 @@ class querytester {
 		o << "\n----- " << type
 		  << " -------------------------------\n";
 		o << "Queries/trial, Fail%, Trial times, "
-			"Mean, Median, Loadfactor, x, n\n";
+			"Mean, Median, Loadfactor, x, n, "
+			"Mean CI, Median CI, Outliers";
+		if (hw.available())
+			hw_counts::csv_header(o << ", ", "/query");
+		o << '\n';
 		for (query_stats_t q : querystats) {
 			o << q.nqueries << ", "
 			  << q.failrate << ", "
@@ -165,13 +178,20 @@ class querytester {
 			  << q.median_query_time << ", "
 			  << q.alpha << ", "
 			  << q.x << ", "
-			  << q.n << '\n';
+			  << q.n << ", "
+			  << q.mean_ci << ", "
+			  << q.median_ci << ", "
+			  << q.outliers;
+			if (hw.available())
+				q.hw.csv(o << ", ", (double)q.nqueries * ntests);
+			o << '\n';
 		}
 		return o;
 	}
 
 	void run_test()
 	{
+		m.setup();
 		for (auto b : bs) {
 			hashtable ht(next_prime(b));
 			type = ht.table_type();
@@ -188,7 +208,9 @@ class querytester {
 				loadtable(&ht, &keys, lf);
 
 				vector <duration<double>> times;
-				querytimer(&ht, &keys, &times,
+				hw_counts h;
+				sw_counts sw;
+				querytimer(&ht, keys, &times, &h, &sw,
 				           nqueries, fail_pct);
 
 				std::map<int,int> sdhist;
@@ -200,24 +222,48 @@ class querytester {
 					.query_time          = times,
 					.mean_query_time     = mean(times),
 					.median_query_time   = median(times),
+					.mean_ci             = m.mean_ci(times),
+					.median_ci           = m.median_ci(times),
+					.outliers            = measure::outliers(times),
 					.alpha               = ht.load_factor(),
 					.x                   = x,
 					.n                   = ht.table_size(),
+					.hw                  = h,
 				};
 
 				querystats.push_back(q);
+
+				result_record r("query");
+				r.describe(ht).times(times);
+				r.x = x;
+				r.op = "query";
+				r.ops = nqueries;
+				r.extra["fail_pct"] = fail_pct;
+				r.extra["mean_ci_lo"] = q.mean_ci.lo;
+				r.extra["mean_ci_hi"] = q.mean_ci.hi;
+				r.extra["median_ci_lo"] = q.median_ci.lo;
+				r.extra["median_ci_hi"] = q.median_ci.hi;
+				r.extra["outliers"] = q.outliers;
+				r.sw = sw;
+				r.hw = h;
+				rows.push_back(r);
 			}
 		}
 	}
 
 	public:
 	querytester(pcg64 &r, std::vector<int> const &x,
-	            std::vector<uint64_t> const &b, int nq, int nt, int fp)
+	            std::vector<uint64_t> const &b, int nq, int nt, int fp,
+	            workload const &w = workload(),
+	            measure_options const &mo = measure_options())
 	           : rng(r), xs(x), bs(b), nqueries(nq), ntests(nt),
-	             fail_pct(fp) {
+	             fail_pct(fp), m(mo), wl(w), keysrc(w, r), next_key(0),
+	             access(w, *std::max_element(b.begin(), b.end())) {
 		run_test();
 	}
 
+	const std::vector<result_record>& results() const { return rows; }
+
 	friend
 	std::ostream& operator<<(std::ostream& os, querytester const& h) {
 		return h.dump_query_stats(os);
@@ -14,6 +14,9 @@
 #include "pcg_random.hpp"
 #include "primes.h"
 #include "graveyard.h"
+#include "perfcounters.h"
+#include "results.h"
+#include "filltable.hpp"
 
 using std::chrono::duration;
 using std::chrono::steady_clock;
@@ -29,6 +32,7 @@ class rebuildtester {
 	const std::vector<int> &xs;
 	const std::vector<uint64_t> &bs;
 	int ntests;
+	perfcounters hw;
 
 	struct rebuild_stats_t {
 		std::vector<int> rebuild_windows;
@@ -38,8 +42,10 @@ class rebuildtester {
 		double alpha;
 		int x;
 		std::size_t n;
+		hw_counts hw;           // summed over all rebuilds
 	};
 	std::vector<rebuild_stats_t> stats;
+	std::vector<result_record> rows;
 
 	inline void
 	loadrebuild(hashtable *ht)
@@ -52,36 +58,9 @@ class rebuildtester {
 	// maintain list of all keys inserted until target load factor reached
 	void loadtable(hashtable *ht, std::vector<uint32_t> *keys, double lf)
 	{
-		double start = ht->load_factor();
-		int interval = (lf - ht->load_factor()) * ht->table_size() / 20;
-		int stat_timer = interval;
-		uint64_t k;
-
 		uniform_int_distribution<uint64_t> data(0,UINT32_MAX);
-		cout << "Load: " << ht->load_factor() << " -> " << lf;
-
-		while(ht->load_factor() < lf) {
-			k = data(rng);
-			using result = hashtable::result;
-			result r = ht->insert(k, k/2);
-			if (r == result::SUCCESS) {
-				keys->push_back(k);
-			} else if (r == result::REBUILD) {
-				keys->push_back(k);
-				cout << "\rLoad rebuild" << std::flush;
-				loadrebuild(ht);
-			}
-
-			if (--stat_timer == 0) {
-				stat_timer = interval;
-				cout << "\r["
-				     << 100.0*(ht->load_factor() - start)
-				     / (lf - start)
-				     << "%]   " << std::flush;
-			}
-		}
-
-		cout << "\r[done]       ";
+		fill_table(ht, lf, [&] { return data(rng); }, keys,
+		           [this](hashtable *h) { loadrebuild(h); });
 	}
 
 	void
@@ -125,7 +104,8 @@ class rebuildtester {
 
 	void float_rebuild_timer(hashtable *ht, std::vector<uint32_t> *keys,
 				 std::vector<duration<double> > *rbtimes,
-				 std::vector<int> *rbwindows)
+				 std::vector<int> *rbwindows, hw_counts *h,
+				 sw_counts *sw)
 	{
 		time_point<steady_clock> start, end;
 		ht->rebuild();  // start from a "good" state
@@ -135,14 +115,19 @@ class rebuildtester {
 			rbwindows->push_back(ht->get_rebuild_window());
 
 			floating(ht, keys); // get to rebuild window
+			ht->reset_perf_counts();
 
 			// timing begins
+			hw.start();
 			start = steady_clock::now();
 			ht->rebuild();
 			end = steady_clock::now();
+			hw.stop();
 
 			rbtimes->push_back(end - start);
+			*h += hw.read();
 
+			sw->add(*ht);
 			ht->reset_perf_counts();
 		}
 		cout << std::endl;
@@ -152,7 +137,10 @@ class rebuildtester {
 	{
 		o << "\n----- " << type
 		  << " --------------------------------\n"
-		  << "Rb window, Rb times, Mean, Median, a, x, n\n";
+		  << "Rb window, Rb times, Mean, Median, a, x, n";
+		if (hw.available())
+			hw_counts::csv_header(o << ", ", "/rebuild");
+		o << '\n';
 
 		for (rebuild_stats_t q : stats) {
 			o << q.rebuild_windows << ", "
@@ -161,7 +149,10 @@ class rebuildtester {
 			  << q.median_rebuild_time << ", "
 			  << q.alpha << ", "
 			  << q.x << ", "
-			  << q.n << '\n';
+			  << q.n;
+			if (hw.available())
+				q.hw.csv(o << ", ", ntests);
+			o << '\n';
 		}
 
 		return o;
@@ -187,8 +178,10 @@ class rebuildtester {
 
 				vector <duration<double> > rb_times;
 				vector <int> rbwindows;
+				hw_counts h;
+				sw_counts sw;
 				float_rebuild_timer(&ht, &keys, &rb_times,
-				                    &rbwindows);
+				                    &rbwindows, &h, &sw);
 
 				rebuild_stats_t q {
 					.rebuild_windows     = rbwindows,
@@ -198,9 +191,23 @@ class rebuildtester {
 					.alpha               = ht.load_factor(),
 					.x                   = x,
 					.n                   = ht.table_size(),
+					.hw                  = h,
 				};
 
 				stats.push_back(q);
+
+				result_record r("rebuild");
+				r.describe(ht).times(rb_times);
+				r.x = x;
+				r.op = "rebuild";
+				r.ops = 1;
+				r.extra["rebuild_window"] =
+				    std::accumulate(rbwindows.begin(),
+				                    rbwindows.end(), 0.0)
+				    / std::max<std::size_t>(rbwindows.size(), 1);
+				r.sw = sw;
+				r.hw = h;
+				rows.push_back(r);
 			}
 		}
 	}
@@ -212,6 +219,8 @@ class rebuildtester {
 		run_test();
 	}
 
+	const std::vector<result_record>& results() const { return rows; }
+
 	friend std::ostream&
 	operator<<(std::ostream& os, rebuildtester const& h) {
 		return h.dump_rebuild_stats(os);
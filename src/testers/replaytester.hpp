@@ -0,0 +1,169 @@
+#ifndef REPLAYTESTER_HPP
+#define REPLAYTESTER_HPP
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "primes.h"
+#include "util.h"
+#include "trace.h"
+#include "results.h"
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+using std::chrono::time_point;
+using std::cout;
+
+// replay a recorded trace against a table type.
+//
+// the trace is decoded once into flat op/key/value arrays; each trial then
+// builds an empty table of the recorded size and runs the whole trace
+// through it, timed.  rebuilds are either the table's own (rebuild when an
+// op returns REBUILD, ignore the recorded ones), which is the fair A/B
+// between table types, or exactly the recorded ones.
+
+enum class replay_rebuilds { OWN, RECORDED };
+
+template <typename hashtable>
+class replaytester {
+	private:
+	std::string type;
+	std::string path;
+	replay_rebuilds mode;
+	int ntrials;
+
+	std::vector<uint8_t> ops;
+	std::vector<uint32_t> keys;
+	std::vector<uint32_t> values;
+	std::string recorded_type;
+	uint64_t buckets;
+
+	uint64_t opcount[4];
+	std::vector<duration<double>> times;
+	uint64_t failed;        // queries that missed, over all trials
+	uint64_t rejected;      // inserts and removes that failed, all trials
+	uint64_t rebuilds;      // over all trials
+	double lf;
+	std::vector<result_record> rows;
+
+	void replay(hashtable *ht)
+	{
+		using res = hashtable::result;
+		typename hashtable::value_type v;
+		const bool own = mode == replay_rebuilds::OWN;
+		res r;
+
+		for (std::size_t i = 0; i < ops.size(); ++i) {
+			switch (ops[i]) {
+			case trace::INSERT:
+				r = ht->insert(keys[i], values[i]);
+				break;
+			case trace::QUERY:
+				if (!ht->query(keys[i], &v)) ++failed;
+				continue;
+			case trace::REMOVE:
+				r = ht->remove(keys[i]);
+				break;
+			case trace::REBUILD:
+				if (!own) {
+					ht->rebuild();
+					++rebuilds;
+				}
+				continue;
+			default:
+				continue;
+			}
+
+			if (r == res::REBUILD) {
+				if (own) {
+					ht->rebuild();
+					++rebuilds;
+				}
+			} else if (r != res::SUCCESS) {
+				++rejected;
+			}
+		}
+	}
+
+	void run_test()
+	{
+		trace_reader tr;
+		if (!tr.open(path)) return;
+		recorded_type = tr.header().type;
+		buckets = tr.header().buckets;
+		tr.decode(&ops, &keys, &values);
+		tr.close();
+
+		for (uint8_t o : ops)
+			if (o < 4) ++opcount[o];
+
+		result_record r("replay");
+		for (int t = 0; t < ntrials; ++t) {
+			hashtable ht(next_prime(buckets));
+			type = ht.table_type();
+			ht.set_max_load_factor(1.0);
+
+			time_point<steady_clock> t1 = steady_clock::now();
+			replay(&ht);
+			time_point<steady_clock> t2 = steady_clock::now();
+
+			times.push_back(t2 - t1);
+			lf = ht.load_factor();
+			r.describe(ht);
+			r.sw.add(ht);
+		}
+
+		r.times(times);
+		r.op = "trace";
+		r.ops = ops.size();
+		r.extra["recorded_rebuilds"] = mode == replay_rebuilds::RECORDED;
+		r.extra["failed_queries"] = failed;
+		r.extra["rejected"] = rejected;
+		r.extra["rebuilds"] = rebuilds;
+		rows.push_back(r);
+	}
+
+	std::ostream& dump_replay_stats(std::ostream &o = std::cout) const
+	{
+		o << "\n----- " << type << " replaying " << path << " ("
+		  << recorded_type << ", n=" << buckets << "), "
+		  << (mode == replay_rebuilds::OWN ? "own" : "recorded")
+		  << " rebuilds --------------------------------\n";
+		if (times.empty()) {
+			o << "no trials\n";
+			return o;
+		}
+
+		o << "ops: " << ops.size() << " (insert " << opcount[0]
+		  << ", query " << opcount[1] << ", remove " << opcount[2]
+		  << ", rebuild " << opcount[3] << ")\n";
+		o << "over " << times.size() << " trials: failed queries: "
+		  << failed << ", rejected: " << rejected << ", rebuilds: "
+		  << rebuilds << "; final load factor: " << lf << "\n";
+
+		o << "trial times: " << times << "\n";
+		o << "mean: " << mean(times) << ", median: " << median(times)
+		  << ", ops/sec (median): " << ops.size() / median(times)
+		  << "\n";
+		return o;
+	}
+
+	public:
+	replaytester(const std::string &p, int n = 5,
+	             replay_rebuilds m = replay_rebuilds::OWN)
+	            : path(p), mode(m), ntrials(n), buckets(0), opcount{},
+	              failed(0), rejected(0), rebuilds(0), lf(0) {
+		run_test();
+	}
+
+	const std::vector<result_record>& results() const { return rows; }
+
+	friend std::ostream&
+	operator<<(std::ostream& os, replaytester const& h) {
+		return h.dump_replay_stats(os);
+	}
+};
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef YCSBTESTER_HPP
+#define YCSBTESTER_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "workload.h"
+#include "filltable.hpp"
+#include "results.h"
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+using std::chrono::time_point;
+using std::cout;
+
+// YCSB-style mixed workloads.
+//
+// the table is loaded with 'records' keys, then 'nops' operations are
+// drawn from the op mix, touching present keys through the workload's
+// picker, and throughput is reported for each of 'intervals' equal slices
+// of the run.  the tables have no update or range scan, so
+//   update  is a remove and re-insert of the key with a new value
+//   rmw     (read-modify-write) is a query followed by an update
+//   scan    queries the scan_len keys inserted after the picked one,
+//           i.e. a scan in key order as YCSB defines it, but by point
+//           lookups
+// an op that returns REBUILD rebuilds inline and is charged for it.
+
+struct opmix {
+	double read, update, insert, remove, scan, rmw;
+	int max_scan_len;       // scan lengths are uniform in [1, max]
+};
+
+struct ycsb_config {
+	std::string name;
+	opmix mix;
+	workload dist;
+};
+
+// the core YCSB workloads
+inline ycsb_config
+ycsb_preset(char w)
+{
+	const workload zipf { keydist::UNIFORM, 0, accessdist::ZIPFIAN, 0.99 };
+	const workload latest { keydist::UNIFORM, 0, accessdist::LATEST, 0 };
+
+	switch (w) {
+	case 'A': return { "A", { .5, .5, 0, 0, 0, 0, 0 }, zipf };
+	case 'B': return { "B", { .95, .05, 0, 0, 0, 0, 0 }, zipf };
+	case 'C': return { "C", { 1, 0, 0, 0, 0, 0, 0 }, zipf };
+	case 'D': return { "D", { .95, 0, .05, 0, 0, 0, 0 }, latest };
+	case 'E': return { "E", { 0, 0, .05, 0, .95, 0, 100 }, zipf };
+	case 'F': return { "F", { .5, 0, 0, 0, 0, .5, 0 }, zipf };
+	default:
+		std::cerr << "ycsb_preset: no workload " << w
+		          << ", using C\n";
+		return ycsb_preset('C');
+	}
+}
+
+template <typename hashtable>
+class ycsbtester {
+	private:
+	std::string type;
+	pcg64 &rng;
+	ycsb_config cfg;
+	uint64_t b;
+	uint64_t records;
+	uint64_t nops;
+	int intervals;
+
+	enum op { READ, UPDATE, INSERT, REMOVE, SCAN, RMW, NOPS };
+
+	struct interval_t {
+		uint64_t ops;
+		duration<double> time;
+		double lf;
+		uint64_t rebuilds;
+	};
+	std::vector<interval_t> stats;
+	std::vector<result_record> rows;
+	uint64_t opcount[NOPS];
+	uint64_t failed;
+
+	std::vector<uint8_t>
+	gen_opset()
+	{
+		const opmix &m = cfg.mix;
+		std::discrete_distribution<int> d({ m.read, m.update, m.insert,
+		                                    m.remove, m.scan, m.rmw });
+		std::vector<uint8_t> ops;
+		ops.reserve(nops);
+		for (uint64_t i = 0; i < nops; ++i)
+			ops.push_back(d(rng));
+		return ops;
+	}
+
+	// run ops[first, last), keeping *present in insertion order apart
+	// from removes, which swap the last key into the hole.  pick[] holds
+	// indices into *present, or for LATEST ages counted back from the
+	// newest key.  returns the rebuilds it ran
+	uint64_t
+	run_ops(hashtable *ht, const std::vector<uint8_t> &ops,
+	        uint64_t first, uint64_t last,
+	        const std::vector<uint32_t> &scanlen,
+	        const std::vector<std::size_t> &pick,
+	        keyset &keys, uint64_t *next_key,
+	        std::vector<uint32_t> *present)
+	{
+		using res = hashtable::result;
+		typename hashtable::value_type v;
+		uint64_t rebuilds = 0;
+
+		for (uint64_t i = first; i < last; ++i) {
+			// every op but an insert works on a present key
+			std::size_t n = present->size(), j = 0;
+			uint32_t k = 0;
+			if (ops[i] != INSERT) {
+				if (n == 0) continue;
+				if (cfg.dist.access == accessdist::LATEST)
+					j = n - 1 - std::min(pick[i], n - 1);
+				else
+					j = pick[i] % n;
+				k = (*present)[j];
+			}
+			res r = res::SUCCESS;
+
+			switch (ops[i]) {
+			case READ:
+				if (!ht->query(k, &v)) ++failed;
+				break;
+			case RMW:
+				if (!ht->query(k, &v)) ++failed;
+				[[fallthrough]];
+			case UPDATE:
+				if (ht->remove(k) == res::REBUILD) {
+					ht->rebuild();
+					++rebuilds;
+				}
+				r = ht->insert(k, (k>>2) + 1);
+				break;
+			case INSERT:
+				k = keys((*next_key)++);
+				r = ht->insert(k, k>>2);
+				present->push_back(k);
+				break;
+			case REMOVE:
+				r = ht->remove(k);
+				(*present)[j] = present->back();
+				present->pop_back();
+				break;
+			case SCAN:
+				for (uint32_t s = 0; s < scanlen[i]; ++s) {
+					k = (*present)[(j + s) % present->size()];
+					if (!ht->query(k, &v)) ++failed;
+				}
+				break;
+			}
+
+			if (r == res::REBUILD) {
+				ht->rebuild();
+				++rebuilds;
+			}
+		}
+		return rebuilds;
+	}
+
+	std::ostream& dump_ycsb_stats(std::ostream &o = std::cout) const
+	{
+		const char *names[] = { "read", "update", "insert", "remove",
+		                        "scan", "rmw" };
+		duration<double> total(0);
+		uint64_t ops = 0;
+
+		o << "\n----- " << type << ", workload " << cfg.name
+		  << " (" << cfg.dist.name() << "), records=" << records
+		  << ", n=" << b << " --------------------------------\n";
+		for (int i = 0; i < NOPS; ++i)
+			if (opcount[i]) o << names[i] << ": " << opcount[i] << " ";
+		o << "failed: " << failed << "\n";
+		o << "interval, ops, time, ops/sec, loadfactor, rebuilds\n";
+
+		for (std::size_t i = 0; i < stats.size(); ++i) {
+			const interval_t &q = stats[i];
+			o << i << ", "
+			  << q.ops << ", "
+			  << q.time.count() << ", "
+			  << q.ops / q.time.count() << ", "
+			  << q.lf << ", "
+			  << q.rebuilds << '\n';
+			total += q.time;
+			ops += q.ops;
+		}
+		o << "total, " << ops << ", " << total.count() << ", "
+		  << ops / total.count() << "\n";
+
+		return o;
+	}
+
+	void run_test()
+	{
+		std::vector<uint32_t> present;
+		uint64_t next_key = 0;
+		hashtable ht(next_prime(b));
+		keyset keys(cfg.dist, rng);
+
+		type = ht.table_type();
+		b = ht.table_size();
+		ht.set_max_load_factor(1.0);
+		present.reserve(records + nops * cfg.mix.insert * 2);
+
+		cout << type << ", workload " << cfg.name << "\n";
+		if (!fill_table(&ht, (double)records / b,
+		                [&] { return keys(next_key++); }, &present,
+		                rebuild_on_load<hashtable>)) {
+			std::cerr << type << ": couldn't load " << records
+			          << " records, workload " << cfg.name
+			          << " not run\n";
+			return;
+		}
+
+		// draw everything random up front to keep it out of the
+		// timed sections
+		std::vector<uint8_t> ops = gen_opset();
+		std::vector<uint32_t> scanlen(nops, 0);
+		std::vector<std::size_t> pick;
+		std::uniform_int_distribution<uint32_t>
+			len(1, std::max(cfg.mix.max_scan_len, 1));
+		picker access(cfg.dist, present.size());
+		pick.reserve(nops);
+		for (uint64_t i = 0; i < nops; ++i) {
+			std::size_t p = access(rng, present.size());
+			if (cfg.dist.access == accessdist::LATEST)
+				p = present.size() - 1 - p;
+			pick.push_back(p);
+			if (ops[i] == SCAN) scanlen[i] = len(rng);
+			++opcount[ops[i]];
+		}
+
+		ht.rebuild();
+		ht.reset_perf_counts();
+		for (int s = 0; s < intervals; ++s) {
+			uint64_t first = nops * s / intervals;
+			uint64_t last = nops * (s+1) / intervals;
+			time_point<steady_clock> t1 = steady_clock::now();
+			uint64_t rebuilds = run_ops(&ht, ops, first, last,
+			                            scanlen, pick, keys,
+			                            &next_key, &present);
+			time_point<steady_clock> t2 = steady_clock::now();
+
+			stats.push_back({ last - first, t2 - t1,
+			                  ht.load_factor(), rebuilds });
+
+			result_record r("ycsb");
+			r.describe(ht);
+			r.trials = { duration<double>(t2 - t1).count() };
+			r.x = 1.0 / (1.0 - (double)records / b);
+			r.op = "ycsb_" + cfg.name;
+			r.ops = last - first;
+			r.extra["interval"] = s;
+			r.extra["records"] = records;
+			r.extra["rebuilds"] = rebuilds;
+			r.sw.add(ht);
+			rows.push_back(r);
+			ht.reset_perf_counts();
+		}
+	}
+
+	public:
+	ycsbtester(pcg64 &r, ycsb_config const &c, uint64_t b,
+	           uint64_t recs, uint64_t no, int iv = 10)
+	          : rng(r), cfg(c), b(b), records(recs), nops(no),
+	            intervals(iv), opcount{}, failed(0) {
+		run_test();
+	}
+
+	const std::vector<result_record>& results() const { return rows; }
+
+	friend std::ostream&
+	operator<<(std::ostream& os, ycsbtester const& h) {
+		return h.dump_ycsb_stats(os);
+	}
+};
+
+#endif
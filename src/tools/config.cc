@@ -0,0 +1,190 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include "config.h"
+
+static std::string
+trim(const std::string &s)
+{
+	std::size_t b = s.find_first_not_of(" \t\r\n");
+	if (b == std::string::npos) return "";
+	std::size_t e = s.find_last_not_of(" \t\r\n");
+	return s.substr(b, e - b + 1);
+}
+
+static std::vector<std::string>
+split(const std::string &s, char sep)
+{
+	std::vector<std::string> v;
+	std::stringstream ss(s);
+	std::string item;
+	while (std::getline(ss, item, sep))
+		if (!trim(item).empty()) v.push_back(trim(item));
+	return v;
+}
+
+// a number with optional digit separators and k/M/G suffix; anything
+// else says so and counts an error
+static double
+parse_number(const std::string &s, const std::string &key, int *errors)
+{
+	std::string t;
+	for (char c : s)
+		if (c != '\'' && c != '_') t += c;
+
+	char *end;
+	double d = strtod(t.c_str(), &end);
+	switch (*end) {
+	case 'k': case 'K': d *= 1e3; ++end; break;
+	case 'm': case 'M': d *= 1e6; ++end; break;
+	case 'g': case 'G': d *= 1e9; ++end; break;
+	}
+	if (end == t.c_str() || *end) {
+		std::cerr << "config: " << key << ": bad number '" << s << "'\n";
+		++*errors;
+	}
+	return d;
+}
+
+bool
+config::set(const std::string &line, const std::string &where)
+{
+	std::size_t eq = line.find('=');
+	if (eq == std::string::npos) {
+		std::cerr << where << ": expected key = value\n";
+		return false;
+	}
+	std::string k = trim(line.substr(0, eq));
+	while (!k.empty() && k[0] == '-')
+		k.erase(0, 1);
+	if (k == "config")
+		return load(trim(line.substr(eq + 1)));
+	vals[k] = trim(line.substr(eq + 1));
+	return true;
+}
+
+bool
+config::load(const std::string &path)
+{
+	std::ifstream f(path);
+	if (!f) {
+		std::cerr << "config: couldn't open " << path << "\n";
+		return false;
+	}
+
+	std::string line;
+	bool ok = true;
+	for (int n = 1; std::getline(f, line); ++n) {
+		line = trim(line.substr(0, line.find('#')));
+		if (line.empty()) continue;
+		ok &= set(line, path + ":" + std::to_string(n));
+	}
+	return ok;
+}
+
+bool
+config::parse_args(int argc, char **argv)
+{
+	bool ok = true;
+	for (int i = 1; i < argc; ++i)
+		ok &= set(argv[i], std::string("argument ") + argv[i]);
+	return ok;
+}
+
+std::string
+config::get(const std::string &k, const std::string &def) const
+{
+	used.insert(k);
+	auto it = vals.find(k);
+	return it == vals.end() ? def : it->second;
+}
+
+int64_t
+config::get_int(const std::string &k, int64_t def) const
+{
+	std::string v = get(k, "");
+	return v.empty() ? def : (int64_t)parse_number(v, k, &errors);
+}
+
+double
+config::get_double(const std::string &k, double def) const
+{
+	std::string v = get(k, "");
+	return v.empty() ? def : parse_number(v, k, &errors);
+}
+
+bool
+config::get_bool(const std::string &k, bool def) const
+{
+	std::string v = get(k, def ? "true" : "false");
+	if (v == "true" || v == "yes" || v == "on" || v == "1")
+		return true;
+	if (v == "false" || v == "no" || v == "off" || v == "0")
+		return false;
+	std::cerr << "config: " << k << ": bad boolean '" << v
+	          << "' (true/false, yes/no, on/off or 1/0)\n";
+	++errors;
+	return def;
+}
+
+std::vector<std::string>
+config::get_strings(const std::string &k, const std::string &def) const
+{
+	return split(get(k, def), ',');
+}
+
+std::vector<double>
+config::get_doubles(const std::string &k, const std::string &def) const
+{
+	std::vector<double> v;
+	for (auto &s : get_strings(k, def))
+		v.push_back(parse_number(s, k, &errors));
+	return v;
+}
+
+std::vector<int64_t>
+config::get_ints(const std::string &k, const std::string &def) const
+{
+	std::vector<int64_t> v;
+	for (auto &s : get_strings(k, def)) {
+		// a-b or a-b:step; a leading '-' is a sign, not a range
+		std::size_t dash = s.find('-', 1);
+		if (dash == std::string::npos) {
+			v.push_back(parse_number(s, k, &errors));
+			continue;
+		}
+		std::size_t colon = s.find(':', dash);
+		int64_t a = parse_number(s.substr(0, dash), k, &errors);
+		int64_t b = parse_number(s.substr(dash + 1, colon - dash - 1),
+		                         k, &errors);
+		int64_t step = colon == std::string::npos ? 1 :
+		               parse_number(s.substr(colon + 1), k, &errors);
+		if (step <= 0) {
+			std::cerr << "config: " << k << ": bad step in " << s
+			          << "\n";
+			++errors;
+			continue;
+		}
+		for (int64_t x = a; x <= b; x += step)
+			v.push_back(x);
+	}
+	return v;
+}
+
+std::vector<std::string>
+config::unused() const
+{
+	std::vector<std::string> v;
+	for (auto &kv : vals)
+		if (!used.count(kv.first)) v.push_back(kv.first);
+	return v;
+}
+
+std::ostream&
+operator<<(std::ostream &o, const config &c)
+{
+	for (auto &kv : c.vals)
+		o << kv.first << " = " << kv.second << "\n";
+	return o;
+}
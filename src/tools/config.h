@@ -0,0 +1,56 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+// benchmark parameters from a config file and the command line.
+//
+// a config file has one "key = value" per line; '#' starts a comment.
+// arguments are key=value (or --key=value) and override the file; the
+// argument config=<path> loads a file at that point.  numbers may use '
+// or _ as separators and a k/M/G suffix (10M = 10'000'000).  lists are
+// comma separated and may contain ranges, "a-b" or "a-b:step", so
+// x = 2-10,20-100:10,200 is a valid x list.
+//
+// every get marks its key used; unused() lists the keys nothing asked
+// for, i.e. most likely typos.  a value that doesn't parse (a bad
+// number, range step or boolean) is reported and counted as an error;
+// ok() is false after any, and the benches exit on it.
+
+class config {
+	private:
+	std::map<std::string, std::string> vals;
+	mutable std::set<std::string> used;
+	mutable int errors = 0;
+
+	bool set(const std::string &line, const std::string &where);
+
+	public:
+	bool load(const std::string &path);
+	bool parse_args(int argc, char **argv);
+
+	bool has(const std::string &k) const { return vals.count(k); }
+	bool ok() const { return !errors; }
+
+	std::string get(const std::string &k, const std::string &def) const;
+	int64_t get_int(const std::string &k, int64_t def) const;
+	double get_double(const std::string &k, double def) const;
+	bool get_bool(const std::string &k, bool def) const;
+	std::vector<std::string> get_strings(const std::string &k,
+	                                     const std::string &def) const;
+	std::vector<int64_t> get_ints(const std::string &k,
+	                              const std::string &def) const;
+	std::vector<double> get_doubles(const std::string &k,
+	                                const std::string &def) const;
+
+	std::vector<std::string> unused() const;
+
+	friend std::ostream& operator<<(std::ostream &o, const config &c);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "keygen.h"
+
+keygen::keygen(uint64_t seed, int bits)
+{
+	if (bits < 2 || bits > 64 || bits & 1) {
+		std::cerr << "keygen: bits must be even and in [2,64], using 32\n";
+		bits = 32;
+	}
+	half = bits / 2;
+	mask = (1ull << half) - 1;
+	set_keys(seed);
+}
+
+keygen::keygen(pcg64 &rng, int bits) : keygen(rng(), bits) {}
+
+void
+keygen::set_keys(uint64_t seed)
+{
+	// splitmix64 to spread one seed over the round keys
+	for (int j = 0; j < rounds; ++j) {
+		seed += 0x9e3779b97f4a7c15ULL;
+		rk[j] = mix(seed);
+	}
+}
+
+uint64_t
+keygen::index(uint64_t key) const
+{
+	uint64_t l = (key >> half) & mask, r = key & mask;
+	for (int j = rounds-1; j >= 0; --j) {
+		uint64_t t = l;
+		l = r ^ (mix(l ^ rk[j]) & mask);
+		r = t;
+	}
+	return (l << half) | r;
+}
+
+template <typename T>
+static void
+fill_range(const keygen &g, T *out, uint64_t first, std::size_t n,
+           unsigned threads)
+{
+	if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+	// not worth a thread for less than a million keys
+	threads = std::min<std::size_t>(threads, n / (1 << 20) + 1);
+
+	std::vector<std::thread> workers;
+	std::size_t chunk = (n + threads - 1) / threads;
+	for (unsigned t = 0; t < threads; ++t) {
+		std::size_t lo = t * chunk, hi = std::min(n, lo + chunk);
+		if (lo >= hi) break;
+		workers.emplace_back([&g, out, first, lo, hi] {
+			for (std::size_t j = lo; j < hi; ++j)
+				out[j] = g(first + j);
+		});
+	}
+	for (auto &w : workers) w.join();
+}
+
+void
+keygen::fill(uint32_t *out, uint64_t first, std::size_t n,
+             unsigned threads) const
+{
+	fill_range(*this, out, first, n, threads);
+}
+
+void
+keygen::fill(uint64_t *out, uint64_t first, std::size_t n,
+             unsigned threads) const
+{
+	fill_range(*this, out, first, n, threads);
+}
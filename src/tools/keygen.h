@@ -0,0 +1,63 @@
+#ifndef KEYGEN_H
+#define KEYGEN_H
+
+#include <cstdint>
+#include <cstddef>
+#include "pcg_random.hpp"
+
+// unique keys without storing them.
+//
+// a keyed Feistel network is a bijection on [0, 2^bits), so key(i) for
+// i = 0, 1, 2, ... never repeats and looks uniformly random.  the i-th key
+// is computed directly from i: no shuffle, O(1) memory, random access (a
+// tester that inserted keys 0..n-1 can query or remove a present key by
+// drawing an index), and any range of indices can be generated in
+// parallel.  index() inverts the permutation.
+
+class keygen {
+	private:
+	static const int rounds = 4;
+	uint64_t rk[rounds];            // round keys
+	int half;                       // bits per Feistel half
+	uint64_t mask;
+
+	static inline uint64_t mix(uint64_t x) {
+		// murmur3 64-bit finalizer
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ULL;
+		x ^= x >> 33;
+		return x;
+	}
+
+	void set_keys(uint64_t seed);
+
+	public:
+	// bits is the width of the key space, even, 2..64
+	keygen(uint64_t seed, int bits = 32);
+	keygen(pcg64 &rng, int bits = 32);
+
+	inline uint64_t operator()(uint64_t i) const {
+		uint64_t l = (i >> half) & mask, r = i & mask;
+		for (int j = 0; j < rounds; ++j) {
+			uint64_t t = r;
+			r = l ^ (mix(r ^ rk[j]) & mask);
+			l = t;
+		}
+		return (l << half) | r;
+	}
+
+	uint64_t index(uint64_t key) const;
+
+	uint64_t space() const { return half == 32 ? 0 : 1ull << (2*half); }
+
+	// out[j] = key(first + j) for j < n, split over 'threads' threads
+	// (0: one per hardware thread)
+	void fill(uint32_t *out, uint64_t first, std::size_t n,
+	          unsigned threads = 0) const;
+	void fill(uint64_t *out, uint64_t first, std::size_t n,
+	          unsigned threads = 0) const;
+};
+
+#endif
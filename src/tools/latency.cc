@@ -0,0 +1,64 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include "latency.h"
+
+using std::chrono::steady_clock;
+
+// time a short spin against the steady clock, once
+double
+ticks_per_ns()
+{
+	static const double tpn = [] {
+		auto s = steady_clock::now();
+		uint64_t t0 = ticks();
+		while (steady_clock::now() - s < std::chrono::milliseconds(20))
+			;
+		uint64_t t1 = ticks();
+		auto e = steady_clock::now();
+
+		return (t1 - t0) / (double)std::chrono::duration_cast
+		       <std::chrono::nanoseconds>(e-s).count();
+	}();
+	return tpn;
+}
+
+uint64_t
+latency_histogram::upper(int i)
+{
+	if (i < (int)sub_count) return i;
+	int e = i / sub_count + sub_bits - 1;
+	uint64_t sub = i % sub_count + sub_count;
+	return ((sub + 1) << (e - sub_bits)) - 1;
+}
+
+void
+latency_histogram::reset()
+{
+	std::fill(counts.begin(), counts.end(), 0);
+	n = max_value = 0;
+	total = 0;
+}
+
+latency_histogram&
+latency_histogram::operator+=(const latency_histogram &h)
+{
+	for (std::size_t i = 0; i < counts.size(); ++i)
+		counts[i] += h.counts[i];
+	n += h.n;
+	total += h.total;
+	max_value = std::max(max_value, h.max_value);
+	return *this;
+}
+
+uint64_t
+latency_histogram::percentile(double p) const
+{
+	if (!n) return 0;
+	uint64_t seen = 0;
+	for (std::size_t i = 0; i < counts.size(); ++i) {
+		seen += counts[i];
+		if (seen >= p * n) return std::min(upper(i), max_value);
+	}
+	return max_value;
+}
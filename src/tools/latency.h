@@ -0,0 +1,72 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// per-operation latency measurement.
+//
+// ticks() is the cheapest timestamp available (the TSC on x86, a steady
+// clock elsewhere); ticks_per_ns() converts, calibrated once per process.
+// latency_histogram is an HDR-style histogram: values below 2^sub_bits
+// are recorded exactly, above that each power of two is split into
+// 2^sub_bits linear buckets, so every bucket is within ~3% of its values.
+
+inline uint64_t
+ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+	       std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+double ticks_per_ns();
+
+class latency_histogram {
+	private:
+	static const int sub_bits = 5;
+	static const uint64_t sub_count = 1 << sub_bits;
+	std::vector<uint64_t> counts;
+
+	static inline int index(uint64_t v) {
+		if (v < sub_count) return v;
+		int e = 63 - __builtin_clzll(v);     // e >= sub_bits
+		return (e - sub_bits + 1) * sub_count
+		       + ((v >> (e - sub_bits)) - sub_count);
+	}
+	static uint64_t upper(int i);   // largest value in bucket i
+
+	public:
+	uint64_t n, max_value;
+	double total;
+
+	latency_histogram()
+	    : counts((64 - sub_bits + 1) * sub_count, 0),
+	      n(0), max_value(0), total(0) {}
+
+	inline void add(uint64_t v) {
+		++counts[index(v)];
+		++n;
+		total += v;
+		if (v > max_value) max_value = v;
+	}
+
+	void reset();
+	latency_histogram& operator+=(const latency_histogram &h);
+
+	// smallest recorded bucket bound with at least p of the values at or
+	// below it, 0 <= p <= 1.  the max is exact
+	uint64_t percentile(double p) const;
+	double mean() const { return n ? total / n : 0; }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include "measure.h"
+#include "sweep.h"
+#include "util.h"
+
+using std::vector;
+
+measure::measure(const options &o) : opt(o)
+{
+}
+
+static std::string
+sysfs(const std::string &path)
+{
+	std::ifstream f(path);
+	std::string s;
+	f >> s;
+	return s;
+}
+
+void
+measure::setup() const
+{
+	if (opt.cpu >= 0 && !pin(opt.cpu))
+		std::cerr << "measure: couldn't pin to cpu " << opt.cpu << "\n";
+
+	static std::once_flag warned;
+	std::call_once(warned, [this] {
+		std::string cpu = "cpu" + std::to_string(std::max(opt.cpu, 0));
+		std::string gov = sysfs("/sys/devices/system/cpu/" + cpu +
+		                        "/cpufreq/scaling_governor");
+		if (!gov.empty() && gov != "performance")
+			std::cerr << "measure: " << cpu << " governor is " << gov
+			          << ", times will include clock ramping\n";
+		if (sysfs("/sys/devices/system/cpu/intel_pstate/no_turbo") == "0"
+		    || sysfs("/sys/devices/system/cpu/cpufreq/boost") == "1")
+			std::cerr << "measure: turbo is on, clock speed will vary "
+			             "with temperature\n";
+	});
+}
+
+bool
+measure::pin(int cpu)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// write a buffer twice the size of the last level cache, which pushes
+// out the table (and the TLB entries for it).  each thread has a buffer
+// of its own, so sweep workers don't race on one
+void
+measure::flush_caches()
+{
+	thread_local vector<char> buf(2 * sweep::llc_bytes());
+	thread_local char c;
+
+	++c;
+	for (std::size_t i = 0; i < buf.size(); i += 64)
+		buf[i] = c;
+	asm volatile("" : : "r"(buf.data()) : "memory");
+}
+
+vector<vector<measure::seconds>>
+measure::interleave(int nvariants, int ntrials, pcg64 &rng,
+                    std::function<seconds(int v, int i)> trial) const
+{
+	vector<vector<seconds>> d(nvariants);
+	vector<int> order(nvariants);
+	std::iota(order.begin(), order.end(), 0);
+
+	for (int v = 0; v < nvariants; ++v)
+		warmup([&] { trial(v, 0); });
+	for (int i = 0; i < ntrials; ++i) {
+		std::shuffle(order.begin(), order.end(), rng);
+		for (int v : order)
+			d[v].push_back(trial(v, i));
+	}
+	return d;
+}
+
+// P. J. Acklam's rational approximation of the normal quantile,
+// relative error < 1.2e-9
+static double
+normal_quantile(double p)
+{
+	static const double a[] = { -3.969683028665376e+01,
+		2.209460984245205e+02, -2.759285104469687e+02,
+		1.383577518672690e+02, -3.066479806614716e+01,
+		2.506628277459239e+00 };
+	static const double b[] = { -5.447609879822406e+01,
+		1.615858368580409e+02, -1.556989798598866e+02,
+		6.680131188771972e+01, -1.328068155288572e+01 };
+	static const double c[] = { -7.784894002430293e-03,
+		-3.223964580411365e-01, -2.400758277161838e+00,
+		-2.549732539343734e+00, 4.374664141464968e+00,
+		2.938163982698783e+00 };
+	static const double d[] = { 7.784695709041462e-03,
+		3.224671290700398e-01, 2.445134137142996e+00,
+		3.754408661907416e+00 };
+	double q, r;
+
+	if (p < 0.02425) {
+		q = std::sqrt(-2 * std::log(p));
+		return (((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q
+		        + c[5]) / ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1);
+	}
+	if (p > 1 - 0.02425)
+		return -normal_quantile(1 - p);
+	q = p - 0.5;
+	r = q * q;
+	return (((((a[0]*r + a[1])*r + a[2])*r + a[3])*r + a[4])*r + a[5])*q
+	       / (((((b[0]*r + b[1])*r + b[2])*r + b[3])*r + b[4])*r + 1);
+}
+
+// Student t quantile by the Cornish-Fisher expansion around the normal;
+// within 1% of the tables from 3 degrees of freedom up
+static double
+t_quantile(double p, int df)
+{
+	double z = normal_quantile(p), z2 = z * z, n = df;
+	return z + z * (z2 + 1) / (4 * n)
+	         + z * ((5 * z2 + 16) * z2 + 3) / (96 * n * n)
+	         + z * (((3 * z2 + 19) * z2 + 17) * z2 - 15) / (384 * n * n * n);
+}
+
+double
+measure::stddev(const vector<seconds> &v)
+{
+	if (v.size() < 2) return 0;
+	double m = mean(v), s = 0;
+	for (auto &t : v) s += (t.count() - m) * (t.count() - m);
+	return std::sqrt(s / (v.size() - 1));
+}
+
+interval
+measure::mean_ci(const vector<seconds> &v) const
+{
+	if (v.size() < 2) {
+		double m = v.empty() ? 0 : v[0].count();
+		return { m, m };
+	}
+	double m = mean(v);
+	double h = t_quantile((1 + opt.level) / 2, v.size() - 1) * stddev(v)
+	           / std::sqrt(v.size());
+	return { m - h, m + h };
+}
+
+// the median lies between order statistics j and k with probability
+// level, whatever the distribution; the ranks come from the normal
+// approximation to the binomial
+interval
+measure::median_ci(const vector<seconds> &v) const
+{
+	if (v.empty()) return { 0, 0 };
+	vector<double> s;
+	for (auto &t : v) s.push_back(t.count());
+	std::sort(s.begin(), s.end());
+
+	double n = s.size();
+	double h = normal_quantile((1 + opt.level) / 2) * std::sqrt(n) / 2;
+	long j = std::lround(n / 2 - h) - 1;       // 1-based ranks
+	long k = std::lround(n / 2 + h);
+	j = std::clamp(j, 0L, (long)s.size() - 1);
+	k = std::clamp(k, 0L, (long)s.size() - 1);
+	return { s[j], s[k] };
+}
+
+interval
+measure::ratio_ci(const vector<seconds> &a, const vector<seconds> &b) const
+{
+	double ma = mean(a), mb = mean(b);
+	if (a.size() < 2 || b.size() < 2 || ma == 0) {
+		double r = ma ? mb / ma : 0;
+		return { r, r };
+	}
+	double r = mb / ma;
+	double ea = stddev(a) / std::sqrt(a.size()) / ma;
+	double eb = stddev(b) / std::sqrt(b.size()) / mb;
+	int df = std::min(a.size(), b.size()) - 1;
+	double h = t_quantile((1 + opt.level) / 2, df) * r
+	           * std::sqrt(ea * ea + eb * eb);
+	return { r - h, r + h };
+}
+
+// beyond 1.5 interquartile ranges from the quartiles
+int
+measure::outliers(const vector<seconds> &v)
+{
+	if (v.size() < 4) return 0;
+	vector<double> s;
+	for (auto &t : v) s.push_back(t.count());
+	std::sort(s.begin(), s.end());
+
+	double q1 = s[s.size() / 4], q3 = s[(3 * s.size()) / 4];
+	double lo = q1 - 1.5 * (q3 - q1), hi = q3 + 1.5 * (q3 - q1);
+	return std::count_if(s.begin(), s.end(),
+	                     [=](double t) { return t < lo || t > hi; });
+}
+
+std::ostream&
+operator<<(std::ostream &o, const interval &i)
+{
+	return o << '[' << i.lo << ' ' << i.hi << ']';
+}
@@ -0,0 +1,101 @@
+#ifndef MEASURE_H
+#define MEASURE_H
+
+#include <cstddef>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include "pcg_random.hpp"
+
+// measurement controls for the timed loops.
+//
+// the testers time each trial with steady_clock and report the mean and
+// median.  on their own those can't separate AoS from SoA at a few
+// percent: the first trial pays for page faults and cold caches, the
+// thread migrates between cores, the clock ramps, and a trial hit by an
+// interrupt drags the mean.  measure adds
+//   warmup       untimed runs of the trial before the timed ones
+//   cpu          pin the calling thread (sweep pins its workers already)
+//   cold         evict the caches before every trial, for cold numbers.
+//                the last level cache is shared, so one job's flush
+//                evicts the others' tables mid-trial: cold sweeps need
+//                bw_jobs=1 (sweep.h; bench counts the flush buffer in a
+//                cold job's footprint, so that holds them to one at a time)
+//   level        confidence level of the intervals below
+// and the statistics to go with the trial times: confidence intervals for
+// the mean (Student t) and the median (order statistics, no assumption
+// about the distribution), and outliers by Tukey's fences, which are
+// counted, not dropped.
+//
+// interleave() runs the trials of several variants round-robin, in a
+// fresh random order each round, so drift in clock speed or background
+// load is spread over all of them instead of landing on whichever ran
+// last.
+
+struct measure_options {
+	int warmup = 1;
+	int cpu = -1;                   // -1: leave the affinity alone
+	bool cold = false;
+	double level = 0.95;
+};
+
+struct interval {
+	double lo, hi;
+};
+
+class measure {
+	public:
+	using options = measure_options;
+	using seconds = std::chrono::duration<double>;
+
+	private:
+	options opt;
+
+	public:
+	measure(const options &o = options());
+
+	const options& opts() const { return opt; }
+
+	// once per process: pin if asked, and warn about what we can't
+	// control (frequency scaling, turbo)
+	void setup() const;
+
+	// before each timed trial
+	void prepare() const { if (opt.cold) flush_caches(); }
+
+	template <typename F>
+	void warmup(F &&f) const {
+		for (int i = 0; i < opt.warmup; ++i) f();
+	}
+
+	template <typename F>
+	seconds time(F &&f) const {
+		prepare();
+		auto start = std::chrono::steady_clock::now();
+		f();
+		return std::chrono::steady_clock::now() - start;
+	}
+
+	// trial(v, i) runs trial i of variant v and returns its time (from
+	// time(), so it can do untimed setup first); the times come back
+	// per variant
+	std::vector<std::vector<seconds>>
+	interleave(int nvariants, int ntrials, pcg64 &rng,
+	           std::function<seconds(int v, int i)> trial) const;
+
+	interval mean_ci(const std::vector<seconds> &v) const;
+	interval median_ci(const std::vector<seconds> &v) const;
+	// of mean(b)/mean(a), from the variances of both (delta method)
+	interval ratio_ci(const std::vector<seconds> &a,
+	                  const std::vector<seconds> &b) const;
+
+	static bool pin(int cpu);
+	static void flush_caches();
+	static double stddev(const std::vector<seconds> &v);
+	static int outliers(const std::vector<seconds> &v);
+};
+
+std::ostream& operator<<(std::ostream &o, const interval &i);
+
+#endif
@@ -0,0 +1,193 @@
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perfcounters.h"
+
+// group 0 is the core events, group 1 the memory ones: three each, so
+// either fits beside the NMI watchdog on a four counter PMU
+static const struct {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+	int group;
+} events[hw_counts::NEVENTS] = {
+	{ "Cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0 },
+	{ "Instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0 },
+	{ "L1d misses", PERF_TYPE_HW_CACHE,
+	  PERF_COUNT_HW_CACHE_L1D |
+	  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), 1 },
+	{ "LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 1 },
+	{ "dTLB misses", PERF_TYPE_HW_CACHE,
+	  PERF_COUNT_HW_CACHE_DTLB |
+	  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), 1 },
+	{ "Branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,
+	  0 },
+};
+
+const char *
+hw_counts::name(int e)
+{
+	return events[e].name;
+}
+
+hw_counts&
+hw_counts::operator+=(const hw_counts &h)
+{
+	for (int e = 0; e < NEVENTS; ++e) v[e] += h.v[e];
+	present |= h.present;
+	return *this;
+}
+
+hw_counts
+hw_counts::operator-(const hw_counts &h) const
+{
+	hw_counts d = *this;
+	for (int e = 0; e < NEVENTS; ++e) d.v[e] -= h.v[e];
+	return d;
+}
+
+std::ostream&
+hw_counts::csv_header(std::ostream &o, const char *suffix)
+{
+	for (int e = 0; e < NEVENTS; ++e)
+		o << (e ? ", " : "") << events[e].name << suffix;
+	return o;
+}
+
+std::ostream&
+hw_counts::csv(std::ostream &o, double per) const
+{
+	for (int e = 0; e < NEVENTS; ++e)
+		o << (e ? ", " : "") << v[e] / per;
+	return o;
+}
+
+std::ostream&
+operator<<(std::ostream &o, const hw_counts &h)
+{
+	for (int e = 0; e < hw_counts::NEVENTS; ++e)
+		if (h.has((hw_counts::event)e))
+			o << hw_counts::name(e) << ": " << h.v[e] << " ";
+	if (h.has(hw_counts::CYCLES) && h.has(hw_counts::INSTRUCTIONS))
+		o << "IPC: " << h.ipc();
+	return o;
+}
+
+static int
+open_event(int e, int group)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = events[e].type;
+	attr.config = events[e].config;
+	attr.disabled = (group == -1);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP |
+	                   PERF_FORMAT_TOTAL_TIME_ENABLED |
+	                   PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+perfcounters::perfcounters() : nopen(0), present(0)
+{
+	static std::atomic<bool> warned(false);
+	int members[NGROUPS] = {};
+
+	for (int g = 0; g < NGROUPS; ++g) leader[g] = -1;
+	for (int e = 0; e < hw_counts::NEVENTS; ++e) {
+		int g = events[e].group;
+		fd[e] = open_event(e, leader[g]);
+		slot[e] = -1;
+		if (fd[e] < 0) continue;
+		if (leader[g] == -1) leader[g] = fd[e];
+		slot[e] = members[g]++;
+		++nopen;
+		present |= 1u << e;
+	}
+
+	if (!nopen && !warned.exchange(true))
+		std::cerr << "perfcounters: perf_event_open failed ("
+		          << strerror(errno)
+		          << "), hardware counters disabled\n";
+}
+
+bool
+perfcounters::available()
+{
+	static const bool a = perfcounters().nopen > 0;
+	return a;
+}
+
+perfcounters::~perfcounters()
+{
+	for (int e = 0; e < hw_counts::NEVENTS; ++e)
+		if (fd[e] >= 0) close(fd[e]);
+}
+
+void
+perfcounters::start()
+{
+	for (int g = 0; g < NGROUPS; ++g) {
+		if (leader[g] < 0) continue;
+		ioctl(leader[g], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leader[g], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+}
+
+void
+perfcounters::stop()
+{
+	for (int g = 0; g < NGROUPS; ++g)
+		if (leader[g] >= 0)
+			ioctl(leader[g], PERF_EVENT_IOC_DISABLE,
+			      PERF_IOC_FLAG_GROUP);
+}
+
+hw_counts
+perfcounters::read() const
+{
+	hw_counts h;
+
+	for (int g = 0; g < NGROUPS; ++g) {
+		if (leader[g] < 0) continue;
+
+		// nr, time_enabled, time_running, values[nr]
+		uint64_t buf[3 + hw_counts::NEVENTS];
+		if (::read(leader[g], buf, sizeof(buf)) < 0)
+			continue;
+
+		// enabled but never running: the group didn't fit on the PMU
+		if (buf[1] && !buf[2]) {
+			static std::atomic<bool> warned(false);
+			if (!warned.exchange(true))
+				std::cerr << "perfcounters: event group never "
+				             "scheduled (too few free PMU "
+				             "counters?), its counts dropped\n";
+			continue;
+		}
+
+		// a group is scheduled as a unit; the two groups take turns
+		// if they don't fit together, so extrapolate each to the
+		// full enabled time
+		double scale = 1.0;
+		if (buf[2] < buf[1])
+			scale = (double)buf[1] / buf[2];
+
+		for (int e = 0; e < hw_counts::NEVENTS; ++e)
+			if (events[e].group == g && slot[e] >= 0) {
+				h.v[e] = buf[3 + slot[e]] * scale;
+				h.present |= 1u << e;
+			}
+	}
+	return h;
+}
@@ -0,0 +1,77 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <iostream>
+
+// hardware performance counters via perf_event_open(2).
+//
+// the testers wrap their timed sections in start()/stop() and add read()
+// into their per-trial stats, so a timing difference (say AoS vs SoA) can
+// be traced to cache misses, TLB misses or branch mispredictions.  only
+// user-space events of the calling thread are counted.
+//
+// if the kernel refuses (no PMU in a VM, perf_event_paranoid too high,
+// seccomp), available() is false, a warning is printed once, and read()
+// returns all zeros.  events the CPU lacks are left out individually.
+// the six events are two groups of three, cycles, instructions and
+// branch misses, and the L1d, LLC and dTLB misses, each scheduled all or
+// nothing, so each fits on a four counter PMU even with the NMI watchdog
+// holding one.  when both don't fit at once the kernel
+// multiplexes them and read() scales each group by its time_enabled over
+// time_running.  a group that never ran is warned about once and left
+// out of present, rather than giving zeros that look measured.
+
+struct hw_counts {
+	enum event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES,
+	             DTLB_MISSES, BRANCH_MISSES, NEVENTS };
+
+	uint64_t v[NEVENTS];
+	uint32_t present;       // bit e set if event e was counted
+
+	hw_counts() : v{}, present(0) {}
+
+	uint64_t operator[](event e) const { return v[e]; }
+	bool has(event e) const { return present & (1u << e); }
+	double ipc() const {
+		return v[CYCLES] ? (double)v[INSTRUCTIONS] / v[CYCLES] : 0;
+	}
+
+	hw_counts& operator+=(const hw_counts &h);
+	hw_counts operator-(const hw_counts &h) const;
+
+	static const char *name(int e);
+
+	// "Cycles, Instructions, ..." and the matching values divided by
+	// 'per' (e.g. the number of operations in the section)
+	static std::ostream& csv_header(std::ostream &o,
+	                                const char *suffix = "");
+	std::ostream& csv(std::ostream &o, double per = 1) const;
+};
+
+std::ostream& operator<<(std::ostream &o, const hw_counts &h);
+
+class perfcounters {
+	private:
+	static const int NGROUPS = 2;
+	int fd[hw_counts::NEVENTS];
+	int slot[hw_counts::NEVENTS];   // position in its group's read
+	int leader[NGROUPS];            // fd of each group's leader, or -1
+	int nopen;
+	uint32_t present;
+
+	public:
+	perfcounters();
+	~perfcounters();
+	perfcounters(const perfcounters&) = delete;
+	perfcounters& operator=(const perfcounters&) = delete;
+
+	// whether counters open here at all, without keeping any open
+	static bool available();
+
+	void start();           // zero and enable the groups
+	void stop();            // disable the groups
+	hw_counts read() const; // counts since start(), scaled if multiplexed
+};
+
+#endif
@@ -0,0 +1,201 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "results.h"
+
+static const char *sw_names[sw_counts::NFIELDS] = {
+	"inserts", "queries", "removes", "rebuild_inserts",
+	"failed_inserts", "failed_queries", "failed_removes", "duplicates",
+	"resizes", "insert_misses", "query_misses", "remove_misses",
+	"rebuild_insert_misses", "insert_shifts", "longest_search",
+};
+
+// hw_counts::name() is for people; these are for columns
+static const char *hw_names[hw_counts::NEVENTS] = {
+	"cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses",
+	"branch_misses",
+};
+
+const char *
+sw_counts::name(int f)
+{
+	return sw_names[f];
+}
+
+sw_counts&
+sw_counts::operator+=(const sw_counts &s)
+{
+	for (int f = 0; f < NFIELDS; ++f)
+		if (f == LONGEST_SEARCH)
+			v[f] = std::max(v[f], s.v[f]);
+		else
+			v[f] += s.v[f];
+	present |= s.present;
+	misses |= s.misses;
+	return *this;
+}
+
+static bool
+sw_has(const sw_counts &s, int f)
+{
+	return f < sw_counts::INSERT_MISSES ? s.present : s.misses;
+}
+
+double
+result_record::mean() const
+{
+	if (trials.empty()) return 0;
+	double s = 0;
+	for (double t : trials) s += t;
+	return s / trials.size();
+}
+
+double
+result_record::median() const
+{
+	if (trials.empty()) return 0;
+	std::vector<double> t = trials;
+	std::sort(t.begin(), t.end());
+	std::size_t m = t.size() / 2;
+	return t.size() & 1 ? t[m] : (t[m-1] + t[m]) / 2;
+}
+
+// the names are ours, so the only escaping needed is for file paths
+static std::ostream&
+quote(std::ostream &o, const std::string &s)
+{
+	o << '"';
+	for (char c : s) {
+		if (c == '"' || c == '\\') o << '\\';
+		o << c;
+	}
+	return o << '"';
+}
+
+std::ostream&
+result_record::json(std::ostream &o) const
+{
+	std::ios::fmtflags flags = o.flags();
+	std::streamsize prec = o.precision(10);
+
+	o << "{\"tester\":"; quote(o, tester);
+	o << ",\"table\":"; quote(o, table);
+	o << ",\"layout\":"; quote(o, layout);
+	o << ",\"stats\":"; quote(o, stats);
+	o << ",\"key_width\":" << key_width
+	  << ",\"value_width\":" << value_width
+	  << ",\"n\":" << n
+	  << ",\"x\":" << x
+	  << ",\"alpha\":" << alpha
+	  << ",\"op\":"; quote(o, op);
+	o << ",\"ops\":" << ops
+	  << ",\"trials\":[";
+	for (std::size_t i = 0; i < trials.size(); ++i)
+		o << (i ? "," : "") << trials[i];
+	o << "],\"mean\":" << mean()
+	  << ",\"median\":" << median();
+
+	o << ",\"extra\":{";
+	bool first = true;
+	for (auto &kv : extra) {
+		o << (first ? "" : ",");
+		quote(o, kv.first) << ":" << kv.second;
+		first = false;
+	}
+
+	o << "},\"sw\":{";
+	first = true;
+	for (int f = 0; f < sw_counts::NFIELDS; ++f)
+		if (sw_has(sw, f)) {
+			o << (first ? "" : ",") << '"' << sw_names[f] << "\":"
+			  << sw.v[f];
+			first = false;
+		}
+
+	o << "},\"hw\":{";
+	first = true;
+	for (int e = 0; e < hw_counts::NEVENTS; ++e)
+		if (hw.has((hw_counts::event)e)) {
+			o << (first ? "" : ",") << '"' << hw_names[e] << "\":"
+			  << hw.v[e];
+			first = false;
+		}
+	o << "}}\n";
+
+	o.flags(flags);
+	o.precision(prec);
+	return o;
+}
+
+std::ostream&
+result_record::csv_header(std::ostream &o)
+{
+	o << "tester,table,layout,stats,key_width,value_width,n,x,alpha,op,"
+	     "ops,trials,mean,median,extra";
+	for (int f = 0; f < sw_counts::NFIELDS; ++f)
+		o << "," << sw_names[f];
+	for (int e = 0; e < hw_counts::NEVENTS; ++e)
+		o << "," << hw_names[e];
+	return o << "\n";
+}
+
+// trial times are ';' separated and extra is "key=value;..." so that
+// every record has the same columns
+std::ostream&
+result_record::csv(std::ostream &o) const
+{
+	std::ios::fmtflags flags = o.flags();
+	std::streamsize prec = o.precision(10);
+
+	o << tester << "," << table << "," << layout << "," << stats
+	  << "," << key_width << "," << value_width << "," << n << "," << x << "," << alpha
+	  << "," << op << "," << ops << ",";
+	for (std::size_t i = 0; i < trials.size(); ++i)
+		o << (i ? ";" : "") << trials[i];
+	o << "," << mean() << "," << median() << ",";
+	bool first = true;
+	for (auto &kv : extra) {
+		o << (first ? "" : ";") << kv.first << "=" << kv.second;
+		first = false;
+	}
+	for (int f = 0; f < sw_counts::NFIELDS; ++f) {
+		o << ",";
+		if (sw_has(sw, f)) o << sw.v[f];
+	}
+	for (int e = 0; e < hw_counts::NEVENTS; ++e) {
+		o << ",";
+		if (hw.has((hw_counts::event)e)) o << hw.v[e];
+	}
+	o << "\n";
+
+	o.flags(flags);
+	o.precision(prec);
+	return o;
+}
+
+bool
+result_writer::open(const std::string &path)
+{
+	f.open(path);
+	if (!f) {
+		std::cerr << "results: couldn't open " << path << "\n";
+		return false;
+	}
+	csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+	header_done = false;
+	return true;
+}
+
+void
+result_writer::add(const result_record &r)
+{
+	if (!f.is_open()) return;
+	if (csv) {
+		if (!header_done) result_record::csv_header(f);
+		header_done = true;
+		r.csv(f);
+	} else {
+		r.json(f);
+	}
+	f.flush();
+}
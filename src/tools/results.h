@@ -0,0 +1,143 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include "perfcounters.h"
+
+// the result schema shared by every tester.
+//
+// besides its own human readable operator<<, each tester keeps one
+// result_record per data point (results()), and a result_writer writes
+// them as JSON lines or CSV so runs can be loaded without a parser per
+// tester.  a record holds
+//   tester, table, layout ("aos", "soa", "aosoa", "bkt" or ""), stats
+//   (the table's perfstats.h policy), key/value widths (bytes)
+//   n (slots), x, alpha (load factor after the test)
+//   op (what was timed), ops (per trial), trial times in seconds
+//   extra: tester specific numbers (percentiles, rates, rebuilds, ...),
+//          and table_bytes, the table's footprint
+//   sw: the table's own counters over the timed sections (perfstats.h)
+//   hw: hardware counters over the timed sections, if available
+
+struct sw_counts {
+	enum field { INSERTS, QUERIES, REMOVES, REBUILD_INSERTS,
+	             FAILED_INSERTS, FAILED_QUERIES, FAILED_REMOVES,
+	             DUPLICATES, RESIZES, INSERT_MISSES, QUERY_MISSES,
+	             REMOVE_MISSES, REBUILD_INSERT_MISSES, INSERT_SHIFTS,
+	             LONGEST_SEARCH, NFIELDS };
+
+	uint64_t v[NFIELDS];
+	bool present;           // the table keeps counters at all
+	bool misses;            // ... including probe misses (FullStats)
+
+	sw_counts() : v{}, present(false), misses(false) {}
+
+	static const char *name(int f);
+	sw_counts& operator+=(const sw_counts &s);
+
+	// add the table's counters since its last reset_perf_counts()
+	template <typename hashtable>
+	void add(const hashtable &ht) {
+		sw_counts s;
+		if constexpr (requires { ht.failed_queries; }) {
+			s.present = true;
+			s.v[INSERTS] = ht.inserts;
+			s.v[QUERIES] = ht.queries;
+			s.v[REMOVES] = ht.removes;
+			s.v[REBUILD_INSERTS] = ht.rebuild_inserts;
+			s.v[FAILED_INSERTS] = ht.failed_inserts;
+			s.v[FAILED_QUERIES] = ht.failed_queries;
+			s.v[FAILED_REMOVES] = ht.failed_removes;
+			s.v[DUPLICATES] = ht.duplicates;
+			s.v[RESIZES] = ht.resizes;
+		}
+		if constexpr (requires { ht.longest_search; }) {
+			s.misses = true;
+			s.v[INSERT_MISSES] = ht.insert_misses;
+			s.v[QUERY_MISSES] = ht.query_misses;
+			s.v[REMOVE_MISSES] = ht.remove_misses;
+			s.v[REBUILD_INSERT_MISSES] = ht.rebuild_insert_misses;
+			s.v[INSERT_SHIFTS] = ht.insert_shifts;
+			s.v[LONGEST_SEARCH] = ht.longest_search;
+		}
+		*this += s;
+	}
+};
+
+struct result_record {
+	std::string tester;
+	std::string table;
+	std::string layout;
+	std::string stats;
+	unsigned key_width = 0, value_width = 0;
+	uint64_t n = 0;
+	double x = 0;
+	double alpha = 0;
+	std::string op;
+	uint64_t ops = 0;
+	std::vector<double> trials;
+	std::map<std::string, double> extra;
+	sw_counts sw;
+	hw_counts hw;
+
+	result_record() {}
+	result_record(const std::string &tester) : tester(tester) {}
+
+	// table, layout, stats, widths, n and alpha from the table after
+	// the test
+	template <typename hashtable>
+	result_record& describe(const hashtable &ht) {
+		table = ht.table_type();
+		std::size_t u = table.rfind('_');
+		layout = u == std::string::npos ? "" : table.substr(u + 1);
+		if (layout != "aos" && layout != "soa" && layout != "aosoa"
+		    && layout != "bkt")
+			layout = "";    // the baselines have none
+		stats = hashtable::stats_name;
+		key_width = sizeof(typename hashtable::key_type);
+		value_width = sizeof(typename hashtable::value_type);
+		n = ht.table_size();
+		alpha = ht.load_factor();
+		extra["table_bytes"] = ht.table_size_bytes();
+		return *this;
+	}
+
+	template <typename D>
+	result_record& times(const std::vector<D> &d) {
+		trials.clear();
+		for (auto &t : d) trials.push_back(t.count());
+		return *this;
+	}
+
+	double mean() const;
+	double median() const;
+
+	std::ostream& json(std::ostream &o) const;
+	static std::ostream& csv_header(std::ostream &o);
+	std::ostream& csv(std::ostream &o) const;
+};
+
+// writes records to path: CSV if it ends in .csv, JSON lines otherwise
+class result_writer {
+	private:
+	std::ofstream f;
+	bool csv;
+	bool header_done;
+
+	public:
+	result_writer() : csv(false), header_done(false) {}
+	bool open(const std::string &path);
+	bool is_open() const { return f.is_open(); }
+
+	void add(const result_record &r);
+	void add(const std::vector<result_record> &v) {
+		for (auto &r : v) add(r);
+	}
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "snapshot.h"
+
+bool
+write_all(int fd, const void *buf, std::size_t len)
+{
+	const char *p = (const char *)buf;
+	while (len) {
+		ssize_t w = ::write(fd, p, len);
+		if (w < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		p += w;
+		len -= w;
+	}
+	return true;
+}
+
+bool
+snapshotter::begin(const std::string &path, std::size_t slots,
+                   std::size_t slot_bytes,
+                   const std::function<bool(int)> &write_image)
+{
+	if (pid) return false;
+
+	region_slots = std::max<std::size_t>(1, region_bytes / slot_bytes);
+	total_regions = (slots + region_slots - 1) / region_slots;
+	dirty.assign(total_regions, false);
+	dirty_regions = 0;
+
+	int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		std::cerr << "snapshot: couldn't open " << path << "\n";
+		return false;
+	}
+
+	pid_t child = fork();
+	if (child < 0) {
+		std::cerr << "snapshot: fork failed\n";
+		::close(fd);
+		return false;
+	} else if (child == 0) {
+		// child: the table is frozen as of the fork
+		bool ok = write_image(fd) && ::fsync(fd) == 0;
+		::close(fd);
+		_exit(ok ? 0 : 1);
+	}
+
+	::close(fd);
+	pid = child;
+	++snapshots;
+	return true;
+}
+
+bool
+snapshotter::poll()
+{
+	int status;
+	if (!pid) return true;
+	if (waitpid(pid, &status, WNOHANG) == 0) return false;
+	pid = 0;
+	return true;
+}
+
+bool
+snapshotter::wait()
+{
+	int status;
+	if (!pid) return true;
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR) {
+			pid = 0;
+			return false;
+		}
+	pid = 0;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
@@ -0,0 +1,76 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <sys/types.h>
+
+// point-in-time table snapshots.
+//
+// begin() forks a child that streams the table image to disk.  the kernel
+// gives the child a copy-on-write view of the parent's memory, so the owning
+// thread keeps mutating the live table while the child writes a consistent
+// image.  the table reports every region it writes through touch(), which
+// tracks how many regions were dirtied (i.e. copied by the kernel) during
+// the snapshot.
+
+struct snapshot_header {
+	char magic[8];          // "LPSNAP1"
+	char type[24];          // table_type()
+	uint64_t buckets;
+	uint64_t records;
+	uint64_t table_head;
+	uint32_t rec_width;     // bytes per slot in the first array
+	uint32_t state_width;   // bytes per slot in the state array, or 0
+};
+
+class snapshotter {
+	private:
+	pid_t pid;
+	std::size_t region_slots;
+	std::vector<bool> dirty;
+
+	public:
+	// a region is one page worth of slots
+	static const std::size_t region_bytes = 4096;
+
+	uint64_t dirty_regions;         // regions dirtied during the snapshot
+	uint64_t total_regions;         // regions in the table at begin()
+	uint64_t snapshots;
+
+	snapshotter() : pid(0), region_slots(1), dirty_regions(0),
+	                total_regions(0), snapshots(0) {}
+	~snapshotter() { wait(); }
+
+	bool active() const { return pid != 0; }
+
+	// fork a child that calls write_image(fd) and exits.
+	// returns false if a snapshot is already running or the fork failed
+	bool begin(const std::string &path, std::size_t slots,
+	           std::size_t slot_bytes,
+	           const std::function<bool(int)> &write_image);
+
+	// mark [first, first+count) as written by the owning thread
+	inline void touch(std::size_t first, std::size_t count) {
+		if (!pid || !count) return;
+		std::size_t r = first / region_slots;
+		std::size_t last = (first + count - 1) / region_slots;
+		for (; r <= last && r < dirty.size(); ++r)
+			if (!dirty[r]) {
+				dirty[r] = true;
+				++dirty_regions;
+			}
+	}
+	inline void touch_all() { touch(0, region_slots * dirty.size()); }
+
+	bool poll();    // reap the child if it has finished
+	bool wait();    // block until the child finishes, true on success
+};
+
+// write all of buf to fd, retrying short writes
+bool write_all(int fd, const void *buf, std::size_t len);
+
+#endif
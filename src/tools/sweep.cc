@@ -0,0 +1,159 @@
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "sweep.h"
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+// swallows the testers' progress output while jobs run concurrently
+class nullbuf : public std::streambuf {
+	protected:
+	int overflow(int c) override { return c; }
+	std::streamsize xsputn(const char *, std::streamsize n) override {
+		return n;
+	}
+};
+
+std::size_t
+sweep_default_mem_budget()
+{
+	long pages = sysconf(_SC_PHYS_PAGES);
+	long page = sysconf(_SC_PAGESIZE);
+	if (pages <= 0 || page <= 0)
+		return 0;       // unknown: no limit
+	return (std::size_t)pages * page / 4 * 3;
+}
+
+sweep::sweep(const options &o) : opt(o)
+{
+	if (opt.cpus.empty())
+		opt.cpus = usable_cpus();
+	if (opt.threads <= 0)
+		opt.threads = opt.cpus.size();
+}
+
+std::vector<int>
+sweep::usable_cpus()
+{
+	std::vector<int> cpus;
+	cpu_set_t set;
+
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int c = 0; c < CPU_SETSIZE; ++c)
+			if (CPU_ISSET(c, &set)) cpus.push_back(c);
+	}
+	if (cpus.empty())
+		cpus.push_back(0);
+	return cpus;
+}
+
+std::size_t
+sweep::llc_bytes()
+{
+	long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (l3 > 0) return l3;
+	long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	return l2 > 0 ? l2 : 32 << 20;
+}
+
+void
+sweep::add(const std::string &name, std::size_t bytes, jobfn fn)
+{
+	jobs.push_back({ name, bytes, fn, "", 0 });
+}
+
+void
+sweep::run(std::ostream &merged)
+{
+	const std::size_t llc = llc_bytes();
+	std::mutex m;
+	std::condition_variable cv;
+	std::vector<std::size_t> pending(jobs.size());
+	std::size_t mem_used = 0, done = 0;
+	int running = 0, heavy = 0;
+
+	// longest (largest) first keeps one big job from finishing alone
+	std::iota(pending.begin(), pending.end(), 0);
+	std::stable_sort(pending.begin(), pending.end(),
+	                 [&](std::size_t a, std::size_t b) {
+	                         return jobs[a].bytes > jobs[b].bytes;
+	                 });
+
+	auto fits = [&](const job &j) {
+		if (running == 0) return true;
+		if (opt.bw_jobs && j.bytes > llc && heavy >= opt.bw_jobs)
+			return false;
+		return !opt.mem_budget || mem_used + j.bytes <= opt.mem_budget;
+	};
+
+	auto worker = [&](int cpu) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+			std::cerr << "sweep: couldn't pin to cpu " << cpu << "\n";
+
+		std::unique_lock<std::mutex> lk(m);
+		for (;;) {
+			auto it = pending.end();
+			cv.wait(lk, [&] {
+				it = std::find_if(pending.begin(), pending.end(),
+				        [&](std::size_t i) { return fits(jobs[i]); });
+				return pending.empty() || it != pending.end();
+			});
+			if (pending.empty()) break;
+
+			std::size_t i = *it;
+			job &j = jobs[i];
+			pending.erase(it);
+			++running;
+			mem_used += j.bytes;
+			if (j.bytes > llc) ++heavy;
+			lk.unlock();
+
+			pcg64 rng(opt.seed, i);
+			std::ostringstream out;
+			auto t1 = steady_clock::now();
+			j.fn(rng, out);
+			auto t2 = steady_clock::now();
+			j.out = out.str();
+			j.secs = duration<double>(t2 - t1).count();
+
+			lk.lock();
+			--running;
+			mem_used -= j.bytes;
+			if (j.bytes > llc) --heavy;
+			std::cerr << "[" << ++done << "/" << jobs.size() << "] "
+			          << j.name << " (cpu " << cpu << ", " << j.secs
+			          << "s)\n";
+			cv.notify_all();
+		}
+	};
+
+	nullbuf null;
+	std::streambuf *coutbuf = nullptr;
+	if (opt.quiet)
+		coutbuf = std::cout.rdbuf(&null);
+
+	int nthreads = std::min<std::size_t>(opt.threads, jobs.size());
+	std::vector<std::thread> workers;
+	for (int t = 0; t < nthreads; ++t)
+		workers.emplace_back(worker, opt.cpus[t % opt.cpus.size()]);
+	for (auto &w : workers)
+		w.join();
+
+	if (opt.quiet)
+		std::cout.rdbuf(coutbuf);
+
+	for (auto &j : jobs)
+		merged << j.out;
+}
@@ -0,0 +1,71 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <iostream>
+#include "pcg_random.hpp"
+
+// run independent benchmark configurations in parallel.
+//
+// each job is a (table type, size, x, ...) configuration that writes its
+// results to the stream it is given.  run() starts one worker per cpu,
+// pinned to it, and hands out jobs largest first; when all are done the
+// outputs are written to the merged stream in the order the jobs were
+// added, so the result file doesn't depend on the schedule.
+//
+// job i gets pcg64(seed, i): a stream of its own, the same on every run
+// whatever the number of workers.
+//
+// tables much larger than the last level cache are limited by memory
+// bandwidth, and a core's worth of them each would mostly measure the
+// contention.  bw_jobs caps how many jobs over the cache size run at once
+// (one by default), and mem_budget caps the summed footprint so big sweeps
+// don't swap (a job larger than the budget runs alone; by default 3/4 of
+// physical memory).  0 means no limit in either.
+
+std::size_t sweep_default_mem_budget();
+
+struct sweep_options {
+	uint64_t seed = 42;
+	int threads = 0;                // 0: one per cpu
+	std::vector<int> cpus;          // empty: the ones we may use
+	int bw_jobs = 1;
+	std::size_t mem_budget = sweep_default_mem_budget();
+	bool quiet = true;              // silence progress on cout
+};
+
+class sweep {
+	public:
+	using options = sweep_options;
+	using jobfn = std::function<void(pcg64 &rng, std::ostream &out)>;
+
+	private:
+	struct job {
+		std::string name;
+		std::size_t bytes;
+		jobfn fn;
+		std::string out;
+		double secs;
+	};
+
+	options opt;
+	std::vector<job> jobs;
+
+	public:
+	sweep(const options &o = options());
+
+	// bytes is the job's approximate memory footprint
+	void add(const std::string &name, std::size_t bytes, jobfn fn);
+	std::size_t size() const { return jobs.size(); }
+
+	void run(std::ostream &merged);
+
+	static std::vector<int> usable_cpus();
+	static std::size_t llc_bytes();
+};
+
+#endif
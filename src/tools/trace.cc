@@ -0,0 +1,126 @@
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+#include "snapshot.h"
+
+// no terminating NUL: all eight bytes are the magic, the last the version
+static const char trace_magic[8] = { 'L', 'P', 'T', 'R', 'A', 'C', 'E', '1' };
+
+bool
+trace_writer::open(const std::string &path, const std::string &type,
+                   uint64_t buckets)
+{
+	close();
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		std::cerr << "trace: couldn't open " << path << "\n";
+		return false;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, trace_magic, sizeof(hdr.magic));
+	strncpy(hdr.type, type.c_str(), sizeof(hdr.type) - 1);
+	hdr.buckets = buckets;
+	hdr.key_width = sizeof(trace_record::key);
+	hdr.value_width = sizeof(trace_record::value);
+
+	buf.clear();
+	buf.reserve(1 << 16);
+	if (!write_all(fd, &hdr, sizeof(hdr))) {
+		std::cerr << "trace: write failed\n";
+		close();
+		return false;
+	}
+	return true;
+}
+
+void
+trace_writer::flush()
+{
+	if (fd < 0 || buf.empty()) return;
+	if (!write_all(fd, buf.data(), buf.size() * sizeof(trace_record)))
+		std::cerr << "trace: write failed\n";
+	hdr.count += buf.size();
+	buf.clear();
+}
+
+void
+trace_writer::close()
+{
+	if (fd < 0) return;
+	flush();
+	// now the count is known
+	if (pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+		std::cerr << "trace: couldn't update header\n";
+	::close(fd);
+	fd = -1;
+}
+
+bool
+trace_reader::open(const std::string &path)
+{
+	struct stat st;
+
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		std::cerr << "trace: couldn't open " << path << "\n";
+		if (fd >= 0) ::close(fd);
+		return false;
+	}
+	if ((std::size_t)st.st_size < sizeof(trace_header)) {
+		std::cerr << "trace: " << path << " is too short\n";
+		::close(fd);
+		return false;
+	}
+
+	map_len = st.st_size;
+	map = mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+	           fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) {
+		std::cerr << "trace: mmap failed\n";
+		map = nullptr;
+		return false;
+	}
+
+	hdr = (const trace_header *)map;
+	recs = (const trace_record *)(hdr + 1);
+	if (memcmp(hdr->magic, trace_magic, sizeof(hdr->magic)) ||
+	    hdr->key_width != sizeof(trace_record::key) ||
+	    hdr->value_width != sizeof(trace_record::value) ||
+	    sizeof(trace_header) + hdr->count * sizeof(trace_record)
+	    > map_len) {
+		std::cerr << "trace: " << path << " is not a valid trace\n";
+		close();
+		return false;
+	}
+	return true;
+}
+
+void
+trace_reader::close()
+{
+	if (map) munmap(map, map_len);
+	map = nullptr;
+	hdr = nullptr;
+	recs = nullptr;
+}
+
+void
+trace_reader::decode(std::vector<uint8_t> *ops, std::vector<uint32_t> *keys,
+                     std::vector<uint32_t> *values) const
+{
+	ops->resize(size());
+	keys->resize(size());
+	values->resize(size());
+	for (std::size_t i = 0; i < size(); ++i) {
+		(*ops)[i] = recs[i].op;
+		(*keys)[i] = recs[i].key;
+		(*values)[i] = recs[i].value;
+	}
+}
@@ -0,0 +1,134 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+// binary operation traces.
+//
+// a trace is a trace_header followed by 'count' packed 9-byte records
+// (op, 32-bit key, 32-bit value); key_width and value_width in the
+// header say so, and a reader takes no other widths.  trace_writer appends records through a buffer and
+// fills in the count on close().  trace_reader maps a trace read-only
+// (MAP_POPULATE, so replay doesn't take page faults) and decode() unpacks
+// it into flat arrays, so a replay loop does no parsing while timed.
+// recording<hashtable> logs the operations made on any table.
+
+namespace trace {
+	enum op : uint8_t { INSERT, QUERY, REMOVE, REBUILD };
+}
+
+struct trace_header {
+	char magic[8];          // "LPTRACE1", unterminated; '1' is the version
+	char type[24];          // table_type() of the recorded table
+	uint64_t buckets;       // its size when recording started
+	uint64_t count;         // number of records
+	uint32_t key_width;
+	uint32_t value_width;
+};
+
+struct __attribute__((packed)) trace_record {
+	uint8_t op;
+	uint32_t key;
+	uint32_t value;
+};
+
+class trace_writer {
+	private:
+	int fd;
+	trace_header hdr;
+	std::vector<trace_record> buf;
+
+	void flush();
+
+	public:
+	trace_writer() : fd(-1) {}
+	~trace_writer() { close(); }
+	trace_writer(const trace_writer&) = delete;
+	trace_writer& operator=(const trace_writer&) = delete;
+
+	bool open(const std::string &path, const std::string &type,
+	          uint64_t buckets);
+	bool is_open() const { return fd >= 0; }
+	void close();
+
+	inline void add(trace::op op, uint32_t k, uint32_t v = 0) {
+		buf.push_back({ op, k, v });
+		if (buf.size() == buf.capacity()) flush();
+	}
+};
+
+class trace_reader {
+	private:
+	void *map;
+	std::size_t map_len;
+	const trace_header *hdr;
+	const trace_record *recs;
+
+	public:
+	trace_reader() : map(nullptr), map_len(0), hdr(nullptr),
+	                 recs(nullptr) {}
+	~trace_reader() { close(); }
+	trace_reader(const trace_reader&) = delete;
+	trace_reader& operator=(const trace_reader&) = delete;
+
+	bool open(const std::string &path);
+	void close();
+
+	const trace_header& header() const { return *hdr; }
+	uint64_t size() const { return hdr ? hdr->count : 0; }
+	const trace_record& operator[](std::size_t i) const { return recs[i]; }
+
+	void decode(std::vector<uint8_t> *ops, std::vector<uint32_t> *keys,
+	            std::vector<uint32_t> *values) const;
+};
+
+// a table that writes every insert/query/remove/rebuild its caller makes
+// to a trace (path, or <table_type>.trace).  the table's own internal
+// calls (rebuild reinserts, resizes) aren't logged, so replaying the trace
+// on another table type sends it exactly the same requests.  only tables
+// whose keys and values fit a record's 32 bits can be recorded
+template <typename hashtable>
+class recording : public hashtable {
+	private:
+	trace_writer w;
+
+	public:
+	using typename hashtable::result;
+	using K = typename hashtable::key_type;
+	using V = typename hashtable::value_type;
+	static_assert(std::is_integral_v<K> && std::is_integral_v<V> &&
+	              sizeof(K) <= sizeof(trace_record::key) &&
+	              sizeof(V) <= sizeof(trace_record::value),
+	              "trace records hold 32-bit keys and values");
+
+	recording(uint32_t b, const std::string &path = "") : hashtable(b) {
+		w.open(path.empty() ? this->table_type() + ".trace" : path,
+		       this->table_type(), this->table_size());
+	}
+
+	result insert(K key, V value, bool rebuilding = false) {
+		if (!rebuilding) w.add(trace::INSERT, key, value);
+		return hashtable::insert(key, value, rebuilding);
+	}
+	bool query(K key, V *value) {
+		w.add(trace::QUERY, key);
+		return hashtable::query(key, value);
+	}
+	result remove(K key) {
+		w.add(trace::REMOVE, key);
+		return hashtable::remove(key);
+	}
+	void rebuild() {
+		w.add(trace::REBUILD, 0);
+		hashtable::rebuild();
+	}
+
+	// finish the trace before the table goes away
+	void close_trace() { w.close(); }
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <cmath>
+#include <random>
+#include "workload.h"
+
+std::string
+workload::name() const
+{
+	const char *k[] = { "uniform", "sequential", "strided", "clustered" };
+	const char *a[] = { "uniform", "zipfian", "hotspot", "latest" };
+	return std::string(k[(int)keys]) + "_" + a[(int)access];
+}
+
+static int
+even_bits(int b)
+{
+	return b < 2 ? 2 : b + (b & 1);
+}
+
+keyset::keyset(const workload &w, pcg64 &rng)
+        : dist(w.keys), perm(rng), base(rng()), stride(1),
+          cluster_bits(0), clusters(1)
+{
+	if (dist == keydist::STRIDED)
+		stride = (w.key_param ? w.key_param : 2654435761u) | 1;
+
+	if (dist == keydist::CLUSTERED) {
+		uint64_t c = w.key_param ? w.key_param : 1024;
+		while ((1ull << cluster_bits) < c) ++cluster_bits;
+		cluster_bits = std::min(std::max(cluster_bits, 1), 30);
+		clusters = 1ull << (32 - cluster_bits);
+		perm = keygen(rng(), even_bits(32 - cluster_bits));
+	}
+}
+
+void
+keyset::fill(uint32_t *out, uint64_t first, std::size_t n) const
+{
+	if (dist == keydist::UNIFORM) {
+		perm.fill(out, first, n);
+		return;
+	}
+	for (std::size_t j = 0; j < n; ++j)
+		out[j] = (*this)(first + j);
+}
+
+// sum_{i=1}^{n} 1/i^theta: exact for the first million terms, then the
+// integral (plus half the endpoint difference) for the rest
+static double
+zeta(uint64_t n, double theta)
+{
+	const uint64_t exact = 1'000'000;
+	double z = 0;
+	for (uint64_t i = 1; i <= std::min(n, exact); ++i)
+		z += 1.0 / std::pow(i, theta);
+	if (n > exact) {
+		double a = exact, b = n;
+		z += (std::pow(b, 1-theta) - std::pow(a, 1-theta)) / (1-theta)
+		     + 0.5 * (std::pow(b, -theta) - std::pow(a, -theta));
+	}
+	return z;
+}
+
+picker::picker(const workload &w, uint64_t max_items)
+        : dist(w.access), theta(0.99), hot_ops(0.9),
+          items(std::max<uint64_t>(max_items, 2))
+{
+	if (dist == accessdist::ZIPFIAN && w.access_param)
+		theta = w.access_param;
+	if (dist == accessdist::HOTSPOT && w.access_param)
+		hot_ops = w.access_param;
+	if (theta >= 1.0) {
+		std::cerr << "picker: zipf theta must be < 1, using 0.99\n";
+		theta = 0.99;
+	}
+
+	if (dist == accessdist::ZIPFIAN || dist == accessdist::LATEST) {
+		// J. Gray et al. Quickly generating billion-record synthetic
+		// databases. SIGMOD 1994
+		zetan = zeta(items, theta);
+		zeta2 = zeta(2, theta);
+		alpha = 1.0 / (1.0 - theta);
+		eta = (1 - std::pow(2.0 / items, 1 - theta))
+		      / (1 - zeta2 / zetan);
+	}
+}
+
+// popularity rank in [0, n), 0 most popular
+uint64_t
+picker::zipf(pcg64 &rng, uint64_t n)
+{
+	std::uniform_real_distribution<double> U(0, 1);
+	uint64_t r;
+	do {
+		double u = U(rng), uz = u * zetan;
+		if (uz < 1.0)
+			r = 0;
+		else if (uz < 1.0 + std::pow(0.5, theta))
+			r = 1;
+		else
+			r = items * std::pow(eta*u - eta + 1, alpha);
+	} while (r >= n);
+	return r;
+}
+
+std::size_t
+picker::operator()(pcg64 &rng, std::size_t n)
+{
+	switch (dist) {
+	case accessdist::ZIPFIAN: {
+		// scatter the ranks so the hot keys aren't neighbours
+		uint64_t h = zipf(rng, n) * 0x9e3779b97f4a7c15ULL;
+		return (h ^ (h >> 32)) % n;
+	}
+	case accessdist::HOTSPOT: {
+		std::size_t hot = std::max<std::size_t>(n / 100, 1);
+		std::uniform_real_distribution<double> U(0, 1);
+		if (U(rng) < hot_ops || hot == n)
+			return std::uniform_int_distribution<std::size_t>
+			       (0, hot-1)(rng);
+		return std::uniform_int_distribution<std::size_t>
+		       (hot, n-1)(rng);
+	}
+	case accessdist::LATEST:
+		return n - 1 - zipf(rng, n);
+	default:
+		return std::uniform_int_distribution<std::size_t>(0, n-1)(rng);
+	}
+}
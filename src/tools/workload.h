@@ -0,0 +1,92 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "pcg_random.hpp"
+#include "keygen.h"
+
+// key distributions for the testers.
+//
+// the tables hash with a monotone fastrange, so which keys are inserted
+// matters as much as how many: sequential or clustered ids land in
+// adjacent slots and build long runs that uniform keys never do.
+//
+// keyset gives the i-th inserted key, unique for every i:
+//   UNIFORM     random over the 32-bit space (keygen)
+//   SEQUENTIAL  base, base+1, base+2, ...
+//   STRIDED     base + i*param; param is forced odd so keys never repeat
+//   CLUSTERED   dense runs of param keys (rounded up to a power of two)
+//               starting at random, like time-clustered ids
+//
+// picker chooses which of the n present keys an operation touches:
+//   UNIFORM     every key equally likely
+//   ZIPFIAN     zipf(param) over popularity rank, ranks scattered over
+//               the keys (YCSB's scrambled zipfian), param ~0.99
+//   HOTSPOT     param of the ops go to the hottest 1% of keys
+//   LATEST      zipf(0.99) over recency: the last inserted is hottest
+
+enum class keydist { UNIFORM, SEQUENTIAL, STRIDED, CLUSTERED };
+enum class accessdist { UNIFORM, ZIPFIAN, HOTSPOT, LATEST };
+
+struct workload {
+	keydist keys = keydist::UNIFORM;
+	uint64_t key_param = 0;
+	accessdist access = accessdist::UNIFORM;
+	double access_param = 0;
+
+	std::string name() const;
+};
+
+class keyset {
+	private:
+	keydist dist;
+	keygen perm;            // UNIFORM keys, CLUSTERED run order
+	uint32_t base;
+	uint32_t stride;
+	int cluster_bits;
+	uint64_t clusters;
+
+	public:
+	keyset(const workload &w, pcg64 &rng);
+
+	inline uint32_t operator()(uint64_t i) const {
+		switch (dist) {
+		case keydist::SEQUENTIAL:
+			return base + (uint32_t)i;
+		case keydist::STRIDED:
+			return base + (uint32_t)i * stride;
+		case keydist::CLUSTERED: {
+			// walk the permutation until it lands in range
+			uint64_t c = (i >> cluster_bits) % clusters;
+			do c = perm(c); while (c >= clusters);
+			return (c << cluster_bits) | (i & ((1u << cluster_bits) - 1));
+		}
+		default:
+			return perm(i);
+		}
+	}
+
+	void fill(uint32_t *out, uint64_t first, std::size_t n) const;
+};
+
+class picker {
+	private:
+	accessdist dist;
+	double theta, hot_ops;
+	uint64_t items;         // zeta computed for this many
+	double zetan, zeta2, alpha, eta;
+
+	uint64_t zipf(pcg64 &rng, uint64_t n);
+
+	public:
+	// max_items: the largest n the zipfian will be asked for
+	picker(const workload &w, uint64_t max_items);
+
+	// an index in [0, n)
+	std::size_t operator()(pcg64 &rng, std::size_t n);
+};
+
+#endif
@@ -0,0 +1,352 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <deque>
+#include <tuple>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+#include "config.h"
+#include "sweep.h"
+#include "workload.h"
+#include "results.h"
+#include "measure.h"
+
+#include "testers/querytester.hpp"
+#include "testers/floattester.hpp"
+#include "testers/loadtester.hpp"
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+#include "robinhood.h"
+#include "swiss.h"
+#include "pma.h"
+#include "funnel.h"
+#include "wide.h"
+
+// widthstats [config=<file>] [key=value ...]
+//
+// every table type at every record shape: 4, 8 or 16 byte keys (uint32_t,
+// or key64 and key128, wide.h, spread over all their bits) by 4, 8, 32,
+// 64 or 128 byte values (blob), under the query, load and float testers
+// at each x.  the testers' output goes to out, their records to results
+// (results.h records carry the key and value widths), and a summary to
+// summary, per tester, shape and x:
+//   - each family's soa (and aosoa) time over its aos time, below 1
+//     where the split layout wins
+//   - for the load tester, ns, shifts and bytes shifted per insert for
+//     the shifting tables (bytes: shifts times the table's bytes per slot)
+//
+//   table          table types, or all                             [all]
+//   key_bytes      4, 8, 16                                     [4,8,16]
+//   value_bytes    4, 8, 32, 64, 128                     [4,8,32,64,128]
+//   tester         query, load, float                 [query,load,float]
+//   n              slots                                            [1M]
+//   x              load factors 1-1/x                          [2,10,50]
+//   ops            query, float: ops per trial                      [1M]
+//   trials         query, float: trials per data point               [5]
+//   points         load: data points                                [20]
+//   seed           seed, or random                                  [42]
+//   threads        jobs in parallel (sweep.h)                        [1]
+//   out            testers' output, or - for stdout        [width_sweep]
+//   summary        the summary, or - for stdout          [width_summary]
+//   results        the records, CSV if the name ends in .csv
+//
+// graveyard_bkt is left out: its blocks are one cache line, which holds
+// no record past 56 bytes.  so are the baselines.
+
+const std::vector<std::string> wide_table_names {
+	"graveyard_aos", "graveyard_soa", "ordered_aos", "ordered_soa",
+	"linear_aos", "linear_soa", "linear_aosoa", "robinhood_aos",
+	"robinhood_soa", "robinhood_aosoa", "swiss_aos", "pma_aos",
+	"funnel_aos",
+};
+
+template <template <typename, typename, typename> class table,
+          typename K, typename F>
+static bool
+with_value(int value_bytes, F &&f)
+{
+	switch (value_bytes) {
+	case 4:
+		f.template operator()<table<K, uint32_t, FullStats>>();
+		break;
+	case 8:
+		f.template operator()<table<K, uint64_t, FullStats>>();
+		break;
+	case 32:
+		f.template operator()<table<K, blob<32>, FullStats>>();
+		break;
+	case 64:
+		f.template operator()<table<K, blob<64>, FullStats>>();
+		break;
+	case 128:
+		f.template operator()<table<K, blob<128>, FullStats>>();
+		break;
+	default:
+		std::cerr << "no " << value_bytes
+		          << " byte values (4, 8, 32, 64 or 128)\n";
+		return false;
+	}
+	return true;
+}
+
+template <template <typename, typename, typename> class table, typename F>
+static bool
+with_shape(int key_bytes, int value_bytes, F &&f)
+{
+	switch (key_bytes) {
+	case 4:  return with_value<table, uint32_t>(value_bytes, f);
+	case 8:  return with_value<table, key64>(value_bytes, f);
+	case 16: return with_value<table, key128>(value_bytes, f);
+	}
+	std::cerr << "no " << key_bytes << " byte keys (4, 8 or 16)\n";
+	return false;
+}
+
+template <typename F>
+static bool
+with_wide_table(const std::string &name, int kb, int vb, F &&f)
+{
+	if (name == "graveyard_aos")
+		return with_shape<graveyard_aos>(kb, vb, f);
+	if (name == "graveyard_soa")
+		return with_shape<graveyard_soa>(kb, vb, f);
+	if (name == "ordered_aos")
+		return with_shape<ordered_aos>(kb, vb, f);
+	if (name == "ordered_soa")
+		return with_shape<ordered_soa>(kb, vb, f);
+	if (name == "linear_aos")
+		return with_shape<linear_aos>(kb, vb, f);
+	if (name == "linear_soa")
+		return with_shape<linear_soa>(kb, vb, f);
+	if (name == "linear_aosoa")
+		return with_shape<linear_aosoa>(kb, vb, f);
+	if (name == "robinhood_aos")
+		return with_shape<robinhood_aos>(kb, vb, f);
+	if (name == "robinhood_soa")
+		return with_shape<robinhood_soa>(kb, vb, f);
+	if (name == "robinhood_aosoa")
+		return with_shape<robinhood_aosoa>(kb, vb, f);
+	if (name == "swiss_aos")
+		return with_shape<swiss_aos>(kb, vb, f);
+	if (name == "pma_aos")
+		return with_shape<pma_aos>(kb, vb, f);
+	if (name == "funnel_aos")
+		return with_shape<funnel_aos>(kb, vb, f);
+	std::cerr << "unknown table type " << name << "\n";
+	return false;
+}
+
+struct params {
+	std::vector<int> xs;
+	int ops, trials, points;
+};
+
+// the tester's own output to o, its records to rows
+template <typename tester>
+static void
+emit(const tester &t, std::ostream &o, std::vector<result_record> *rows)
+{
+	o << t;
+	rows->insert(rows->end(), t.results().begin(), t.results().end());
+}
+
+template <typename hashtable>
+static void
+run_tester(const std::string &t, const params &p, uint64_t n,
+           pcg64 &rng, std::ostream &o, std::vector<result_record> *rows)
+{
+	const std::vector<uint64_t> ns{ n };
+
+	if (t == "query")
+		emit(querytester<hashtable>(rng, p.xs, ns, p.ops, p.trials, 0),
+		     o, rows);
+	else if (t == "float")
+		emit(floattester<hashtable>(rng, p.xs, ns, p.ops, p.trials),
+		     o, rows);
+	else if (t == "load")
+		for (auto x : p.xs)
+			emit(loadtester<hashtable>(rng, n, x, p.points, true),
+			     o, rows);
+}
+
+// one summary line's key: tester, shape, x
+struct point {
+	std::string tester;
+	unsigned key_width, value_width;
+	double x;
+	bool operator<(const point &o) const {
+		return std::tie(tester, key_width, value_width, x)
+		     < std::tie(o.tester, o.key_width, o.value_width, o.x);
+	}
+};
+
+struct load_sums {
+	double secs = 0;
+	uint64_t inserts = 0, shifts = 0;
+	double slot_bytes = 0;
+};
+
+static void
+summarize(std::ostream &o, const std::vector<result_record> &rows)
+{
+	// time per op, by point and table; load sums over its intervals
+	std::map<point, std::map<std::string, double>> secs;
+	std::map<point, std::map<std::string, load_sums>> loads;
+
+	for (auto &r : rows) {
+		point p{ r.tester, r.key_width, r.value_width, r.x };
+		if (r.tester == "load") {
+			load_sums &l = loads[p][r.table];
+			for (double t : r.trials) l.secs += t;
+			l.inserts += r.ops;
+			l.shifts += r.sw.v[sw_counts::INSERT_SHIFTS];
+			l.slot_bytes = r.extra.at("table_bytes") / r.n;
+		} else {
+			secs[p][r.table] = r.mean() / r.ops;
+		}
+	}
+	for (auto &[p, ls] : loads)
+		for (auto &[t, l] : ls)
+			secs[p][t] = l.secs / l.inserts;
+
+	std::ios fmt(nullptr);
+	fmt.copyfmt(o);
+	o << std::fixed << std::setprecision(2);
+
+	o << "# layout: tester, key bytes, value bytes, x, "
+	     "family, aos ns/op, soa/aos, aosoa/aos\n";
+	for (auto &[p, ts] : secs)
+		for (auto &[t, aos] : ts) {
+			std::size_t u = t.rfind("_aos");
+			if (u == std::string::npos || u + 4 != t.size())
+				continue;
+			std::string family = t.substr(0, u);
+			auto soa = ts.find(family + "_soa");
+			auto aosoa = ts.find(family + "_aosoa");
+			if (soa == ts.end() && aosoa == ts.end())
+				continue;
+			o << p.tester << ", " << p.key_width << ", "
+			  << p.value_width << ", " << p.x << ", " << family
+			  << ", " << aos * 1e9 << ", ";
+			if (soa != ts.end()) o << soa->second / aos;
+			else o << "-";
+			o << ", ";
+			if (aosoa != ts.end()) o << aosoa->second / aos;
+			else o << "-";
+			o << "\n";
+		}
+
+	o << "# shifts: key bytes, value bytes, x, table, ns/insert, "
+	     "shifts/insert, bytes shifted/insert\n";
+	for (auto &[p, ls] : loads)
+		for (auto &[t, l] : ls) {
+			if (!l.shifts || !l.inserts) continue;
+			double s = (double)l.shifts / l.inserts;
+			o << p.key_width << ", " << p.value_width << ", " << p.x
+			  << ", " << t << ", " << l.secs / l.inserts * 1e9
+			  << ", " << s << ", " << s * l.slot_bytes << "\n";
+		}
+	o.copyfmt(fmt);
+}
+
+int main(int argc, char **argv)
+{
+	config c;
+	params p;
+
+	if (!c.parse_args(argc, argv))
+		return 1;
+
+	std::vector<std::string> tables = c.get_strings("table", "all");
+	if (tables.size() == 1 && tables[0] == "all")
+		tables = wide_table_names;
+	std::vector<int64_t> kbs = c.get_ints("key_bytes", "4,8,16");
+	std::vector<int64_t> vbs = c.get_ints("value_bytes", "4,8,32,64,128");
+	std::vector<std::string> testers = c.get_strings("tester",
+	                                                 "query,load,float");
+	uint64_t n = c.get_int("n", 1'000'000);
+	for (auto x : c.get_ints("x", "2,10,50"))
+		p.xs.push_back(x);
+	p.ops = c.get_int("ops", 1'000'000);
+	p.trials = c.get_int("trials", 5);
+	p.points = c.get_int("points", 20);
+	if (p.xs.empty() || p.ops <= 0 || p.trials <= 0 || p.points <= 0) {
+		std::cerr << "need at least one x, and ops, trials and points "
+		             "> 0\n";
+		return 1;
+	}
+	for (auto &t : testers)
+		if (t != "query" && t != "load" && t != "float") {
+			std::cerr << "unknown tester " << t << "\n";
+			return 1;
+		}
+
+	std::string seed = c.get("seed", "42");
+	sweep::options opt;
+	opt.seed = seed == "random" ? std::random_device()() :
+	           std::stoull(seed);
+	opt.threads = c.get_int("threads", 1);
+	opt.quiet = opt.threads > 1;
+	std::string out = c.get("out", "width_sweep");
+	std::string summary = c.get("summary", "width_summary");
+	if (!c.ok())
+		return 1;
+	result_writer results;
+	if (c.has("results") && !results.open(c.get("results", "")))
+		return 1;
+
+	for (auto &k : c.unused())
+		std::cerr << "warning: unknown parameter " << k << "\n";
+	std::cerr << c;
+
+	// one job per (tester, shape, table)
+	sweep jobs(opt);
+	std::deque<std::vector<result_record>> rows;
+	bool ok = true;
+	for (auto &t : testers)
+		for (auto kb : kbs)
+			for (auto vb : vbs)
+				for (auto &name : tables)
+					ok &= with_wide_table(name, kb, vb,
+					                      [&]<typename hashtable>() {
+						std::size_t bytes = n * (sizeof(typename
+						        hashtable::key_type) + sizeof(typename
+						        hashtable::value_type) + 8);
+						auto *r = &rows.emplace_back();
+						jobs.add(t + " " + name + " " + std::to_string(kb)
+						         + "/" + std::to_string(vb), bytes,
+						         [&p, t, n, r](pcg64 &rng,
+						                       std::ostream &o) {
+							run_tester<hashtable>(t, p, n, rng, o, r);
+						});
+					});
+	if (!ok) return 1;
+
+	if (out == "-") {
+		jobs.run(std::cout);
+	} else {
+		std::ofstream f(out);
+		jobs.run(f);
+	}
+
+	std::vector<result_record> all;
+	for (auto &r : rows) {
+		results.add(r);
+		all.insert(all.end(), r.begin(), r.end());
+	}
+	if (summary == "-") {
+		summarize(std::cout, all);
+	} else {
+		std::ofstream f(summary);
+		summarize(f, all);
+	}
+
+	return 0;
+}
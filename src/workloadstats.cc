@@ -0,0 +1,49 @@
+#include <iostream>
+#include <fstream>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+#include "workload.h"
+
+#include "testers/querytester.hpp"
+#include "testers/floattester.hpp"
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+
+pcg_extras::seed_seq_from<std::random_device> seed_source;
+pcg64 rng(seed_source);
+
+// query and floating-op times for each table under skewed and structured
+// key sets, one output file per workload
+int main(int argc, char **argv)
+{
+	const vector<int> xs{2,5,10,20,50,100};
+	const vector<uint64_t> bs{1'000'000};
+	const int nq = 1'000'000;       // queries or ops per test
+	const int nt = 5;               // number of tests to average over
+
+	const vector<workload> wls {
+		{ keydist::UNIFORM,    0,    accessdist::UNIFORM, 0 },
+		{ keydist::SEQUENTIAL, 0,    accessdist::UNIFORM, 0 },
+		{ keydist::STRIDED,    8,    accessdist::UNIFORM, 0 },
+		{ keydist::CLUSTERED,  4096, accessdist::UNIFORM, 0 },
+		{ keydist::UNIFORM,    0,    accessdist::ZIPFIAN, 0.99 },
+		{ keydist::UNIFORM,    0,    accessdist::HOTSPOT, 0.9 },
+		{ keydist::SEQUENTIAL, 0,    accessdist::LATEST,  0 },
+	};
+
+	for (auto &w : wls) {
+		std::ofstream f("workload_" + w.name() + "_" + std::to_string(
+		                 w.key_param));
+		f << querytester<graveyard_aos<>>(rng, xs, bs, nq, nt, 0, w);
+		f << querytester<ordered_aos<>>(rng, xs, bs, nq, nt, 0, w);
+		f << querytester<linear_aos<>>(rng, xs, bs, nq, nt, 0, w);
+		f << floattester<graveyard_aos<>>(rng, xs, bs, nq, nt, "", w);
+		f << floattester<ordered_aos<>>(rng, xs, bs, nq, nt, "", w);
+		f << floattester<linear_aos<>>(rng, xs, bs, nq, nt, "", w);
+	}
+
+	return 0;
+}
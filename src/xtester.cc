@@ -38,11 +38,18 @@ int main(int argc, char **argv)
 			(rng, xs, std::vector<uint64_t>{b}, nq, nt, 0);
 	}
 
-/*	for (auto b: bs) {
+	for (auto b: bs) {
 		std::ofstream f(std::to_string(b/1000) + "_soa_query_xtester");
 		f << querytester<graveyard_soa<>>
 			(rng, xs, std::vector<uint64_t>{b}, nq, nt, 0);
-	}*/
+	}
+
+	// cache line blocks
+	for (auto b: bs) {
+		std::ofstream f(std::to_string(b/1000) + "_bkt_query_xtester");
+		f << querytester<graveyard_bkt<>>
+			(rng, xs, std::vector<uint64_t>{b}, nq, nt, 0);
+	}
 /*/
 	for (auto b: bs) {
 		for (auto mx: mxs) {
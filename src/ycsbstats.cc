@@ -0,0 +1,47 @@
+#include <iostream>
+#include <fstream>
+
+#include "pcg_random.hpp"
+#include "primes.h"
+#include "util.h"
+
+#include "testers/ycsbtester.hpp"
+#include "graveyard.h"
+#include "ordered.h"
+#include "linear.h"
+
+pcg_extras::seed_seq_from<std::random_device> seed_source;
+pcg64 rng(seed_source);
+
+int main(int argc, char **argv)
+{
+	const std::vector<int> xs{ 5, 20, 100 };
+	const uint64_t b = 10'000'000;
+	const uint64_t nops = 10'000'000;
+	const int intervals = 10;
+
+	for (char w : std::string("ABCDEF")) {
+		ycsb_config c = ycsb_preset(w);
+		std::ofstream f(std::string("ycsb_") + w);
+
+		for (auto x : xs) {
+			// leave room for workload D and E's inserts
+			uint64_t recs = b * (1.0 - 1.0/x) - nops * c.mix.insert;
+
+			f << ycsbtester<graveyard_aos<>>(rng, c, b, recs, nops,
+			                                 intervals);
+			f << ycsbtester<graveyard_soa<>>(rng, c, b, recs, nops,
+			                                 intervals);
+			f << ycsbtester<ordered_aos<>>(rng, c, b, recs, nops,
+			                               intervals);
+			f << ycsbtester<ordered_soa<>>(rng, c, b, recs, nops,
+			                               intervals);
+			f << ycsbtester<linear_aos<>>(rng, c, b, recs, nops,
+			                              intervals);
+			f << ycsbtester<linear_soa<>>(rng, c, b, recs, nops,
+			                              intervals);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+
+# compare two sets of benchmark results and flag regressions.
+#
+#   compare.py [options] baseline current
+#
+# baseline and current are result files or directories of them: JSON
+# lines or CSV from bench results=... (src/tools/results.h), or the
+# testers' text output ("----- type ---" sections with a trial times
+# column, as in stats/).  runs are matched on their configuration
+# (tester, table, stats policy, widths, n, x, op, ops); trials of identical
+# configurations within a set are pooled.
+#
+# each matched pair gets a Mann-Whitney U test on the per-trial times and
+# a bootstrap confidence interval for the ratio of medians
+# (current/baseline).  p-values are adjusted for the number of pairs
+# (Benjamini-Hochberg).  a pair is a regression when the adjusted p is
+# below --alpha and the whole interval is above 1 + --threshold, an
+# improvement for the mirror image.  exits 1 if anything regressed.
+
+import argparse
+import csv
+import json
+import math
+import os
+import random
+import re
+import sys
+
+# configuration fields the schema records are matched on
+KEY = ('tester', 'table', 'stats', 'key_width', 'value_width', 'n', 'x',
+       'op', 'ops')
+# records written before there was a choice were all FullStats
+DEFAULTS = {'stats': 'full'}
+
+
+def schema_key(r):
+    return tuple(str(r.get(k) or DEFAULTS.get(k, '')) for k in KEY)
+
+
+def load_jsonl(path):
+    out = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line:
+                r = json.loads(line)
+                out.append((schema_key(r), [float(t) for t in r['trials']]))
+    return out
+
+
+def load_csv(path):
+    out = []
+    with open(path, newline='') as f:
+        for r in csv.DictReader(f):
+            trials = [float(t) for t in r['trials'].split(';') if t]
+            out.append((schema_key(r), trials))
+    return out
+
+
+# the testers' own output: a header line naming the table, a column line,
+# then rows with the trial times in [ ]
+TRIAL_COLUMNS = ('Trial times', 'times', 'Rb times')
+TESTER_OF = {'Queries/trial': 'query', '# ops': 'float',
+             'Rb window': 'rebuild'}
+
+
+def load_text(path):
+    out = []
+    table, cols = None, None
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            m = re.match(r'-----\s+(\S+)', line)
+            if m:
+                table, cols = m.group(1).rstrip(','), None
+                continue
+            if table and cols is None and line:
+                cols = [c.strip() for c in line.split(',')]
+                continue
+            if not (table and cols and '[' in line):
+                continue
+
+            # split around the bracketed lists, which contain no commas
+            lists = re.findall(r'\[([^\]]*)\]', line)
+            flat = re.sub(r'\[[^\]]*\]', '[]', line)
+            fields = [c.strip() for c in flat.split(',')]
+            if len(fields) != len(cols):
+                continue
+            row = dict(zip(cols, fields))
+            tcol = next((c for c in TRIAL_COLUMNS if c in row), None)
+            if tcol is None:
+                continue
+            # the trial list is the one in the trial times column
+            idx = [c for c in cols if row[c] == '[]'].index(tcol)
+            trials = [float(t) for t in lists[idx].split()]
+            tester = TESTER_OF.get(cols[0], cols[0])
+            key = (tester, table, 'full', '', '', row.get('n', ''),
+                   row.get('x', ''), '', row.get(cols[0], ''))
+            out.append((key, trials))
+    return out
+
+
+def load(path):
+    if path.endswith('.jsonl') or path.endswith('.json'):
+        return load_jsonl(path)
+    if path.endswith('.csv'):
+        return load_csv(path)
+    try:
+        return load_text(path)
+    except (UnicodeDecodeError, ValueError):
+        return []
+
+
+def load_set(path):
+    files = []
+    if os.path.isdir(path):
+        for d, _, names in os.walk(path):
+            files += [os.path.join(d, n) for n in sorted(names)]
+    else:
+        files = [path]
+
+    runs = {}
+    for f in files:
+        for key, trials in load(f):
+            runs.setdefault(key, []).extend(trials)
+    return runs
+
+
+def median(v):
+    s = sorted(v)
+    m = len(s) // 2
+    return s[m] if len(s) % 2 else (s[m - 1] + s[m]) / 2
+
+
+def mann_whitney(a, b):
+    """two-sided p-value, normal approximation with tie correction"""
+    n1, n2 = len(a), len(b)
+    pooled = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks = [0.0] * len(pooled)
+    ties = 0.0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+
+    r1 = sum(r for r, (_, g) in zip(ranks, pooled) if g == 0)
+    u = r1 - n1 * (n1 + 1) / 2
+    mu = n1 * n2 / 2
+    n = n1 + n2
+    var = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+    z = (abs(u - mu) - 0.5) / math.sqrt(var)
+    return min(1.0, math.erfc(max(z, 0) / math.sqrt(2)))
+
+
+def bootstrap_ratio(a, b, resamples, level, rng):
+    """confidence interval for median(b) / median(a)"""
+    ratios = []
+    for _ in range(resamples):
+        ma = median(rng.choices(a, k=len(a)))
+        mb = median(rng.choices(b, k=len(b)))
+        if ma > 0:
+            ratios.append(mb / ma)
+    ratios.sort()
+    lo = ratios[int((1 - level) / 2 * len(ratios))]
+    hi = ratios[min(len(ratios) - 1, int((1 + level) / 2 * len(ratios)))]
+    return lo, hi
+
+
+def benjamini_hochberg(p):
+    order = sorted(range(len(p)), key=lambda i: p[i])
+    adj = [0.0] * len(p)
+    prev = 1.0
+    for rank, i in reversed(list(enumerate(order, 1))):
+        prev = min(prev, p[i] * len(p) / rank)
+        adj[i] = prev
+    return adj
+
+
+def describe(key):
+    names = ('', '', 'k', 'v', 'n', 'x', '', 'ops')
+    parts = [key[0], key[1]]
+    parts += ['%s=%s' % (n, v) for n, v in zip(names[2:], key[2:])
+              if v and n]
+    if key[6]:
+        parts.append(key[6])
+    return ' '.join(parts)
+
+
+def main():
+    ap = argparse.ArgumentParser(
+            description='flag benchmark regressions against a baseline')
+    ap.add_argument('baseline')
+    ap.add_argument('current')
+    ap.add_argument('--alpha', type=float, default=0.01,
+                    help='significance level after adjustment [0.01]')
+    ap.add_argument('--threshold', type=float, default=0.02,
+                    help='smallest slowdown worth flagging [0.02]')
+    ap.add_argument('--level', type=float, default=0.95,
+                    help='confidence level of the interval [0.95]')
+    ap.add_argument('--bootstrap', type=int, default=2000,
+                    help='bootstrap resamples [2000]')
+    ap.add_argument('--seed', type=int, default=42)
+    ap.add_argument('--all', action='store_true',
+                    help='list unchanged configurations too')
+    args = ap.parse_args()
+
+    base = load_set(args.baseline)
+    cur = load_set(args.current)
+    keys = sorted(k for k in base.keys() & cur.keys()
+                  if len(base[k]) > 1 and len(cur[k]) > 1)
+    print('%d configurations in baseline, %d in current, %d matched'
+          % (len(base), len(cur), len(keys)))
+    if not keys:
+        return 0
+
+    rng = random.Random(args.seed)
+    p = [mann_whitney(base[k], cur[k]) for k in keys]
+    padj = benjamini_hochberg(p)
+
+    rows = []
+    for k, pa in zip(keys, padj):
+        a, b = base[k], cur[k]
+        ratio = median(b) / median(a) if median(a) > 0 else float('nan')
+        lo, hi = bootstrap_ratio(a, b, args.bootstrap, args.level, rng)
+        if pa < args.alpha and lo > 1 + args.threshold:
+            verdict = 'REGRESSION'
+        elif pa < args.alpha and hi < 1 - args.threshold:
+            verdict = 'improvement'
+        else:
+            verdict = ''
+        rows.append((verdict, ratio, lo, hi, pa, k))
+
+    rows.sort(key=lambda r: -r[1])
+    print('%-11s %8s  %-17s %9s  %s' % ('', 'ratio', 'CI', 'p (adj)',
+                                        'configuration'))
+    for verdict, ratio, lo, hi, pa, k in rows:
+        if verdict or args.all:
+            print('%-11s %8.4f  [%6.4f, %6.4f] %9.2g  %s'
+                  % (verdict, ratio, lo, hi, pa, describe(k)))
+
+    nreg = sum(1 for r in rows if r[0] == 'REGRESSION')
+    nimp = sum(1 for r in rows if r[0] == 'improvement')
+    print('%d regressions, %d improvements, %d unchanged'
+          % (nreg, nimp, len(rows) - nreg - nimp))
+    return 1 if nreg else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())